@@ -44,9 +44,21 @@ namespace oxygen
 	{
 		if (!m_resource)
 			return;
+		if (m_currentFrame && m_renderCulled->load(std::memory_order_relaxed))
+		{
+			// Off screen, only keep the timeline going
+			m_animTotalTime += deltaTimeSeconds;
+			m_framesNeedResync = true;
+			return;
+		}
+		if (m_framesNeedResync)
+		{
+			m_framesNeedResync = false;
+			ResyncAnimationFrames();
+		}
 		if (m_currentFrame)
 		{
-			const auto fps = 30.0f; // eww!
+			const auto fps = k_animFramesPerSecond;
 			const auto lastUpdateAnimTime = m_animTotalTime;
 			
 			m_animTotalTime += deltaTimeSeconds;
@@ -110,6 +122,28 @@ namespace oxygen
 		}
 	}
 
+	auto AnimatedMeshComponent::ResyncAnimationFrames() -> void
+	{
+		const auto it = m_resource->m_animations.find(m_animHash);
+		if (it == m_resource->m_animations.end() ||
+			it->second.m_frames.empty())
+			return;
+		const auto& frames = it->second.m_frames;
+		const auto numFrames = static_cast<oxyU32>(frames.size());
+		const auto duration = numFrames / k_animFramesPerSecond;
+		if (m_loopAnim)
+			m_animTotalTime = std::fmodf(m_animTotalTime, duration);
+		const auto frameIndex = std::min(
+			static_cast<oxyU32>(m_animTotalTime * k_animFramesPerSecond),
+			numFrames - 1);
+		m_currentFrame = &frames[frameIndex];
+		m_nextFrame =
+			frameIndex + 1 < numFrames ? &frames[frameIndex + 1] : nullptr;
+		m_animCurrentFrameTime =
+			m_animTotalTime - frameIndex / k_animFramesPerSecond;
+		m_animLerpAlpha = m_animCurrentFrameTime * k_animFramesPerSecond;
+	}
+
 	auto AnimatedMeshComponent::Render() const -> void
 	{
 		if (!m_resource)
@@ -126,58 +160,24 @@ namespace oxygen
 		worldMtx = Math::Translate(worldMtx, pos);
 		worldMtx = Math::Rotate(worldMtx, rot);
 		worldMtx = Math::Scale(worldMtx, scale);
-		const auto vp = GfxRenderer::GetInstance().GetViewProjectionMatrix();
 
-		const auto animit = m_resource->m_animations.find(m_animHash);
-
-		size_t vertIndex{};
-		for (const auto& tri : m_resource->m_rootPose->m_tris)
-		{
-			GfxTri gfxtri;
-			for (int i = 0; i < 3; ++i)
-			{
-				oxyVec4 pos{tri.m_vertices[i].m_position, 1.f};
-
-				//if (animit != m_resource->m_animations.end())
-				//{
-				//	const auto& anim = animit->second;
-				//	const auto& frame = anim.m_frames[m_animFrameIndex];
-				//	const auto& animvert = frame[vertIndex];
-				//	pos = {animvert.x, animvert.y,
-				//		   animvert.z,
-				//		   1.f};
-				//}
-
-				if (m_currentFrame)
-				{
-					const auto curvt = (*m_currentFrame)[vertIndex];
-					if (m_nextFrame)
-					{
-						const auto nextvt = (*m_nextFrame)[vertIndex];
-						const auto lerpvt =
-							(nextvt - curvt) * m_animLerpAlpha + curvt;
-						pos = {lerpvt.x, lerpvt.y, lerpvt.z, 1.f};
-					}
-					else
-					{
-						pos = {curvt.x, curvt.y, curvt.z, 1.f};
-					}
-				}
-
-				pos = pos * localMtx * worldMtx * vp;
-				gfxtri.m_vertices[i].m_position = pos;
-				gfxtri.m_vertices[i].m_uv = tri.m_vertices[i].m_uv;
-
-				vertIndex++;
-			}
-			gfxtri.m_colour = {1.f, 1.f, 1.f};
-			gfxtri.m_texture = m_texture.get();
-			gfxtri.m_cullType =
-				GfxCullType_Frontface; // the winding order appears to be... not
-									   // what i expected!
-			GfxRenderer::GetInstance().SubmitTriToQueue(
-				gfxtri, GfxRenderStrategy_SoftwareDepthRasterize);
-		}
+		const auto& bounds = m_resource->m_bounds;
+		GfxMeshInstance mesh;
+		mesh.m_mesh = m_resource->m_rootPose;
+		mesh.m_animatedMesh = m_resource;
+		mesh.m_currentFrame = m_currentFrame;
+		mesh.m_nextFrame = m_nextFrame;
+		mesh.m_lerpAlpha = m_animLerpAlpha;
+		mesh.m_texture = m_texture;
+		mesh.m_worldMatrix = localMtx * worldMtx;
+		mesh.m_sphereCenter =
+			oxyVec4{bounds.m_sphereCenter, 1.f} * mesh.m_worldMatrix;
+		mesh.m_sphereRadius =
+			bounds.m_sphereRadius * std::max({std::abs(scale.x),
+											  std::abs(scale.y),
+											  std::abs(scale.z)});
+		mesh.m_culledFeedback = m_renderCulled;
+		GfxRenderer::GetInstance().CaptureMesh(std::move(mesh));
 	}
 
 }; // namespace oxygen
@@ -33,6 +33,11 @@ namespace oxygen
 		auto Render() const -> void override;
 
 	  private:
+		static inline constexpr auto k_animFramesPerSecond = 30.0f;
+
+		// Jump straight to the frames for m_animTotalTime
+		auto ResyncAnimationFrames() -> void;
+
 		oxyU32 m_animHash{};
 		oxyF32 m_animTotalTime{};
 		oxyF32 m_animCurrentFrameTime{};
@@ -42,7 +47,14 @@ namespace oxygen
 		oxyQuat m_localRotation{};
 		const std::vector<oxyVec3>* m_currentFrame{};
 		const std::vector<oxyVec3>* m_nextFrame{};
+		// Culled last render (written by the render thread), frame stepping
+		// is skipped until visible again
+		std::shared_ptr<std::atomic<oxyBool>> m_renderCulled{
+			std::make_shared<std::atomic<oxyBool>>(false)};
+		oxyBool m_framesNeedResync{};
 		std::shared_ptr<const AnimatedMeshResource> m_resource;
 		std::shared_ptr<const struct GfxTexture> m_texture;
+
+		friend struct ComponentScheduler;
 	};
 } // namespace oxygen
\ No newline at end of file
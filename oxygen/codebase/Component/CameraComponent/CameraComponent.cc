@@ -34,4 +34,13 @@ namespace oxygen
 			Math::Perspective(m_verticalFovRad, aspect, m_nearClip, m_farClip);
 		m_viewProjectionMatrix = m_viewMatrix * m_projectionMatrix;
 	}
+	auto CameraComponent::BuildViewProjectionMatrix(
+		const oxyVec3& worldPos, const oxyVec3& euler,
+		const oxyMat4x4& projection) -> oxyMat4x4
+	{
+		const auto forward = Math::EulerForward(euler);
+		const auto right = forward.CrossProduct({0.f, 0.f, 1.f});
+		const auto up = right.CrossProduct(forward);
+		return Math::LookAt(worldPos, worldPos + forward, up) * projection;
+	}
 }; // namespace oxygen
\ No newline at end of file
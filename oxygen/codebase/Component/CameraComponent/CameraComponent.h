@@ -52,6 +52,12 @@ namespace oxygen
 		{
 			return m_viewProjectionMatrix;
 		}
+		// View projection for an arbitrary camera position and orientation,
+		// built the same way as Update, safe off the simulation thread
+		static auto BuildViewProjectionMatrix(const oxyVec3& worldPos,
+											  const oxyVec3& euler,
+											  const oxyMat4x4& projection)
+			-> oxyMat4x4;
 
 		auto SetEuler(const oxyVec3& euler) -> void
 		{
@@ -87,5 +93,7 @@ namespace oxygen
 		oxyMat4x4 m_viewProjectionMatrix{};
 
 		oxyBool m_updateEntityYaw{true};
+
+		friend struct ComponentScheduler;
 	};
 }; // namespace oxygen
\ No newline at end of file
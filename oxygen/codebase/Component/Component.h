@@ -30,5 +30,6 @@ namespace oxygen
 		oxyBool m_enabled{true};
 
 		friend struct Entity;
+		friend struct ComponentScheduler;
 	};
 }; // namespace oxygen
\ No newline at end of file
@@ -33,5 +33,7 @@ namespace oxygen
 		oxyVec3 m_velocity{};
 		oxyF32 m_radius{};
 		oxyBool m_isPushing{};
+
+		friend struct ComponentScheduler;
 	};
 } // namespace oxygen
\ No newline at end of file
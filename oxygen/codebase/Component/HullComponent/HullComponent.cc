@@ -191,37 +191,31 @@ namespace oxygen
 	}
 	auto HullComponent::DoesIgnoreEntity(const Entity* entity) const -> oxyBool
 	{
-		if (std::find_if(m_ignoreEntities.begin(), m_ignoreEntities.end(),
-						 [&entity](const auto& weakEntity) {
-							 return weakEntity.lock().get() == entity;
-						 }) != m_ignoreEntities.end())
+		// Stale handles never match, a live entity has a newer generation
+		const auto entityHandle = ObjectHandle<const Entity>{entity};
+		if (std::find(m_ignoreEntities.begin(), m_ignoreEntities.end(),
+					  entityHandle) != m_ignoreEntities.end())
 			return true;
-		const auto otherHull = entity->GetComponent<HullComponent>();
+		const auto otherHull = entity->FindComponent<HullComponent>();
 		if (!otherHull)
 			return false;
-		const auto self = GetEntity();
-		return std::find_if(otherHull->m_ignoreEntities.begin(),
-							otherHull->m_ignoreEntities.end(),
-							[&self](const auto& weakEntity) {
-								return weakEntity.lock().get() == self.get();
-							}) != otherHull->m_ignoreEntities.end();
+		const auto selfHandle = ObjectHandle<const Entity>{GetEntity().get()};
+		return std::find(otherHull->m_ignoreEntities.begin(),
+						 otherHull->m_ignoreEntities.end(),
+						 selfHandle) != otherHull->m_ignoreEntities.end();
 	}
 	auto HullComponent::AddToIgnoreList(
 		const std::shared_ptr<struct Entity>& entity) -> void
 	{
-		m_ignoreEntities.push_back(entity);
+		m_ignoreEntities.emplace_back(entity.get());
 	}
 	auto HullComponent::Update(oxyF32 deltaTimeSeconds) -> void
 	{
-
+		// Bounce hulls are stepped in bulk by the world's PhysicsWorld
 		if (m_response == CollisionResponseType_Slide)
 		{
 			UpdateSlide(deltaTimeSeconds);
 		}
-		else if (m_response == CollisionResponseType_Bounce)
-		{
-			UpdateBounce(deltaTimeSeconds);
-		}
 	}
 	//auto HullComponent::Render() const -> void
 	//{
@@ -265,9 +259,16 @@ namespace oxygen
 		const auto ent = GetEntity();
 		const auto world = ent->GetWorld();
 		const auto worldPosition = ent->GetWorldPosition();
-		const auto stepdist = oxyVec3{0, 0, deltaTimeSeconds * 48.f};
+		// Steps are only climbed from the ground
+		const auto stepHeight = m_onGround ? m_stepHeight : 0.f;
+		const auto lift =
+			m_gravityPerSecond != 0.0f
+				? oxyVec3{0, 0, deltaTimeSeconds * k_slideLiftPerSecond}
+				: oxyVec3{};
 		const auto pos = world->CalculateHullSlideMovement(
-			m_hull, worldPosition + stepdist, m_velocity * deltaTimeSeconds);
+			m_hull, worldPosition + lift, m_velocity, deltaTimeSeconds,
+			stepHeight);
+		m_onGround = false;
 		if (m_gravityPerSecond != 0.0f)
 		{
 			const auto gravityVec =
@@ -277,6 +278,7 @@ namespace oxygen
 			if (world->HullTrace(m_hull, pos, end, result))
 			{
 				m_velocity.z = 0.0f;
+				m_onGround = result.m_planeNormal.z >= World::k_floorNormalZ;
 				ClipToHullsAndUpdateWorldPosition(
 					worldPosition, result.m_endPos, world.get(), ent.get());
 			}
@@ -289,6 +291,13 @@ namespace oxygen
 		}
 		else
 		{
+			// Nothing pulls it onto the ground, so it is only looked for
+			World::LineTraceResult result{};
+			m_onGround =
+				world->HullTrace(m_hull, pos,
+								 pos - oxyVec3{0, 0, k_groundProbeDistance},
+								 result) &&
+				result.m_planeNormal.z >= World::k_floorNormalZ;
 			ClipToHullsAndUpdateWorldPosition(worldPosition, pos, world.get(),
 											  ent.get());
 		}
@@ -327,43 +336,27 @@ namespace oxygen
 		return offset;
 	}
 #endif
-	auto HullComponent::UpdateBounce(oxyF32 deltaTimeSeconds) -> void
+	auto HullComponent::ResolveBounce(const oxyVec3& position,
+									  const oxyVec3& end,
+									  const oxyVec3* worldHitPosition,
+									  const oxyVec3& worldHitNormal,
+									  const World& world, Entity& self) -> void
 	{
-		const auto ent = GetEntity();
-		const auto world = ent->GetWorld();
-
-		const auto worldPos = ent->GetWorldPosition();
-
-		World::LineTraceResult result{};
-		if (world->HullTrace(m_hull, worldPos,
-							 worldPos + m_velocity * deltaTimeSeconds, result))
+		if (worldHitPosition)
 		{
 			// Redirect velocity based on the plane normal
-			auto invNormal = -result.m_planeNormal;
+			auto invNormal = -worldHitNormal;
 			auto dot = m_velocity.DotProduct(invNormal);
 			m_velocity = (m_velocity - invNormal * dot * 2.f) *
 						 m_bounceVelocityMultiplier;
-			// Redirect remaining offset as well
-			const auto hitDist = (result.m_endPos - worldPos).Magnitude();
-			const auto offsetTaken = m_velocity.Normalized() * hitDist;
-			const auto newOffset = m_velocity - offsetTaken;
-			const auto newPos = result.m_endPos;
+			const auto newPos = *worldHitPosition;
 			m_onBounceEvent.IterateCallbacks([]() {}, this, nullptr, newPos);
-			ClipToHullsAndUpdateWorldPosition(worldPos, newPos, world.get(),
-											  ent.get());
+			ClipToHullsAndUpdateWorldPosition(position, newPos, &world, &self);
 		}
 		else
 		{
-			ClipToHullsAndUpdateWorldPosition(
-				worldPos, worldPos + m_velocity * deltaTimeSeconds, world.get(),
-				ent.get());
+			ClipToHullsAndUpdateWorldPosition(position, end, &world, &self);
 		}
-		m_velocity.z -= m_gravityPerSecond * deltaTimeSeconds;
-
-		// apply drag
-		m_velocity.x *= 1.0f - m_drag * deltaTimeSeconds;
-		m_velocity.y *= 1.0f - m_drag * deltaTimeSeconds;
-
 	}
 	auto HullComponent::ClipToHullsAndUpdateWorldPosition(
 		const oxyVec3& position, const oxyVec3& newPosition, const World* world,
@@ -377,18 +370,38 @@ namespace oxygen
 			return; // we didnt really move
 
 
-		const auto& entityList = world->GetEntityList();
+		if (m_hull == CollisionHull_None)
+		{
+			self->SetWorldPosition(newPosition);
+			return;
+		}
+
+		// Only hulls linked around the swept box can be touched
+		const auto& hullMins = k_collisionHullMins[static_cast<int>(m_hull)];
+		const auto& hullMaxs = k_collisionHullMaxs[static_cast<int>(m_hull)];
+		const auto sweepMins =
+			oxyVec3{(std::min)(position.x, newPosition.x),
+					(std::min)(position.y, newPosition.y),
+					(std::min)(position.z, newPosition.z)} +
+			hullMins;
+		const auto sweepMaxs =
+			oxyVec3{(std::max)(position.x, newPosition.x),
+					(std::max)(position.y, newPosition.y),
+					(std::max)(position.z, newPosition.z)} +
+			hullMaxs;
+		std::vector<std::shared_ptr<Entity>> nearby;
+		world->QueryEntitiesInBounds(sweepMins, sweepMaxs, nearby);
+
 		auto finalPos = newPosition;
-		for (oxySize i = 0; i < entityList.size(); ++i)
+		for (const auto& ent : nearby)
 		{
-			const auto& ent = entityList[i];
 			if (ent.get() == self)
 				continue;
 			if (ent->GetFlag(EntityFlags_Disabled))
 				continue;
 			if (!ent->GetFlag(EntityFlags_HasHull))
 				continue;
-			const auto hullcomp = ent->GetComponent<HullComponent>();
+			const auto hullcomp = ent->FindComponent<HullComponent>();
 			if (!hullcomp)
 				continue;
 			if (!hullcomp->IsEnabled())
@@ -58,6 +58,10 @@ namespace oxygen
 		{
 			return m_response;
 		}
+		auto GetStepHeight() const -> oxyF32
+		{
+			return m_stepHeight;
+		}
 
 		auto SetHull(CollisionHull hull) -> void
 		{
@@ -88,6 +92,11 @@ namespace oxygen
 		{
 			m_response = response;
 		}
+		// Highest ledge a sliding hull walks up onto from the ground
+		auto SetStepHeight(oxyF32 stepHeight) -> void
+		{
+			m_stepHeight = stepHeight;
+		}
 		auto
 		AddToIgnoreList(const std::shared_ptr<struct Entity>& entity) -> void;
 
@@ -96,8 +105,23 @@ namespace oxygen
 		//auto Render() const -> void override;
 
 	  private:
+		// Constant rise a sliding hull under gravity makes, jump and fall
+		// arcs were tuned with it
+		static inline constexpr auto k_slideLiftPerSecond = 48.f;
+		// How far below a sliding hull without gravity the ground is looked
+		// for
+		static inline constexpr auto k_groundProbeDistance = 0.25f;
+
 		auto UpdateSlide(oxyF32 deltaTimeSeconds) -> void;
-		auto UpdateBounce(oxyF32 deltaTimeSeconds) -> void;
+		// Moves a bounce hull from position towards end. The world's
+		// PhysicsWorld integrates before and after and traces the sweep
+		// against the map beforehand, worldHitPosition is null if it was
+		// clear.
+		auto ResolveBounce(const oxyVec3& position, const oxyVec3& end,
+						   const oxyVec3* worldHitPosition,
+						   const oxyVec3& worldHitNormal,
+						   const struct World& world,
+						   struct Entity& self) -> void;
 
 		auto ClipToHullsAndUpdateWorldPosition(
 			const oxyVec3& position, const oxyVec3& newPosition,
@@ -125,6 +149,14 @@ namespace oxygen
 		oxyF32 m_bounceVelocityMultiplier{1.f};
 		CollisionResponseType m_response{
 			CollisionResponseType::CollisionResponseType_Bounce};
-		std::vector<std::weak_ptr<const struct Entity>> m_ignoreEntities;
+		std::vector<ObjectHandle<const struct Entity>> m_ignoreEntities;
+		oxyF32 m_stepHeight{};
+		oxyBool m_onGround{};
+
+		friend struct PhysicsWorld;
+		friend auto CheckHullMovement(std::string_view name) -> void;
+		friend auto BenchmarkPhysics(std::string_view name,
+									 oxyU32 bodyCount) -> void;
+		friend struct ComponentScheduler;
 	};
 }; // namespace oxygen
\ No newline at end of file
@@ -131,8 +131,8 @@ namespace oxygen
 		if (m_lookVector.MagnitudeSquared() < 0.0001f)
 		{
 			const auto md = InputManager::GetInstance().GetMouseDelta();
-			const auto sens = 0.03f; // HACK: TODO: SETTINGS
-			m_lookVector = {md.x * sens, md.y * sens};
+			m_lookVector = {md.x * k_mouseSensitivity,
+							md.y * k_mouseSensitivity};
 		}
 
 		// boolean inputs
@@ -146,6 +146,32 @@ namespace oxygen
 		m_reloadInputDown =
 			InputManager::GetInstance().IsKeyDown(KeyboardButton_R);
 	}
+	auto Pawn::ApplyLook(oxyVec3 euler, const oxyVec2& look) -> oxyVec3
+	{
+		const auto scaled = look * k_lookSensitivity;
+		euler.x += scaled.y;
+		euler.z -= scaled.x;
+		// clamp pitch
+		euler.x =
+			std::clamp(euler.x, -Math::k_pi / 2.0f + 0.1f, Math::k_pi / 2.0f - 0.1f);
+		return euler;
+	}
+	auto Pawn::ApplyMouseLook(const oxyVec3& euler,
+							  const oxyVec2& mouseDelta) -> oxyVec3
+	{
+		return ApplyLook(euler, mouseDelta * k_mouseSensitivity);
+	}
+	auto Pawn::CanLateLatchLook() const -> oxyBool
+	{
+		if (!m_localControl || m_state != PawnState_Ground || !m_camera)
+			return false;
+		// controller look wins over the mouse in ParseInput
+		const auto lx = InputManager::GetInstance().GetControllerAxis(
+			0, ControllerAxis_RightThumbY);
+		const auto ly = InputManager::GetInstance().GetControllerAxis(
+			0, ControllerAxis_RightThumbX);
+		return oxyVec2{lx, ly}.MagnitudeSquared() < 0.0001f;
+	}
 	auto Pawn::GroundStateUpdate(oxyF32 deltaTimeSeconds, Entity& ent) -> void
 	{
 		if (m_localControl)
@@ -172,15 +198,7 @@ namespace oxygen
 				// TODO: acceleration
 			}
 
-			const auto lookSensitivity = 0.1f;
-			const auto look = m_lookVector * lookSensitivity;
-			auto euler = m_camera->GetEuler();
-			euler.x += look.y;
-			euler.z -= look.x;
-			// clamp pitch
-			euler.x =
-				std::clamp(euler.x, -Math::k_pi / 2.0f + 0.1f, Math::k_pi / 2.0f - 0.1f);
-			m_camera->SetEuler(euler);
+			m_camera->SetEuler(ApplyLook(m_camera->GetEuler(), m_lookVector));
 
 			if (m_dropInputPressed && m_equippedWeapon)
 			{
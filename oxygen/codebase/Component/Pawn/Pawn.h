@@ -42,6 +42,13 @@ namespace oxygen
 			return m_rightHandEquippedWeapon;
 		}
 
+		// Whether the camera may be latched to mouse movement made after the
+		// last input update, right before rendering
+		auto CanLateLatchLook() const -> oxyBool;
+		// Camera euler with a raw mouse delta applied the way Update would
+		static auto ApplyMouseLook(const oxyVec3& euler,
+								   const oxyVec2& mouseDelta) -> oxyVec3;
+
 	  protected:
 		auto Update(oxyF32 deltaTimeSeconds) -> void override;
 		auto Render() const -> void override;
@@ -58,6 +65,11 @@ namespace oxygen
 
 		auto ParseInput() -> void;
 
+		static inline constexpr auto k_mouseSensitivity =
+			0.03f; // HACK: TODO: SETTINGS
+		static inline constexpr auto k_lookSensitivity = 0.1f;
+		static auto ApplyLook(oxyVec3 euler, const oxyVec2& look) -> oxyVec3;
+
 		auto GroundStateUpdate(oxyF32 deltaTimeSeconds,
 							   struct Entity& ent) -> void;
 		auto VoidStateUpdate(oxyF32 deltaTimeSeconds,
@@ -104,5 +116,6 @@ namespace oxygen
 
 		friend struct GameManager;
 		friend struct WeaponComponent;
+		friend struct ComponentScheduler;
 	};
 }; // namespace oxygen
\ No newline at end of file
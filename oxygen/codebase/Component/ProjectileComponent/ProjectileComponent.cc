@@ -7,6 +7,7 @@
 #include "Component/HealthComponent/HealthComponent.h"
 
 #include "Net/NetSystem.h"
+#include "Platform/Platform.h"
 
 namespace oxygen
 {
@@ -62,18 +63,21 @@ namespace oxygen
 
 		const auto worldPos = ent->GetWorldPosition();
 
-		const auto& entList = ent->GetWorld()->GetEntityList();
-		for (oxySize i = 0; i < entList.size(); ++i)
+		const auto radiusExtent =
+			oxyVec3{m_damageRadius, m_damageRadius, m_damageRadius};
+		std::vector<std::shared_ptr<Entity>> nearby;
+		ent->GetWorld()->QueryEntitiesInBounds(worldPos - radiusExtent,
+											   worldPos + radiusExtent, nearby);
+		for (const auto& ent : nearby)
 		{
-			const auto& ent = entList[i];
 			if (ent.get() == GetEntity().get())
 				continue;
 			if (!ent->GetFlag(EntityFlags_HasHull))
 				continue;
-			const auto hullcomp = ent->GetComponent<HullComponent>();
+			const auto hullcomp = ent->FindComponent<HullComponent>();
 			if (!hullcomp)
 				continue;
-			const auto health = ent->GetComponent<HealthComponent>();
+			const auto health = ent->FindComponent<HealthComponent>();
 			if (!health)
 				continue;
 			if (hullcomp->IsWithinRadius(worldPos, m_damageRadius))
@@ -91,5 +95,4 @@ namespace oxygen
 		
 		ent->Destroy();
 	}
-
 } // namespace oxygen
@@ -38,5 +38,8 @@ namespace oxygen
 		oxyF32 m_damage;
 		oxyF32 m_damageRadius;
 		oxyVec3 m_spinEuler{10.f, 0.f, 0.f};
+
+		friend struct ComponentScheduler;
+		friend auto BenchmarkProjectileChurn(oxySize count) -> void;
 	};
 } // namespace oxygen
\ No newline at end of file
@@ -33,22 +33,17 @@ namespace oxygen
 		worldMtx = Math::Translate(worldMtx, pos);
 		worldMtx = Math::Rotate(worldMtx, rot);
 		worldMtx = Math::Scale(worldMtx, scale);
-		const auto vp = GfxRenderer::GetInstance().GetViewProjectionMatrix();
-		for (const auto& tri : m_resource->m_tris)
-		{
-			GfxTri gfxtri;
-			for (auto i = 0; i < 3; ++i)
-			{
-				gfxtri.m_vertices[i].m_position =
-					oxyVec4{tri.m_vertices[i].m_position, 1.f} * worldMtx *
-					vp;
-				gfxtri.m_vertices[i].m_uv = tri.m_vertices[i].m_uv;
-			}
-			gfxtri.m_colour = {1.f, 1.f, 1.f};
-			gfxtri.m_texture = m_texture.get();
-			gfxtri.m_cullType = GfxCullType_Frontface;
-			GfxRenderer::GetInstance().SubmitTriToQueue(
-				gfxtri, GfxRenderStrategy_SoftwareDepthRasterize);
-		}
+
+		const auto& bounds = m_resource->m_bounds;
+		GfxMeshInstance mesh;
+		mesh.m_mesh = m_resource;
+		mesh.m_texture = m_texture;
+		mesh.m_worldMatrix = worldMtx;
+		mesh.m_sphereCenter = oxyVec4{bounds.m_sphereCenter, 1.f} * worldMtx;
+		mesh.m_sphereRadius =
+			bounds.m_sphereRadius * std::max({std::abs(scale.x),
+											  std::abs(scale.y),
+											  std::abs(scale.z)});
+		GfxRenderer::GetInstance().CaptureMesh(std::move(mesh));
 	}
 }; // namespace oxygen
\ No newline at end of file
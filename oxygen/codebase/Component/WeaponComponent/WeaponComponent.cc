@@ -46,7 +46,7 @@ namespace oxygen
 			ent->SetFlag(EntityFlags_EnableTransformReplication, false);
 			ent->SetFlag(EntityFlags_EnableTransformInterpolation, false);
 		}
-		m_owner = std::move(pawn);
+		m_owner = ObjectHandle<Pawn>{pawn.get()};
 
 		const auto hull = ent->GetComponent<HullComponent>();
 		if (hull)
@@ -59,7 +59,7 @@ namespace oxygen
 
 	auto WeaponComponent::OnDropped() -> void
 	{
-		m_owner.reset();
+		m_owner.Reset();
 		auto ent = GetEntity();
 		ent->SetParent(nullptr);
 		ent->SetFlag(EntityFlags_EnableTransformReplication, true);
@@ -99,7 +99,7 @@ namespace oxygen
 		if (!m_infiniteClip)
 			m_clipAmmo -= bulletsToFire;
 
-		auto pawn = m_owner.lock();
+		auto pawn = m_owner.GetRef();
 
 		for (oxyU32 i = 0; i < bulletsToFire; ++i)
 		{
@@ -175,7 +175,7 @@ namespace oxygen
 			return;
 		}
 
-		const auto pawn = m_owner.lock();
+		const auto pawn = m_owner.GetRef();
 		if (!pawn)
 			return;
 		const auto pawnent = pawn->GetEntity();
@@ -141,7 +141,7 @@ namespace oxygen
 		oxyBool m_rightHanded{};
 		oxyBool m_canDrop{};
 
-		std::weak_ptr<struct Pawn> m_owner;
+		ObjectHandle<struct Pawn> m_owner;
 
 		oxyBool m_fireInputDown{};
 		oxyBool m_fire2InputDown{};
@@ -175,5 +175,7 @@ namespace oxygen
 		auto ReloadEnded() -> void;
 
 		auto ResetStateAndTimers() -> void;
+
+		friend struct ComponentScheduler;
 	};
 }; // namespace oxygen
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+namespace oxygen
+{
+	// std::bitset sized at runtime, for sets over map elements whose count
+	// is only known once the map is loaded
+	struct DynamicBitset
+	{
+		DynamicBitset() = default;
+		explicit DynamicBitset(oxySize size)
+		{
+			Resize(size);
+		}
+
+		// Clears every bit
+		auto Resize(oxySize size) -> void
+		{
+			m_size = size;
+			m_words.assign((size + k_wordBits - 1) / k_wordBits, 0);
+		}
+		auto Size() const -> oxySize
+		{
+			return m_size;
+		}
+
+		auto Test(oxySize index) const -> bool
+		{
+			return (m_words[index / k_wordBits] >> (index % k_wordBits)) & 1;
+		}
+		auto Set(oxySize index) -> void
+		{
+			m_words[index / k_wordBits] |= oxyU64{1} << (index % k_wordBits);
+		}
+		auto Reset(oxySize index) -> void
+		{
+			m_words[index / k_wordBits] &= ~(oxyU64{1} << (index % k_wordBits));
+		}
+		auto Reset() -> void
+		{
+			std::fill(m_words.begin(), m_words.end(), oxyU64{0});
+		}
+
+	  private:
+		static inline constexpr auto k_wordBits = oxySize{64};
+
+		std::vector<oxyU64> m_words;
+		oxySize m_size{};
+	};
+}; // namespace oxygen
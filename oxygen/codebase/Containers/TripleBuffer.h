@@ -0,0 +1,66 @@
+#pragma once
+
+namespace oxygen
+{
+	// Single producer, single consumer latest value handoff. The writer fills
+	// its buffer and publishes it, the reader acquires the most recently
+	// published buffer, older unread ones are skipped. Neither side ever
+	// blocks, each owns one buffer exclusively and the third is swapped
+	// through an atomic index.
+	template <typename T> struct TripleBuffer
+	{
+		TripleBuffer() : m_writeIndex(0), m_middle(1), m_readIndex(2)
+		{
+		}
+
+		// Writer side, the buffer is exclusively the writer's until Publish
+		auto GetWriteBuffer() -> T&
+		{
+			return m_buffers[m_writeIndex];
+		}
+		auto Publish() -> void
+		{
+			const auto previous = m_middle.exchange(
+				static_cast<oxyU8>(m_writeIndex | k_freshBit),
+				std::memory_order_acq_rel);
+			m_writeIndex = static_cast<oxyU8>(previous & k_indexMask);
+		}
+
+		// Reader side, returns false (and keeps the current read buffer) if
+		// nothing was published since the last Acquire
+		auto Acquire() -> bool
+		{
+			if (!(m_middle.load(std::memory_order_relaxed) & k_freshBit))
+				return false;
+			const auto previous =
+				m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+			m_readIndex = static_cast<oxyU8>(previous & k_indexMask);
+			return true;
+		}
+		auto GetReadBuffer() const -> const T&
+		{
+			return m_buffers[m_readIndex];
+		}
+
+		// Releases all three buffers, neither side may be using them
+		auto Reset() -> void
+		{
+			for (auto& buffer : m_buffers)
+				buffer = T{};
+			m_middle.store(static_cast<oxyU8>(
+							   m_middle.load(std::memory_order_relaxed) &
+							   k_indexMask),
+						   std::memory_order_relaxed);
+		}
+
+	  private:
+		static inline constexpr oxyU8 k_indexMask = 3;
+		static inline constexpr oxyU8 k_freshBit = 4;
+
+		std::array<T, 3> m_buffers{};
+		alignas(128) oxyU8 m_writeIndex;
+		alignas(128) std::atomic<oxyU8> m_middle;
+		alignas(128) oxyU8 m_readIndex;
+		oxyU8 m_padding[128];
+	};
+}; // namespace oxygen
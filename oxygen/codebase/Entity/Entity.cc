@@ -3,6 +3,11 @@
 #include "Component/Component.h"
 
 #include "World/World.h"
+#include "Component/HullComponent/HullComponent.h"
+#include "Component/HealthComponent/HealthComponent.h"
+#include "Component/ProjectileComponent/ProjectileComponent.h"
+#include "Component/Pawn/Pawn.h"
+#include "Platform/Platform.h"
 
 namespace oxygen
 {
@@ -113,4 +118,83 @@ namespace oxygen
 				component->Render();
 		}
 	}
+
+	auto BenchmarkComponentLookup(oxySize entityCount) -> void
+	{
+		auto& om = ObjectManager::GetInstance();
+		std::vector<std::shared_ptr<Entity>> entities;
+		for (oxySize i = 0; i < entityCount; ++i)
+		{
+			auto ent = om.CreateManagedObject<Entity>();
+			ent->AddComponent<HullComponent>();
+			if (i % 2 == 0)
+				ent->AddComponent<HealthComponent>();
+			if (i % 4 == 0)
+				ent->AddComponent<ProjectileComponent>();
+			entities.push_back(std::move(ent));
+		}
+
+		constexpr auto k_passes = 2000;
+		const auto Measure = [&](const auto& lookup) -> oxyF64 {
+			oxySize found = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (auto pass = 0; pass < k_passes; ++pass)
+			{
+				for (const auto& ent : entities)
+					found += lookup(*ent);
+			}
+			const auto seconds = std::chrono::duration<oxyF64>(
+									 std::chrono::steady_clock::now() - start)
+									 .count();
+			// hull always, health on half, projectile on a quarter, no pawns
+			OXYCHECK(found == k_passes * (entityCount + (entityCount + 1) / 2 +
+										  (entityCount + 3) / 4));
+			return seconds > 0.0 ? entityCount * k_passes * 4 / seconds : 0.0;
+		};
+
+		// GetComponent before the type intervals: a parent chain walk per
+		// component and a shared_ptr copy per hit
+		const auto Scan = [](const Entity& ent, const ObjectDescription& desc)
+			-> std::shared_ptr<Component> {
+			for (const auto& component : ent.m_components)
+			{
+				for (auto p = &component->GetDescription(); p; p = p->m_parent)
+				{
+					if (p->m_id == desc.m_id)
+						return component;
+				}
+			}
+			return nullptr;
+		};
+		const ObjectDescription* queries[] = {
+			&HullComponent::GetStaticDescription(),
+			&HealthComponent::GetStaticDescription(),
+			&ProjectileComponent::GetStaticDescription(),
+			&Pawn::GetStaticDescription(),
+		};
+		const auto scanRate = Measure([&](const Entity& ent) -> oxySize {
+			oxySize found = 0;
+			for (const auto desc : queries)
+				found += Scan(ent, *desc) ? 1 : 0;
+			return found;
+		});
+		const auto sharedRate = Measure([](const Entity& ent) -> oxySize {
+			return (ent.GetComponent<HullComponent>() ? 1 : 0) +
+				   (ent.GetComponent<HealthComponent>() ? 1 : 0) +
+				   (ent.GetComponent<ProjectileComponent>() ? 1 : 0) +
+				   (ent.GetComponent<Pawn>() ? 1 : 0);
+		});
+		const auto pointerRate = Measure([](const Entity& ent) -> oxySize {
+			return (ent.FindComponent<HullComponent>() ? 1 : 0) +
+				   (ent.FindComponent<HealthComponent>() ? 1 : 0) +
+				   (ent.FindComponent<ProjectileComponent>() ? 1 : 0) +
+				   (ent.FindComponent<Pawn>() ? 1 : 0);
+		});
+
+		LogMessage(std::format("BenchmarkComponentLookup x{}: parent chain "
+							   "scan {:.0f} lookups/s, GetComponent {:.0f} "
+							   "lookups/s, FindComponent {:.0f} lookups/s\n",
+							   entityCount, scanRate, sharedRate, pointerRate)
+					   .c_str());
+	}
 }; // namespace oxygen
\ No newline at end of file
@@ -107,19 +107,25 @@ namespace oxygen
 				ObjectManager::GetInstance().CreateManagedObject<T>(id);
 			component->m_entity = GetHardRef<Entity>();
 			m_components.push_back(component);
+			IndexComponentType(T::GetStaticDescription());
 
 			return component;
 		}
 		template <typename T> auto GetComponent() const -> std::shared_ptr<T>
 		{
-			for (auto& component : m_components)
-			{
-				if (component->IsA<T>())
-				{
-					return std::static_pointer_cast<T>(component);
-				}
-			}
-			return nullptr;
+			const auto index = FindComponentIndex(T::GetStaticDescription());
+			if (index == k_noComponent)
+				return nullptr;
+			return std::static_pointer_cast<T>(m_components[index]);
+		}
+		// Same lookup as GetComponent without touching the reference count,
+		// for callers that do not keep the component past the current frame
+		template <typename T> auto FindComponent() const -> T*
+		{
+			const auto index = FindComponentIndex(T::GetStaticDescription());
+			if (index == k_noComponent)
+				return nullptr;
+			return static_cast<T*>(m_components[index].get());
 		}
 
 		auto Destroy() -> void;
@@ -130,6 +136,32 @@ namespace oxygen
 		auto Render() const -> void;
 
 	  private:
+		static inline constexpr auto k_noComponent = ~oxySize{0};
+
+		auto IndexComponentType(const ObjectDescription& desc) -> void
+		{
+			m_componentTypes.push_back(desc.m_typeIndex);
+			for (auto p = &desc; p; p = p->m_parent)
+			{
+				if (p->m_typeIndex < 64)
+					m_componentTypeMask |= oxyU64{1} << p->m_typeIndex;
+			}
+		}
+		auto FindComponentIndex(const ObjectDescription& desc) const -> oxySize
+		{
+			// A type this entity has no component of is one bit test away
+			if (desc.m_typeIndex < 64 &&
+				!((m_componentTypeMask >> desc.m_typeIndex) & 1))
+				return k_noComponent;
+			for (oxySize i = 0; i < m_componentTypes.size(); ++i)
+			{
+				if (m_componentTypes[i] >= desc.m_typeIndex &&
+					m_componentTypes[i] < desc.m_typeIndexEnd)
+					return i;
+			}
+			return k_noComponent;
+		}
+
 		oxyVec3 m_localPosition{};
 		oxyQuat m_localRotation{0.f, 0.f, 0.f, 1.f};
 		oxyVec3 m_localScale{1.f, 1.f, 1.f};
@@ -137,9 +169,30 @@ namespace oxygen
 		EntityFlags m_flags{};
 		std::weak_ptr<struct World> m_world{};
 		std::vector<std::shared_ptr<Component>> m_components{};
+		// Type index of each entry in m_components, and a bit for each of
+		// their types and base types that numbers below 64
+		std::vector<oxyU32> m_componentTypes{};
+		oxyU64 m_componentTypeMask{};
 		oxyVec3 m_renderOcclusionMin{};
 		oxyVec3 m_renderOcclusionMax{};
 
+		// World leaf links, maintained by the world
+		std::vector<oxyS32> m_linkedLeaves;
+		oxyVec3 m_linkedMins{};
+		oxyVec3 m_linkedMaxs{};
+		oxyBool m_linked{};
+		oxyU32 m_linkQueryStamp{};
+
+		// Last world tick the ComponentScheduler updated this entity in
+		oxyU32 m_updateTick{};
+
 		friend struct World;
+		friend struct ComponentScheduler;
+		friend auto BenchmarkComponentLookup(oxySize entityCount) -> void;
 	};
+
+	// Times component lookups over entityCount entities with a mix of hull,
+	// health and projectile components, against the scan that walked each
+	// type's parent chain
+	auto BenchmarkComponentLookup(oxySize entityCount) -> void;
 }; // namespace oxygen
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "World/World.h"
 #include "World/WorldLoader.h"
+#include "Job/JobSystem.h"
 
 #include "Entity/Entity.h"
 
@@ -23,6 +24,94 @@ namespace oxygen
 {
 	GameManager::GameManager()
 	{
+		// Offline tools. Given a map <name>, -cookmap writes
+		// maps/<name>.oxymap, -benchmapload logs how long its data takes to
+		// load, -benchtrace how many rays per second it traces, -benchfindleaf
+		// how many points per second it finds leaves for,
+		// -benchrendertraversal how fast its tree is walked, -benchphysics
+		// how bounce hulls scale on it, -checkphysics whether they end up
+		// the same stepped on one thread and on many (-checkphysicsstress
+		// also with a job per hull) and -checkmovement
+		// whether a player hull moves on its open ground as it did with the
+		// per-axis slide. Given a <count>,
+		// -benchobjects times the ObjectManager, -benchprojectilechurn spawns
+		// and destroys projectiles and -benchcomponents looks up components
+		// on that many objects and -benchjobs times that many jobs and
+		// parallel loop indices. -logcomponenttimings <seconds> logs how long
+		// each component type took to update every so many seconds of play.
+		// -changelevel <map> <seconds> has a host move on to that map once it
+		// has hosted for so many seconds.
+		{
+			const auto args = GetLaunchArguments();
+			for (oxySize i = 0; i + 1 < args.size(); ++i)
+			{
+				if (args[i] == "-cookmap")
+					CookWorld(args[i + 1]);
+				else if (args[i] == "-benchmapload")
+					BenchmarkWorldLoad(args[i + 1], 100);
+				else if (args[i] == "-benchtrace")
+					BenchmarkWorldTrace(args[i + 1], 100000);
+				else if (args[i] == "-benchfindleaf")
+					BenchmarkWorldFindLeaf(args[i + 1], 1000000);
+				else if (args[i] == "-benchrendertraversal")
+					BenchmarkWorldRenderTraversal(args[i + 1], 1000);
+				else if (args[i] == "-benchphysics")
+					BenchmarkPhysics(args[i + 1], 8192);
+				else if (args[i] == "-checkphysics")
+					CheckPhysicsDeterminism(args[i + 1], 4096, false);
+				else if (args[i] == "-checkphysicsstress")
+					CheckPhysicsDeterminism(args[i + 1], 4096, true);
+				else if (args[i] == "-checkmovement")
+					CheckHullMovement(args[i + 1]);
+				else if (args[i] == "-benchobjects")
+				{
+					oxySize count = 0;
+					const auto& arg = args[i + 1];
+					std::from_chars(arg.data(), arg.data() + arg.size(), count);
+					if (count)
+						BenchmarkObjectManager(count);
+				}
+				else if (args[i] == "-benchprojectilechurn")
+				{
+					oxySize count = 0;
+					const auto& arg = args[i + 1];
+					std::from_chars(arg.data(), arg.data() + arg.size(), count);
+					if (count)
+						BenchmarkProjectileChurn(count);
+				}
+				else if (args[i] == "-benchcomponents")
+				{
+					oxySize count = 0;
+					const auto& arg = args[i + 1];
+					std::from_chars(arg.data(), arg.data() + arg.size(), count);
+					if (count)
+						BenchmarkComponentLookup(count);
+				}
+				else if (args[i] == "-benchjobs")
+				{
+					oxySize count = 0;
+					const auto& arg = args[i + 1];
+					std::from_chars(arg.data(), arg.data() + arg.size(), count);
+					if (count)
+						BenchmarkJobSystem(count);
+				}
+				else if (args[i] == "-logcomponenttimings")
+				{
+					const auto& arg = args[i + 1];
+					std::from_chars(arg.data(), arg.data() + arg.size(),
+									m_componentTimingLogInterval);
+					m_timeUntilComponentTimingLog =
+						m_componentTimingLogInterval;
+				}
+				else if (args[i] == "-changelevel" && i + 2 < args.size())
+				{
+					const auto& arg = args[i + 2];
+					std::from_chars(arg.data(), arg.data() + arg.size(),
+									m_timeUntilChangeLevel);
+					m_changeLevelName = args[i + 1];
+				}
+			}
+		}
 #if 0
 		auto hostgame = false;
 
@@ -64,24 +153,44 @@ namespace oxygen
 		}
 #endif
 	}
-	auto GameManager::Render() -> void
+	auto GameManager::Render(GfxRenderSnapshot& snapshot) -> void
 	{
 		if (m_world)
 		{
-			m_world->SubmitBSPFacesToRenderQueue();
+			m_world->CaptureRenderSnapshot(snapshot);
 		}
 	}
 	auto GameManager::Update(float deltaTimeSeconds) -> void
 	{
+		// A streamed world replaces the current one whole, between ticks
+		if (m_worldStream && m_worldStream->Poll())
+			SwapInStreamedWorld();
+
 		if (m_world)
 		{
 			m_world->Update(deltaTimeSeconds);
+			if (m_componentTimingLogInterval > 0.f)
+			{
+				m_timeUntilComponentTimingLog -= deltaTimeSeconds;
+				if (m_timeUntilComponentTimingLog <= 0.f)
+				{
+					m_timeUntilComponentTimingLog =
+						m_componentTimingLogInterval;
+					m_world->m_componentScheduler.LogTimings();
+				}
+			}
 
 			// repl ents
 			if (NetSystem::GetInstance().IsHost())
 			{
 				HostSendEntityTransforms();
 
+				if (!m_changeLevelName.empty() && !m_worldStream)
+				{
+					m_timeUntilChangeLevel -= deltaTimeSeconds;
+					if (m_timeUntilChangeLevel <= 0.f)
+						HostChangeLevel(std::exchange(m_changeLevelName, {}));
+				}
 
 				// test if there is a golf club launcher valid in the entity history
 				oxyBool found = false;
@@ -104,8 +213,9 @@ namespace oxygen
 					}
 				}
 			}
-			else
+			else if (!m_worldStream)
 			{
+				// The host has moved on to the next map already
 				ClientSendEntityTransforms();
 			}
 
@@ -162,6 +272,82 @@ namespace oxygen
 							 {0, 0, 0, 1});
 		}
 	}
+	auto GameManager::HostChangeLevel(std::string_view worldName) -> void
+	{
+		if (!m_world || !NetSystem::GetInstance().IsHost())
+			return;
+		m_worldStream = std::make_unique<WorldStream>(worldName);
+	}
+	auto GameManager::SwapInStreamedWorld() -> void
+	{
+		const auto stream = std::move(m_worldStream);
+		auto world = stream->TakeWorld();
+		const auto isHost = NetSystem::GetInstance().IsHost();
+		if (!world)
+		{
+			LogMessage(
+				std::format("Failed to load world {}\n", stream->GetName())
+					.c_str());
+			m_queuedPackets.clear();
+			// The host keeps its map, a client cannot follow the host
+			if (!isHost)
+				m_world.reset();
+			else
+			{
+				// Peers that connected while it loaded still need this one
+				for (auto& [peerID, peer] : m_peers)
+				{
+					if (!peer.m_loadedIn)
+						HostSendLevelToPeer(peerID);
+				}
+			}
+			return;
+		}
+
+		// The previous world lives until the swap is done, so meshes and
+		// textures the next one shares are still cached when it spawns
+		const auto previousWorld = std::move(m_world);
+		m_world = std::move(world);
+		m_worldName = stream->GetName();
+		m_interpolateEntityTransforms.clear();
+		m_entitySpawnHistory.clear();
+
+		if (isHost)
+		{
+			std::vector<oxyU8> buffer(m_worldName.begin(), m_worldName.end());
+			NetSystem::GetInstance().HostSendToAll(
+				NetProtoMsgType_SrvChangeLevel, buffer);
+
+			const auto pos = m_world->RandomPlayerSpawn();
+			m_world->SetLocalPlayer(HostSummonEntity(
+				EntitySpawnType_Player, pos, {0.f, 0.f, 0.f, 1.f}));
+			HostSummonEntity(EntitySpawntype_GolfballLauncher, pos,
+							 {0, 0, 0, 1});
+
+			for (auto& [peerID, peer] : m_peers)
+			{
+				const auto peerPos = m_world->RandomPlayerSpawn();
+				auto ent = HostSummonEntity(EntitySpawnType_Player, peerPos,
+											{0.f, 0.f, 0.f, 1.f});
+				peer.m_localPlayer = ent;
+				peer.m_loadedIn = true;
+
+				std::vector<oxyU8> idBuffer;
+				idBuffer.resize(sizeof(oxyObjectID));
+				*reinterpret_cast<oxyObjectID*>(idBuffer.data()) =
+					ent->GetObjectID();
+				NetSystem::GetInstance().HostSendTo(
+					peerID, NetProtoMsgType_SrvSetLocalPlayer, idBuffer);
+			}
+		}
+		else
+		{
+			const auto queuedPackets = std::move(m_queuedPackets);
+			m_queuedPackets.clear();
+			for (const auto& packet : queuedPackets)
+				ClientHandlePacket(*packet.m_conn, packet.m_type, packet.m_data);
+		}
+	}
 	auto GameManager::HandlePacket(NetConnection& conn, oxyU16 type,
 								   std::span<const oxyU8> data) -> void
 	{
@@ -244,7 +430,7 @@ namespace oxygen
 				const auto ent = peer.m_localPlayer.lock();
 				if (ent)
 				{
-					auto pawn = ent->GetComponent<Pawn>();
+					auto pawn = ent->FindComponent<Pawn>();
 					if (pawn)
 					{
 						if (!rh)
@@ -275,10 +461,15 @@ namespace oxygen
 	{
 		if (type == NetProtoMsgType_SrvChangeLevel)
 		{
+			// The current world keeps running until the next one is ready
 			const auto worldName = std::string_view(
 				reinterpret_cast<const char*>(data.data()), data.size());
-			m_worldName = worldName;
-			m_world = LoadWorld(worldName);
+			m_worldStream = std::make_unique<WorldStream>(worldName);
+			m_queuedPackets.clear();
+		}
+		else if (m_worldStream)
+		{
+			m_queuedPackets.push_back({&conn, type, {data.begin(), data.end()}});
 		}
 		else if (type == NetProtoMsgType_SrvEntitySpawn)
 		{
@@ -452,6 +643,8 @@ namespace oxygen
 	}
 	auto GameManager::ClientDisconnectedFromHost() -> void
 	{
+		m_worldStream.reset();
+		m_queuedPackets.clear();
 		m_world.reset();
 		m_peers.clear();
 		m_entitySpawnHistory.clear();
@@ -471,15 +664,23 @@ namespace oxygen
 			conn.WriteData(NetProtoMsgType_SrvWelcome, buffer);
 		}
 
+		// A peer that connects while the next map streams in is sent it with
+		// everyone else once it is swapped in, not the map being left
+		if (m_worldStream)
+			return;
+		HostSendLevelToPeer(conn.GetUniqueID());
+	}
+	auto GameManager::HostSendLevelToPeer(oxyU64 peerID) -> void
+	{
+		auto& net = NetSystem::GetInstance();
+
 		// send NetProtoMsgType_SrvChangeLevel
 		{
-			std::vector<oxyU8> buffer;
-			buffer.resize(m_worldName.size());
-			std::memcpy(buffer.data(), m_worldName.data(), m_worldName.size());
-			conn.WriteData(NetProtoMsgType_SrvChangeLevel, buffer);
+			std::vector<oxyU8> buffer(m_worldName.begin(), m_worldName.end());
+			net.HostSendTo(peerID, NetProtoMsgType_SrvChangeLevel, buffer);
 		}
 
-		SendPeerEntityHistory(conn);
+		SendPeerEntityHistory(peerID);
 
 		// send (to all) NetProtoMsgType_SrvEntitySpawn
 		{
@@ -491,7 +692,9 @@ namespace oxygen
 			HostSummonEntity(EntitySpawntype_GolfballLauncher, pos,
 							 {0, 0, 0, 1});
 
-			m_peers[conn.GetUniqueID()].m_localPlayer = ent;
+			auto& peer = m_peers[peerID];
+			peer.m_localPlayer = ent;
+			peer.m_loadedIn = true;
 
 			// tell the client to possess it (NetProtoMsgType_SrvSetLocalPlayer)
 			{
@@ -500,7 +703,8 @@ namespace oxygen
 				buffer.resize(sizeof(oxyObjectID));
 				auto* id = reinterpret_cast<oxyObjectID*>(buffer.data());
 				*id = entid;
-				conn.WriteData(NetProtoMsgType_SrvSetLocalPlayer, buffer);
+				net.HostSendTo(peerID, NetProtoMsgType_SrvSetLocalPlayer,
+							   buffer);
 			}
 		}
 	}
@@ -508,7 +712,7 @@ namespace oxygen
 	{
 		m_peers.erase(conn.GetUniqueID());
 	}
-	auto GameManager::SendPeerEntityHistory(NetConnection& conn) -> void
+	auto GameManager::SendPeerEntityHistory(oxyU64 peerID) -> void
 	{
 		for (auto it = m_entitySpawnHistory.begin();
 			 it != m_entitySpawnHistory.end();)
@@ -543,7 +747,8 @@ namespace oxygen
 				{
 					idptr[i] = ids[i];
 				}
-				conn.WriteData(NetProtoMsgType_SrvEntitySpawn, buffer);
+				NetSystem::GetInstance().HostSendTo(
+					peerID, NetProtoMsgType_SrvEntitySpawn, buffer);
 			}
 			++it;
 		}
@@ -741,6 +946,7 @@ namespace oxygen
 				hull->SetGravityPerSecond(700.f);
 				hull->SetDrag(15.5f);
 				hull->SetResponse(CollisionResponseType_Slide);
+				hull->SetStepHeight(18.f);
 
 				auto pawn = ent->AddComponent<Pawn>();
 				pawn->m_thirdPersonMesh = amc;
@@ -803,6 +1009,7 @@ namespace oxygen
 				hull->SetGravityPerSecond(700.f);
 				hull->SetDrag(15.5f);
 				hull->SetResponse(CollisionResponseType_Slide);
+				hull->SetStepHeight(18.f);
 				hull->SetSolidToOtherHulls(false);
 
 				auto weapon =
@@ -862,6 +1069,7 @@ namespace oxygen
 				hull->SetGravityPerSecond(700.f);
 				hull->SetDrag(15.5f);
 				hull->SetResponse(CollisionResponseType_Slide);
+				hull->SetStepHeight(18.f);
 				hull->SetSolidToOtherHulls(false);
 
 				auto weapon =
@@ -9,13 +9,17 @@ namespace oxygen
 	{
 		GameManager();
 
-		auto Render() -> void;
+		// Captures the world into the render snapshot being built
+		auto Render(struct GfxRenderSnapshot& snapshot) -> void;
 		auto Update(float deltaTimeSeconds) -> void;
 
 		auto HostSummonEntity(EntitySpawnType type, const oxyVec3& pos,
 						 const oxyQuat& rot) -> std::shared_ptr<struct Entity>;
 
 		auto HostGame(std::string worldName) -> void;
+		// Loads the next map in the background while this one keeps running,
+		// peers stay connected and follow once it is swapped in
+		auto HostChangeLevel(std::string_view worldName) -> void;
 
 	  private:
 		friend struct NetSystem;
@@ -31,21 +35,26 @@ namespace oxygen
 
 		auto HostNewPeerConnected(struct NetConnection& conn) -> void;
 		auto HostPeerDisconnected(struct NetConnection& conn) -> void;
+		// Sends a peer the current map, what is in it and a player to possess
+		auto HostSendLevelToPeer(oxyU64 peerID) -> void;
 
 		auto SpawnEntityInWorld(
 			EntitySpawnType type, const oxyVec3& pos, const oxyQuat& rot,
 			std::vector<oxyObjectID>& ids) -> std::shared_ptr<struct Entity>;
 
-		auto SendPeerEntityHistory(struct NetConnection& conn) -> void;
+		auto SendPeerEntityHistory(oxyU64 peerID) -> void;
 
 		auto HostSendEntityTransforms() -> void;
 		auto ClientSendEntityTransforms() -> void;
 
 		auto InterpolateEntityTransforms(float deltaTimeSeconds) -> void;
 
+		auto SwapInStreamedWorld() -> void;
+
 
 		struct PeerData
 		{
+			// Set once the peer has been sent the current map
 			oxyBool m_loadedIn{};
 			std::weak_ptr<struct Entity> m_localPlayer;
 		};
@@ -65,10 +74,29 @@ namespace oxygen
 
 		std::string m_worldName;
 		std::shared_ptr<World> m_world;
+		std::unique_ptr<struct WorldStream> m_worldStream;
+
+		// What the host sends after a level change is about the next map, it
+		// waits here until that map is swapped in
+		struct QueuedPacket
+		{
+			struct NetConnection* m_conn;
+			oxyU16 m_type;
+			std::vector<oxyU8> m_data;
+		};
+		std::vector<QueuedPacket> m_queuedPackets;
 
 		std::vector<std::tuple<EntitySpawnType, std::vector<oxyObjectID>, std::weak_ptr<struct Entity>>>
 			m_entitySpawnHistory;
 
 		oxyF32 m_timeUntilNextGolfclubSpawn{3.0f};
+
+		// Set by -logcomponenttimings, 0 when off
+		oxyF32 m_componentTimingLogInterval{};
+		oxyF32 m_timeUntilComponentTimingLog{};
+
+		// Set by -changelevel, empty once the change has started
+		std::string m_changeLevelName;
+		oxyF32 m_timeUntilChangeLevel{};
 	};
 }; // namespace oxygen
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "OxygenPCH.h"
 #include "GfxRenderer.h"
+#include "Job/JobSystem.h"
 #include "GfxSoftwareRasterize.inl"
 
 #include "GameManager/GameManager.h"
 #include "UI/UIManager.h"
+#include "World/World.h"
+#include "Resources/StaticMeshResource.h"
 
 #include "Platform/Platform.h"
 
@@ -17,14 +20,20 @@ namespace oxygen
 			"{}/textures/solidwhite.png", GetExecutableDirectory()));
 		m_fontAtlasTexture = LoadTexture(
 			std::format("{}/textures/glyphs.png", GetExecutableDirectory()));
+		GraphicsAbstraction::GetWindowSize(m_width, m_height);
+
+		m_renderThread = std::jthread(
+			[this](std::stop_token stopToken) { RenderThreadMain(stopToken); });
+	}
+	GfxRenderer::~GfxRenderer()
+	{
+		StopRenderThread();
 	}
 	auto GfxRenderer::LoadTexture(std::string_view texturePath)
 		-> std::shared_ptr<const GfxTexture>
 	{
-		const auto hash = std::hash<std::string_view>{}(texturePath);
-		if (const auto it = m_textures.find(hash); it != m_textures.end())
-			if (const auto texture = it->second.lock(); texture)
-				return texture;
+		if (auto texture = FindTexture(texturePath))
+			return texture;
 
 		auto copy = std::string{texturePath};
 		auto abstracttex = GraphicsAbstraction::LoadTexture(copy.c_str());
@@ -35,7 +44,35 @@ namespace oxygen
 		texture->m_height = abstracttex->m_height;
 		texture->m_texturePath = std::move(copy);
 		texture->m_texture = std::move(abstracttex);
-		m_textures[hash] = texture;
+		m_textures[std::hash<std::string_view>{}(texturePath)] = texture;
+		return texture;
+	}
+	auto GfxRenderer::FindTexture(std::string_view texturePath) const
+		-> std::shared_ptr<const GfxTexture>
+	{
+		const auto hash = std::hash<std::string_view>{}(texturePath);
+		if (const auto it = m_textures.find(hash); it != m_textures.end())
+			return it->second.lock();
+		return {};
+	}
+	auto GfxRenderer::UploadTexture(
+		std::string_view texturePath,
+		const GraphicsAbstraction::DecodedTexture& decoded)
+		-> std::shared_ptr<const GfxTexture>
+	{
+		// Another load may have got there first
+		if (auto texture = FindTexture(texturePath))
+			return texture;
+
+		auto abstracttex = GraphicsAbstraction::UploadTexture(decoded);
+		if (!abstracttex)
+			return {};
+		auto texture = std::make_shared<GfxTexture>();
+		texture->m_width = abstracttex->m_width;
+		texture->m_height = abstracttex->m_height;
+		texture->m_texturePath = std::string{texturePath};
+		texture->m_texture = std::move(abstracttex);
+		m_textures[std::hash<std::string_view>{}(texturePath)] = texture;
 		return texture;
 	}
 
@@ -43,6 +80,33 @@ namespace oxygen
 								  oxyF32 blyndc, const oxyVec3& colour,
 								  oxyF32 spacing, oxyF32 size,
 								  oxyBool center) -> void
+	{
+		if (!m_capture)
+			return;
+		AppendOverlayText(m_capture->m_overlayTris, text, blxndc, blyndc,
+						  colour, spacing, size, center);
+	}
+
+	auto GfxRenderer::OverlayRect(const oxyVec3& col, const oxyVec2& minndc,
+								  const oxyVec2& maxndc) -> void
+	{
+		if (!m_capture)
+			return;
+		AppendOverlayRect(m_capture->m_overlayTris, col, minndc, maxndc);
+	}
+
+	auto GfxRenderer::CaptureMesh(GfxMeshInstance&& mesh) -> void
+	{
+		if (!m_capture)
+			return;
+		m_capture->m_meshes.push_back(std::move(mesh));
+	}
+
+	auto GfxRenderer::AppendOverlayText(std::vector<GfxTri>& out,
+										std::string_view text, oxyF32 blxndc,
+										oxyF32 blyndc, const oxyVec3& colour,
+										oxyF32 spacing, oxyF32 size,
+										oxyBool center) const -> void
 	{
 		const auto& fontAtlas = m_fontAtlasTexture;
 
@@ -87,13 +151,15 @@ namespace oxygen
 			b.m_colour = colour;
 			b.m_texture = fontAtlas.get();
 
-			SubmitTriToQueue(a, GfxRenderStrategy_DirectToGPU);
-			SubmitTriToQueue(b, GfxRenderStrategy_DirectToGPU);
+			out.push_back(a);
+			out.push_back(b);
 		}
 	}
 
-	auto GfxRenderer::OverlayRect(const oxyVec3& col, const oxyVec2& minndc,
-								  const oxyVec2& maxndc) -> void
+	auto GfxRenderer::AppendOverlayRect(std::vector<GfxTri>& out,
+										const oxyVec3& col,
+										const oxyVec2& minndc,
+										const oxyVec2& maxndc) const -> void
 	{
 		GfxTri a{}, b{};
 		a.m_vertices[0].m_position = {minndc.x, minndc.y, 0.f, 1.f};
@@ -106,8 +172,133 @@ namespace oxygen
 		b.m_vertices[2].m_position = {minndc.x, maxndc.y, 0.f, 1.f};
 		b.m_colour = col;
 		b.m_texture = m_whiteSolidTexture.get();
-		SubmitTriToQueue(a, GfxRenderStrategy_DirectToGPU);
-		SubmitTriToQueue(b, GfxRenderStrategy_DirectToGPU);
+		out.push_back(a);
+		out.push_back(b);
+	}
+
+	auto GfxRenderer::CaptureFrame(oxyS32 w, oxyS32 h) -> void
+	{
+		if (w < 0 || h < 0)
+			return;
+		m_width = w;
+		m_height = h;
+
+		// Whatever the previous occupant of this buffer held (possibly the
+		// last reference to a world) is released here, on this thread
+		auto& snapshot = m_snapshots.GetWriteBuffer();
+		snapshot.m_width = w;
+		snapshot.m_height = h;
+		snapshot.m_showStats = m_showStats;
+		snapshot.m_world.reset();
+		snapshot.m_hasCamera = false;
+		snapshot.m_lateLatch = false;
+		snapshot.m_meshes.clear();
+		snapshot.m_meshLeaves.clear();
+		snapshot.m_overlayTris.clear();
+
+		m_capture = &snapshot;
+		GameManager::GetInstance().Render(snapshot);
+		UIManager::GetInstance().Render();
+		m_capture = nullptr;
+
+		m_snapshots.Publish();
+		m_snapshotsPublished.fetch_add(1, std::memory_order_release);
+		m_snapshotsPublished.notify_one();
+	}
+
+	auto GfxRenderer::Present() -> void
+	{
+		// Without a new frame the last one is drawn again
+		const auto fresh = m_drawLists.Acquire();
+		const auto& drawList = m_drawLists.GetReadBuffer();
+		for (const auto& quad : drawList.m_quads)
+			GraphicsAbstraction::DrawTexturedQuad(quad);
+		if (!fresh)
+			return;
+
+		// Everything for this frame has been handed to the backend, treat
+		// that as the photon time
+		const auto now = std::chrono::steady_clock::now();
+		const auto ToMs = [](auto duration) {
+			return std::chrono::duration<oxyF32, std::milli>(duration).count();
+		};
+		const auto Smooth = [](std::atomic<oxyF32>& stat, oxyF32 sample) {
+			constexpr auto k_statSmoothing = 0.1f;
+			const auto current = stat.load(std::memory_order_relaxed);
+			stat.store(current + (sample - current) * k_statSmoothing,
+					   std::memory_order_relaxed);
+		};
+		if (drawList.m_inputSampleTime.time_since_epoch().count())
+			Smooth(m_inputToPhotonMs, ToMs(now - drawList.m_inputSampleTime));
+		if (m_lastPresentTime.time_since_epoch().count())
+			Smooth(m_frameTimeMs, ToMs(now - m_lastPresentTime));
+		m_lastPresentTime = now;
+	}
+
+	auto GfxRenderer::StopRenderThread() -> void
+	{
+		if (!m_renderThread.joinable())
+			return;
+		m_renderThread.request_stop();
+		m_snapshotsPublished.fetch_add(1, std::memory_order_release);
+		m_snapshotsPublished.notify_one();
+		m_renderThread.join();
+
+		// Drop the captured worlds and meshes now, while everything they
+		// reference is still around
+		m_snapshots.Reset();
+		m_drawLists.Reset();
+	}
+
+	auto GfxRenderer::RenderThreadMain(std::stop_token stopToken) -> void
+	{
+		// Keeps the raster jobs submitted here out of the simulation
+		// thread's waits and the other way around
+		JobSystem::GetInstance().RegisterThread();
+		oxyU64 seen{};
+		while (!stopToken.stop_requested())
+		{
+			m_snapshotsPublished.wait(seen, std::memory_order_acquire);
+			seen = m_snapshotsPublished.load(std::memory_order_acquire);
+			if (stopToken.stop_requested())
+				break;
+			// Several may have been published since, only the latest counts
+			if (!m_snapshots.Acquire())
+				continue;
+			RenderSnapshot(m_snapshots.GetReadBuffer());
+		}
+	}
+
+	auto GfxRenderer::RenderSnapshot(const GfxRenderSnapshot& snapshot) -> void
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		BeginFrame(snapshot);
+		if (snapshot.m_world)
+			snapshot.m_world->SubmitBSPFacesToRenderQueue(snapshot);
+		for (const auto& tri : snapshot.m_overlayTris)
+			SubmitTriToQueue(tri, GfxRenderStrategy_DirectToGPU);
+		EndFrame();
+		m_drawLists.Publish();
+
+		const auto elapsedMs = std::chrono::duration<oxyF32, std::milli>(
+								   std::chrono::steady_clock::now() - start)
+								   .count();
+		constexpr auto k_statSmoothing = 0.1f;
+		const auto current = m_renderThreadMs.load(std::memory_order_relaxed);
+		m_renderThreadMs.store(current + (elapsedMs - current) * k_statSmoothing,
+							   std::memory_order_relaxed);
+	}
+
+	auto GfxRenderer::EmitQuad(GraphicsAbstraction::TexturedQuad& quad,
+							   const GfxTexture* texture) -> void
+	{
+		if (!texture)
+			texture = m_errorTexture.get();
+		quad.m_texture = texture->m_texture.get();
+		if (m_drawListTextures.insert(quad.m_texture).second)
+			m_drawList->m_textures.push_back(texture->m_texture);
+		m_drawList->m_quads.push_back(quad);
 	}
 
 	auto GfxRenderer::EndFrame() -> void
@@ -116,7 +307,7 @@ namespace oxygen
 		oxySize numtrirastered{};
 		oxyU32 rasterWidth = m_softwareWidth;
 		oxyU32 rasterHeight = m_softwareHeight;
-		std::future<void> rasterFuture = std::async([&]() {
+		const auto Raster = [&]() {
 			std::vector<BBox> unsortedBBoxes;
 			unsortedBBoxes.reserve(m_triQueueSoftwareDepthRasterize.size());
 			for (const auto& tri : m_triQueueSoftwareDepthRasterize)
@@ -140,38 +331,35 @@ namespace oxygen
 		
 			// TODO: bsp culling of dynamic meshes
 			#if 1
-			for (oxySize i = 0;
-				 i < m_triQueueSoftwareDepthRasterizePreSorted.size(); ++i)
+			for (const auto& quad : m_quadQueueSoftwareDepthRasterizePreSorted)
 			{
-				const auto bbox =
-					NDCTriToBBox(m_triQueueSoftwareDepthRasterizePreSorted[i]);
-				const auto minDepth =
-					std::min({m_triQueueSoftwareDepthRasterizePreSorted[i]
-								  .m_vertices[0]
-								  .m_position.z,
-							  m_triQueueSoftwareDepthRasterizePreSorted[i]
-								  .m_vertices[1]
-								  .m_position.z,
-							  m_triQueueSoftwareDepthRasterizePreSorted[i]
-								  .m_vertices[2]
-								  .m_position.z});
+				const auto bbox = NDCQuadToBBox(quad);
+				auto minDepth = quad.m_vertices[0].m_position.z;
+				for (oxyU32 v = 1; v < quad.m_vertexCount; ++v)
+					minDepth = std::min(minDepth, quad.m_vertices[v].m_position.z);
 				for (oxySize j = 0; j < unsortedBBoxes.size(); ++j)
 				{
-					// If the triangle overlaps the bbox and the min depth
+					// If the quad overlaps the bbox and the min depth
 					// is less than the max depth of the bbox
 					if (unsortedBBoxes[j].Overlaps(bbox) &&
 						minDepth < unsortedBBoxes[j].m_maxDepth)
 					{
-						GfxSoftwareRasterizer::RasterTriNoDepthCompare(
-							m_triQueueSoftwareDepthRasterizePreSorted[i],
-							rasterWidth, rasterHeight, m_zbuffer.get(), 0, 0,
-							rasterWidth - 1, rasterHeight);
-						numtrisortedraster++;
+						MarkDirtyTiles(bbox);
+						for (oxyU32 t = 0; t < quad.GetTriCount(); ++t)
+						{
+							GfxSoftwareRasterizer::RasterTriNoDepthCompare(
+								quad.GetTri(t), rasterWidth, rasterHeight,
+								m_zbuffer.get(), 0, 0, rasterWidth - 1,
+								rasterHeight);
+							numtrisortedraster++;
+						}
 						break;
 					}
 				}
 			}
 		
+			for (const auto& bbox : unsortedBBoxes)
+				MarkDirtyTiles(bbox);
 			for (oxyS16 dynamicTriID = -1;
 				 const auto& tri : m_triQueueSoftwareDepthRasterize)
 			{
@@ -181,54 +369,82 @@ namespace oxygen
 					rasterHeight);
 			}
 			#endif
-		});
+		};
+		JobCounter rasterDone;
+		JobSystem::GetInstance().Run(Raster, rasterDone);
 
-		if (m_triQueueSoftwareDepthRasterizePreSortedOverlay.size())
+		if (m_quadQueueSoftwareDepthRasterizePreSortedOverlay.size())
 		{
 			const auto cnt =
-				m_triQueueSoftwareDepthRasterizePreSortedOverlay.size();
-			OXYCHECK(cnt == m_triQueueSoftwareDepthRasterizePreSorted.size());
+				m_quadQueueSoftwareDepthRasterizePreSortedOverlay.size();
+			OXYCHECK(cnt == m_quadQueueSoftwareDepthRasterizePreSorted.size());
 			for (oxySize i = 0; i < cnt; ++i)
 			{
-				DrawPreSortedTri(m_triQueueSoftwareDepthRasterizePreSorted[i]);
-				DrawPreSortedTri(
-					m_triQueueSoftwareDepthRasterizePreSortedOverlay[i]);
+				DrawPreSortedQuad(m_quadQueueSoftwareDepthRasterizePreSorted[i]);
+				DrawPreSortedQuad(
+					m_quadQueueSoftwareDepthRasterizePreSortedOverlay[i]);
 			}
 		}
 		else
 		{
-			for (const auto& tri : m_triQueueSoftwareDepthRasterizePreSorted)
-				DrawPreSortedTri(tri);
+			for (const auto& quad : m_quadQueueSoftwareDepthRasterizePreSorted)
+				DrawPreSortedQuad(quad);
 		}
 
 		
 
-		rasterFuture.wait();
+		JobSystem::GetInstance().Wait(rasterDone);
 
 		if (numtrirastered)
 			DrawSpans(rasterWidth, rasterHeight);
-		#if 0
-		const auto numtrisortrasttxt =
-			std::format("Num tris sorted raster: {}", numtrisortedraster);
-		const auto numtrirasttxt =
-			std::format("Num tris rastered: {}", numtrirastered);
-		const auto numsortedtxt =
-			std::format("Num sorted tris: {}",
-						m_triQueueSoftwareDepthRasterizePreSorted.size());
-		const auto numunsortedtxt = std::format(
-			"Num unsorted tris: {}", m_triQueueSoftwareDepthRasterize.size());
-		OverlayText(numtrisortrasttxt, 0.f, .9f, {1.f, 1.f, 1.f}, 0.025f,
-					0.05f, true);
-		OverlayText(numtrirasttxt, 0.f, .85f, {1.f, 1.f, 1.f}, 0.025f, 0.05f, true);
-		OverlayText(numsortedtxt, 0.f, .8f, {1.f, 1.f, 1.f}, 0.025f, 0.05f, true);
-		OverlayText(numunsortedtxt, 0.f, .75f, {1.f, 1.f, 1.f}, 0.025f, 0.05f, true);
-
-		// this kinda is a lie...
-		const auto numoverlaytxt =
-			std::format("Overlay: {}", m_triQueueDirectToGPU.size());
-		OverlayText(numoverlaytxt, 0.f, .7f, {1.f, 1.f, 1.f}, 0.025f, 0.05f,
-					true);
-		#endif
+		if (m_renderShowStats)
+		{
+			const auto Stat = [&](std::string_view text, oxyF32 y) {
+				AppendOverlayText(m_triQueueDirectToGPU, text, 0.f, y,
+								  {1.f, 1.f, 1.f}, 0.025f, 0.05f, true);
+			};
+			const auto numtrisortrasttxt =
+				std::format("Num tris sorted raster: {}", numtrisortedraster);
+			const auto numtrirasttxt =
+				std::format("Num tris rastered: {}", numtrirastered);
+			const auto numsortedtxt =
+				std::format("Num sorted quads: {}",
+							m_quadQueueSoftwareDepthRasterizePreSorted.size());
+			const auto numunsortedtxt = std::format(
+				"Num unsorted tris: {}", m_triQueueSoftwareDepthRasterize.size());
+			Stat(numtrisortrasttxt, .9f);
+			Stat(numtrirasttxt, .85f);
+			Stat(numsortedtxt, .8f);
+			Stat(numunsortedtxt, .75f);
+			const auto numdirtytxt = std::format(
+				"Dirty tiles: {}/{}",
+				std::count(m_dirtyTiles.begin(), m_dirtyTiles.end(), 1),
+				m_dirtyTiles.size());
+			Stat(numdirtytxt, .65f);
+
+			// this kinda is a lie...
+			const auto numoverlaytxt =
+				std::format("Overlay: {}", m_triQueueDirectToGPU.size());
+			Stat(numoverlaytxt, .7f);
+			const auto inputToPhotonMs =
+				m_inputToPhotonMs.load(std::memory_order_relaxed);
+			const auto frameTimeMs =
+				m_frameTimeMs.load(std::memory_order_relaxed);
+			const auto latencytxt = std::format(
+				"Input to photon: {:.2f}ms ({:.2f} frames) late latch: {}",
+				inputToPhotonMs,
+				frameTimeMs > 0.f ? inputToPhotonMs / frameTimeMs : 0.f,
+				m_renderLateLatch ? "on" : "off");
+			Stat(latencytxt, .55f);
+			const auto nummeshestxt =
+				std::format("Meshes visible: {} culled: {}", m_numMeshesVisible,
+							m_numMeshesCulled);
+			Stat(nummeshestxt, .6f);
+			const auto renderthreadtxt = std::format(
+				"Render thread: {:.2f}ms frame: {:.2f}ms",
+				m_renderThreadMs.load(std::memory_order_relaxed), frameTimeMs);
+			Stat(renderthreadtxt, .95f);
+		}
 
 		for (auto& tri : m_triQueueDirectToGPU)
 		{
@@ -242,12 +458,10 @@ namespace oxygen
 			quad.m_textureCoords[2] = tri.m_vertices[2].m_uv;
 			quad.m_textureCoords[3] = tri.m_vertices[2].m_uv;
 			quad.m_colour = tri.m_colour;
-			auto tex = tri.m_texture;
-			if (!tex)
-				tex = m_errorTexture.get();
-			quad.m_texture = tex->m_texture.get();
-			GraphicsAbstraction::DrawTexturedQuad(quad);
+			EmitQuad(quad, tri.m_texture);
 		}
+
+		m_drawList->m_inputSampleTime = m_viewInputSampleTime;
 	}
 
 	auto GfxRenderer::SubmitTriToQueue(const GfxTri& tri,
@@ -282,7 +496,12 @@ namespace oxygen
 				tri.m_vertices[0].m_position.z *= zmult;
 				tri.m_vertices[1].m_position.z *= zmult;
 				tri.m_vertices[2].m_position.z *= zmult;
-				m_triQueueSoftwareDepthRasterizePreSorted.push_back(tri);
+				auto& quad = m_quadQueueSoftwareDepthRasterizePreSorted.emplace_back();
+				std::copy_n(tri.m_vertices, 3, quad.m_vertices);
+				quad.m_colour = tri.m_colour;
+				quad.m_texture = tri.m_texture;
+				quad.m_cullType = tri.m_cullType;
+				quad.m_vertexCount = 3;
 			};
 			if (clipAnd == ClipCode_None)
 			{
@@ -313,7 +532,13 @@ namespace oxygen
 				tri.m_vertices[0].m_position.z *= zmult;
 				tri.m_vertices[1].m_position.z *= zmult;
 				tri.m_vertices[2].m_position.z *= zmult;
-				m_triQueueSoftwareDepthRasterizePreSortedOverlay.push_back(tri);
+				auto& quad =
+					m_quadQueueSoftwareDepthRasterizePreSortedOverlay.emplace_back();
+				std::copy_n(tri.m_vertices, 3, quad.m_vertices);
+				quad.m_colour = tri.m_colour;
+				quad.m_texture = tri.m_texture;
+				quad.m_cullType = tri.m_cullType;
+				quad.m_vertexCount = 3;
 			};
 			if (clipAnd == ClipCode_None)
 			{
@@ -357,33 +582,170 @@ namespace oxygen
 		}
 	}
 
-	auto GfxRenderer::BeginFrame(oxyS32 w, oxyS32 h) -> void
+	auto GfxRenderer::SubmitQuadToQueue(const GfxQuad& quad,
+										GfxRenderStrategy mode,
+										oxyF32 zmult) -> void
 	{
-		if (w < 0 || h < 0)
+		const auto SubmitAsTris = [&]() {
+			for (oxyU32 t = 0; t < quad.GetTriCount(); ++t)
+				SubmitTriToQueue(quad.GetTri(t), mode, zmult);
+		};
+		if (quad.m_vertexCount != 4 ||
+			(mode != GfxRenderStrategy_SoftwareDepthRasterizePreSorted &&
+			 mode != GfxRenderStrategy_SoftwareDepthRasterizePreSortedOverlay))
+		{
+			SubmitAsTris();
+			return;
+		}
+
+		if (CullClipSpaceQuad(quad))
+			return;
+
+		std::underlying_type_t<ClipCode> clipOr = ClipCode_None;
+		for (const auto& vtx : quad.m_vertices)
+		{
+			if (vtx.m_position.z < -vtx.m_position.w)
+				clipOr |= ClipCode_Near;
+			if (vtx.m_position.z > vtx.m_position.w)
+				clipOr |= ClipCode_Far;
+		}
+		// Straddles the frustum, only this quad falls back to triangles
+		if (clipOr != ClipCode_None)
+		{
+			SubmitAsTris();
 			return;
-		if (w != m_width || h != m_height)
-			HandleResize(w, h);
+		}
+
+		auto ndcquad = quad;
+		if (ConvertQuadToNDCAndCull(ndcquad))
+			return;
+		for (auto& vtx : ndcquad.m_vertices)
+			vtx.m_position.z *= zmult;
+		if (mode == GfxRenderStrategy_SoftwareDepthRasterizePreSorted)
+			m_quadQueueSoftwareDepthRasterizePreSorted.push_back(ndcquad);
+		else
+			m_quadQueueSoftwareDepthRasterizePreSortedOverlay.push_back(ndcquad);
+	}
+
+	auto GfxRenderer::GetFrustumPlanes(oxyVec4 (&planes)[6]) const -> void
+	{
+		// clip = v * vp, so column j of vp gives clip component j, each
+		// plane is w +- component
+		const auto& m = m_viewProjectionMatrix;
+		const auto Column = [&](int j) -> oxyVec4 {
+			return {m[0][j], m[1][j], m[2][j], m[3][j]};
+		};
+		const auto x = Column(0);
+		const auto y = Column(1);
+		const auto z = Column(2);
+		const auto w = Column(3);
+		planes[0] = w + z; // Near
+		planes[1] = w - z; // Far
+		planes[2] = w - y; // Top
+		planes[3] = w + y; // Bottom
+		planes[4] = w - x; // Right
+		planes[5] = w + x; // Left
+	}
+
+	auto GfxRenderer::IsSphereInFrustum(const oxyVec3& center,
+										oxyF32 radius) const -> oxyBool
+	{
+		oxyVec4 planes[6];
+		GetFrustumPlanes(planes);
+		for (const auto& plane : planes)
+		{
+			const auto normal = oxyVec3{plane.x, plane.y, plane.z};
+			const auto len = normal.Magnitude();
+			if (len <= 0.f)
+				continue;
+			if (normal.DotProduct(center) + plane.w < -radius * len)
+				return false;
+		}
+		return true;
+	}
+
+	auto GfxRenderer::IsBoxInFrustum(const oxyVec3& mins,
+									 const oxyVec3& maxs) const -> oxyBool
+	{
+		oxyVec4 planes[6];
+		GetFrustumPlanes(planes);
+		for (const auto& plane : planes)
+		{
+			// corner furthest along the plane normal
+			const auto corner = oxyVec3{plane.x >= 0.f ? maxs.x : mins.x,
+										plane.y >= 0.f ? maxs.y : mins.y,
+										plane.z >= 0.f ? maxs.z : mins.z};
+			if (oxyVec3{plane.x, plane.y, plane.z}.DotProduct(corner) +
+					plane.w <
+				0.f)
+				return false;
+		}
+		return true;
+	}
+
+	auto GfxRenderer::BeginFrame(const GfxRenderSnapshot& snapshot) -> void
+	{
+		if (snapshot.m_width != m_renderWidth ||
+			snapshot.m_height != m_renderHeight)
+			HandleResize(snapshot.m_width, snapshot.m_height);
 
 		m_frameCounter++;
-		m_triQueueSoftwareDepthRasterizePreSorted.clear();
-		m_triQueueSoftwareDepthRasterizePreSortedOverlay.clear();
+		m_quadQueueSoftwareDepthRasterizePreSorted.clear();
+		m_quadQueueSoftwareDepthRasterizePreSortedOverlay.clear();
 		m_triQueueSoftwareDepthRasterize.clear();
 		m_triQueueDirectToGPU.clear();
-		std::fill_n(m_zbuffer.get(), m_softwareWidth * m_softwareHeight, 1.0f);
-		std::fill_n(m_tribuffer.get(), m_softwareWidth * m_softwareHeight, -1);
+		ClearDirtyTiles();
+		m_numMeshesVisible = 0;
+		m_numMeshesCulled = 0;
+		m_renderShowStats = snapshot.m_showStats;
+		m_renderLateLatch = snapshot.m_lateLatch;
+		m_viewProjectionMatrix = snapshot.m_viewProjectionMatrix;
+		m_viewInputSampleTime = snapshot.m_inputSampleTime;
 
-		GameManager::GetInstance().Render();
-		UIManager::GetInstance().Render();
+		// Textures dropped here may be the last reference, the platform
+		// defers the actual release to the GL thread
+		m_drawList = &m_drawLists.GetWriteBuffer();
+		m_drawList->m_quads.clear();
+		m_drawList->m_textures.clear();
+		m_drawListTextures.clear();
 	}
 
-	//
-	// TODO:
-	// Potential optimization:
-	// There's CPU downtime between Update and Render,
-	// Once Update is done, another thread could be started to iterate tris
-	// and raster depth and such. Then Render would just wait for that to be
-	// done (if it isn't already) and then draw the spans.
-	//
+	auto GfxRenderer::SubmitMeshInstance(const GfxMeshInstance& mesh) -> void
+	{
+		const auto mvp = mesh.m_worldMatrix * m_viewProjectionMatrix;
+		oxySize vertIndex{};
+		for (const auto& tri : mesh.m_mesh->m_tris)
+		{
+			GfxTri gfxtri;
+			for (auto i = 0; i < 3; ++i, ++vertIndex)
+			{
+				oxyVec4 pos{tri.m_vertices[i].m_position, 1.f};
+				if (mesh.m_currentFrame)
+				{
+					const auto curvt = (*mesh.m_currentFrame)[vertIndex];
+					if (mesh.m_nextFrame)
+					{
+						const auto nextvt = (*mesh.m_nextFrame)[vertIndex];
+						const auto lerpvt =
+							(nextvt - curvt) * mesh.m_lerpAlpha + curvt;
+						pos = {lerpvt.x, lerpvt.y, lerpvt.z, 1.f};
+					}
+					else
+					{
+						pos = {curvt.x, curvt.y, curvt.z, 1.f};
+					}
+				}
+				gfxtri.m_vertices[i].m_position = pos * mvp;
+				gfxtri.m_vertices[i].m_uv = tri.m_vertices[i].m_uv;
+			}
+			gfxtri.m_colour = {1.f, 1.f, 1.f};
+			gfxtri.m_texture = mesh.m_texture.get();
+			gfxtri.m_cullType =
+				GfxCullType_Frontface; // the winding order appears to be... not
+									   // what i expected!
+			SubmitTriToQueue(gfxtri, GfxRenderStrategy_SoftwareDepthRasterize);
+		}
+	}
 
 	template <typename Fun>
 	auto GfxRenderer::ClipTri(const GfxTri& tri, ClipCode clipcode,
@@ -501,6 +863,38 @@ namespace oxygen
 		return false;
 	}
 
+	auto GfxRenderer::CullClipSpaceQuad(const GfxQuad& quad) -> bool
+	{
+		// Same as CullClipSpaceTri, all four vertices outside one plane
+		const auto AllOutside = [&](auto&& outside) {
+			return std::all_of(std::begin(quad.m_vertices),
+							   std::end(quad.m_vertices),
+							   [&](const GfxVertex& v) {
+								   return outside(v.m_position);
+							   });
+		};
+		// Near plane
+		if (AllOutside([](const oxyVec4& p) { return p.z < -p.w; }))
+			return true;
+		// Far plane
+		if (AllOutside([](const oxyVec4& p) { return p.z > p.w; }))
+			return true;
+		// Top plane
+		if (AllOutside([](const oxyVec4& p) { return p.y > p.w; }))
+			return true;
+		// Bottom plane
+		if (AllOutside([](const oxyVec4& p) { return p.y < -p.w; }))
+			return true;
+		// Right plane
+		if (AllOutside([](const oxyVec4& p) { return p.x > p.w; }))
+			return true;
+		// Left plane
+		if (AllOutside([](const oxyVec4& p) { return p.x < -p.w; }))
+			return true;
+
+		return false;
+	}
+
 	auto GfxRenderer::ConvertTriToNDCAndCull(GfxTri& tri) -> bool
 	{
 		tri.m_vertices[0].m_position.x /= tri.m_vertices[0].m_position.w;
@@ -527,37 +921,55 @@ namespace oxygen
 		return false;
 	}
 
-	auto GfxRenderer::DrawPreSortedTri(const GfxTri& tri) -> void
+	auto GfxRenderer::ConvertQuadToNDCAndCull(GfxQuad& quad) -> bool
 	{
-		GraphicsAbstraction::TexturedQuad quad;
-		quad.m_vertices[0] = {-1.f * tri.m_vertices[0].m_position.x,
-							  tri.m_vertices[0].m_position.y};
-		quad.m_vertices[1] = {-1.f * tri.m_vertices[1].m_position.x,
-							  tri.m_vertices[1].m_position.y};
-		quad.m_vertices[2] = {-1.f * tri.m_vertices[2].m_position.x,
-							  tri.m_vertices[2].m_position.y};
-		quad.m_vertices[3] = {-1.f * tri.m_vertices[2].m_position.x,
-							  tri.m_vertices[2].m_position.y};
-		quad.m_textureCoords[0] = tri.m_vertices[0].m_uv;
-		quad.m_textureCoords[1] = tri.m_vertices[1].m_uv;
-		quad.m_textureCoords[2] = tri.m_vertices[2].m_uv;
-		quad.m_textureCoords[3] = tri.m_vertices[2].m_uv;
-		quad.m_colour = tri.m_colour;
-		auto tex = tri.m_texture;
-		if (!tex)
-			tex = m_errorTexture.get();
-		quad.m_texture = tex->m_texture.get();
-		GraphicsAbstraction::DrawTexturedQuad(quad);
+		for (auto& vtx : quad.m_vertices)
+		{
+			vtx.m_position.x /= vtx.m_position.w;
+			vtx.m_position.y /= vtx.m_position.w;
+			vtx.m_position.z /= vtx.m_position.w;
+		}
+
+		if (quad.m_cullType == GfxCullType::GfxCullType_Backface)
+			if (QuadWindingZ(quad) < 0)
+				return true;
+
+		if (quad.m_cullType == GfxCullType::GfxCullType_Frontface)
+			if (QuadWindingZ(quad) > 0)
+				return true;
+
+		return false;
+	}
+
+	auto GfxRenderer::DrawPreSortedQuad(const GfxQuad& quad) -> void
+	{
+		// Triangles go down as degenerate quads (v3 = v2)
+		const auto& v3 = quad.m_vertices[quad.m_vertexCount == 4 ? 3 : 2];
+		GraphicsAbstraction::TexturedQuad texquad;
+		texquad.m_vertices[0] = {-1.f * quad.m_vertices[0].m_position.x,
+								 quad.m_vertices[0].m_position.y};
+		texquad.m_vertices[1] = {-1.f * quad.m_vertices[1].m_position.x,
+								 quad.m_vertices[1].m_position.y};
+		texquad.m_vertices[2] = {-1.f * quad.m_vertices[2].m_position.x,
+								 quad.m_vertices[2].m_position.y};
+		texquad.m_vertices[3] = {-1.f * v3.m_position.x, v3.m_position.y};
+		texquad.m_textureCoords[0] = quad.m_vertices[0].m_uv;
+		texquad.m_textureCoords[1] = quad.m_vertices[1].m_uv;
+		texquad.m_textureCoords[2] = quad.m_vertices[2].m_uv;
+		texquad.m_textureCoords[3] = v3.m_uv;
+		texquad.m_colour = quad.m_colour;
+		EmitQuad(texquad, quad.m_texture);
 	}
 
 	auto GfxRenderer::DrawSpans(oxyU16 width, oxyU16 height) -> void
 	{
-		for (oxyU16 y = 0; y < height; ++y)
-		{
+		// Only dirty tiles can hold a tri ID, everything else is still -1
+		// from the clear, so scan runs of adjacent dirty tiles per tile row
+		const auto ScanRow = [&](oxyU16 y, oxyU16 xbegin, oxyU16 xend) {
 			oxyU16 x0 = -1;
 			oxyU16 x1 = -1;
 			oxyS16 triID = -1;
-			for (oxyU16 x = 0; x < width; ++x)
+			for (oxyU16 x = xbegin; x < xend; ++x)
 			{
 				const auto curID = m_tribuffer[y * width + x];
 				if (curID != triID)
@@ -582,6 +994,27 @@ namespace oxygen
 				// Draw span y x0 x1
 				DrawSpan(*GetTriFromID(triID), y, x0, x1, width, height);
 			}
+		};
+
+		for (oxyS32 ty = 0; ty < m_dirtyTilesY; ++ty)
+		{
+			const auto y0 = ty * k_dirtyTileSize;
+			const auto y1 = std::min<oxyS32>(y0 + k_dirtyTileSize, height);
+			for (oxyS32 tx = 0; tx < m_dirtyTilesX;)
+			{
+				if (!m_dirtyTiles[ty * m_dirtyTilesX + tx])
+				{
+					++tx;
+					continue;
+				}
+				const auto runBegin = tx;
+				while (tx < m_dirtyTilesX && m_dirtyTiles[ty * m_dirtyTilesX + tx])
+					++tx;
+				const auto x0 = runBegin * k_dirtyTileSize;
+				const auto x1 = std::min<oxyS32>(tx * k_dirtyTileSize, width);
+				for (auto y = y0; y < y1; ++y)
+					ScanRow(y, x0, x1);
+			}
 		}
 	}
 
@@ -662,17 +1095,13 @@ namespace oxygen
 			bary3[0] * v0.m_uv.x + bary3[1] * v1.m_uv.x + bary3[2] * v2.m_uv.x,
 			bary3[0] * v0.m_uv.y + bary3[1] * v1.m_uv.y + bary3[2] * v2.m_uv.y};
 		quad.m_colour = tri.m_colour;
-		auto tex = tri.m_texture;
-		if (!tex)
-			tex = m_errorTexture.get();
-		quad.m_texture = tex->m_texture.get();
-		GraphicsAbstraction::DrawTexturedQuad(quad);
+		EmitQuad(quad, tri.m_texture);
 	}
 
 	auto GfxRenderer::HandleResize(oxyS32 w, oxyS32 h) -> void
 	{
-		m_width = w;
-		m_height = h;
+		m_renderWidth = w;
+		m_renderHeight = h;
 #ifdef OXYBUILDDEBUG
 		m_softwareWidth = 400;
 		m_softwareHeight = 300;
@@ -684,48 +1113,95 @@ namespace oxygen
 			std::make_unique<oxyF32[]>(m_softwareWidth * m_softwareHeight);
 		m_tribuffer =
 			std::make_unique<oxyS16[]>(m_softwareWidth * m_softwareHeight);
+
+		// Fresh buffers, everything needs clearing
+		m_dirtyTilesX = (m_softwareWidth + k_dirtyTileSize - 1) / k_dirtyTileSize;
+		m_dirtyTilesY =
+			(m_softwareHeight + k_dirtyTileSize - 1) / k_dirtyTileSize;
+		m_dirtyTiles.assign(m_dirtyTilesX * m_dirtyTilesY, 1);
+	}
+
+	auto GfxRenderer::MarkDirtyTiles(const BBox& bbox) -> void
+	{
+		if (bbox.m_x1 < bbox.m_x0 || bbox.m_y1 < bbox.m_y0)
+			return;
+		const auto tx0 = std::clamp(bbox.m_x0 / k_dirtyTileSize, 0,
+									m_dirtyTilesX - 1);
+		const auto ty0 = std::clamp(bbox.m_y0 / k_dirtyTileSize, 0,
+									m_dirtyTilesY - 1);
+		const auto tx1 = std::clamp(bbox.m_x1 / k_dirtyTileSize, 0,
+									m_dirtyTilesX - 1);
+		const auto ty1 = std::clamp(bbox.m_y1 / k_dirtyTileSize, 0,
+									m_dirtyTilesY - 1);
+		for (auto ty = ty0; ty <= ty1; ++ty)
+			std::fill(m_dirtyTiles.begin() + ty * m_dirtyTilesX + tx0,
+					  m_dirtyTiles.begin() + ty * m_dirtyTilesX + tx1 + 1, 1);
+	}
+
+	auto GfxRenderer::ClearDirtyTiles() -> void
+	{
+		for (oxyS32 ty = 0; ty < m_dirtyTilesY; ++ty)
+		{
+			const auto y0 = ty * k_dirtyTileSize;
+			const auto y1 = std::min(y0 + k_dirtyTileSize, m_softwareHeight);
+			for (oxyS32 tx = 0; tx < m_dirtyTilesX; ++tx)
+			{
+				auto& dirty = m_dirtyTiles[ty * m_dirtyTilesX + tx];
+				if (!dirty)
+					continue;
+				dirty = 0;
+				const auto x0 = tx * k_dirtyTileSize;
+				const auto count =
+					std::min(x0 + k_dirtyTileSize, m_softwareWidth) - x0;
+				for (auto y = y0; y < y1; ++y)
+				{
+					std::fill_n(m_zbuffer.get() + y * m_softwareWidth + x0,
+								count, 1.0f);
+					std::fill_n(m_tribuffer.get() + y * m_softwareWidth + x0,
+								count, -1);
+				}
+			}
+		}
 	}
 
 	auto GfxRenderer::NDCTriToBBox(const GfxTri& tri) -> BBox
+	{
+		return NDCVerticesToBBox(tri.m_vertices, std::size(tri.m_vertices));
+	}
+
+	auto GfxRenderer::NDCQuadToBBox(const GfxQuad& quad) -> BBox
+	{
+		return NDCVerticesToBBox(quad.m_vertices, quad.m_vertexCount);
+	}
+
+	auto GfxRenderer::NDCVerticesToBBox(const GfxVertex* vertices,
+										oxySize count) -> BBox
 	{
 		BBox ret;
-		oxyVec2 screenSpaceVerts[3];
-		for (auto i = 0; i < 3; ++i)
+		oxyS16 minx = (std::numeric_limits<oxyS16>::max)();
+		oxyS16 miny = (std::numeric_limits<oxyS16>::max)();
+		oxyS16 maxx = (std::numeric_limits<oxyS16>::min)();
+		oxyS16 maxy = (std::numeric_limits<oxyS16>::min)();
+		oxyF32 maxDepth = vertices[0].m_position.z;
+		for (oxySize i = 0; i < count; ++i)
 		{
-			const auto& vert = tri.m_vertices[i];
-			const auto x = (vert.m_position.x + 1.f) * 0.5f * m_softwareWidth;
-			const auto y = (1.f - vert.m_position.y) * 0.5f * m_softwareHeight;
-			screenSpaceVerts[i] = {std::ceilf(x), std::ceilf(y)};
+			const auto& vert = vertices[i];
+			const auto x = static_cast<oxyS16>(std::ceilf(
+				(vert.m_position.x + 1.f) * 0.5f * m_softwareWidth));
+			const auto y = static_cast<oxyS16>(std::ceilf(
+				(1.f - vert.m_position.y) * 0.5f * m_softwareHeight));
+			minx = std::min(minx, x);
+			miny = std::min(miny, y);
+			maxx = std::max(maxx, x);
+			maxy = std::max(maxy, y);
+			maxDepth = std::max(maxDepth, vert.m_position.z);
 		}
 
-		auto minx = std::max<oxyS16>(
-			std::min<oxyS16>({static_cast<oxyS16>(screenSpaceVerts[0].x),
-							  static_cast<oxyS16>(screenSpaceVerts[1].x),
-							  static_cast<oxyS16>(screenSpaceVerts[2].x)}),
-			0);
-		auto maxx = std::min<oxyS16>(
-			std::max<oxyS16>({static_cast<oxyS16>(screenSpaceVerts[0].x),
-							  static_cast<oxyS16>(screenSpaceVerts[1].x),
-							  static_cast<oxyS16>(screenSpaceVerts[2].x)}),
-			m_softwareWidth - 1);
-		auto miny = std::max<oxyS16>(
-			std::min<oxyS16>({static_cast<oxyS16>(screenSpaceVerts[0].y),
-							  static_cast<oxyS16>(screenSpaceVerts[1].y),
-							  static_cast<oxyS16>(screenSpaceVerts[2].y)}),
-			0);
-		auto maxy = std::min<oxyS16>(
-			std::max<oxyS16>({static_cast<oxyS16>(screenSpaceVerts[0].y),
-							  static_cast<oxyS16>(screenSpaceVerts[1].y),
-							  static_cast<oxyS16>(screenSpaceVerts[2].y)}),
-			m_softwareHeight);
-
-		ret.m_x0 = minx;
-		ret.m_y0 = miny;
-		ret.m_x1 = maxx;
-		ret.m_y1 = maxy;
-		ret.m_maxDepth = std::max({tri.m_vertices[0].m_position.z,
-								   tri.m_vertices[1].m_position.z,
-								   tri.m_vertices[2].m_position.z});
+		ret.m_x0 = std::max<oxyS16>(minx, 0);
+		ret.m_y0 = std::max<oxyS16>(miny, 0);
+		ret.m_x1 = std::min<oxyS16>(maxx, m_softwareWidth - 1);
+		ret.m_y1 = std::min<oxyS16>(maxy, m_softwareHeight);
+		ret.m_maxDepth = maxDepth;
 
 		return ret;
 	}
@@ -7,6 +7,8 @@ namespace oxygen
 	namespace GraphicsAbstraction
 	{
 		struct Texture;
+		struct TexturedQuad;
+		struct DecodedTexture;
 	}; // namespace GraphicsAbstraction
 
 	struct GfxTexture
@@ -57,6 +59,33 @@ namespace oxygen
 		const GfxTexture* m_texture{};
 		GfxCullType m_cullType;
 	};
+	// Planar convex quad in perimeter order, or a triangle when
+	// m_vertexCount is 3 (m_vertices[3] unused)
+	struct GfxQuad
+	{
+		GfxVertex m_vertices[4];
+		oxyVec3 m_colour;
+		const GfxTexture* m_texture{};
+		GfxCullType m_cullType;
+		oxyU32 m_vertexCount{4};
+
+		// Fan triangle (0, index + 1, index + 2)
+		auto GetTri(oxyU32 index) const -> GfxTri
+		{
+			GfxTri tri;
+			tri.m_vertices[0] = m_vertices[0];
+			tri.m_vertices[1] = m_vertices[index + 1];
+			tri.m_vertices[2] = m_vertices[index + 2];
+			tri.m_colour = m_colour;
+			tri.m_texture = m_texture;
+			tri.m_cullType = m_cullType;
+			return tri;
+		}
+		auto GetTriCount() const -> oxyU32
+		{
+			return m_vertexCount - 2;
+		}
+	};
 
 	inline auto CullBackfaceTri(const GfxTri& tri) -> bool
 	{
@@ -72,10 +101,77 @@ namespace oxygen
 								 tri.m_vertices[0].m_position)
 				   .z > 0;
 	}
+	// Diagonal cross product, same sign as the winding for a convex quad and
+	// robust against collinear edge vertices
+	inline auto QuadWindingZ(const GfxQuad& quad) -> oxyF32
+	{
+		return (quad.m_vertices[2].m_position - quad.m_vertices[0].m_position)
+			.CrossProduct(quad.m_vertices[3].m_position -
+						  quad.m_vertices[1].m_position)
+			.z;
+	}
+
+	// A mesh component as captured by the simulation, culled, transformed
+	// and queued by the render thread
+	struct GfxMeshInstance
+	{
+		std::shared_ptr<const struct StaticMeshResource> m_mesh;
+		// Owns the frames for animated meshes, m_mesh is its root pose
+		std::shared_ptr<const struct AnimatedMeshResource> m_animatedMesh;
+		const std::vector<oxyVec3>* m_currentFrame{};
+		const std::vector<oxyVec3>* m_nextFrame{};
+		oxyF32 m_lerpAlpha{};
+		std::shared_ptr<const GfxTexture> m_texture;
+		oxyMat4x4 m_worldMatrix;
+		// World space
+		oxyVec3 m_sphereCenter{};
+		oxyF32 m_sphereRadius{};
+		// Range of GfxRenderSnapshot::m_meshLeaves, the world leaves its
+		// entity is linked into. Without any the sphere is tested instead.
+		oxyU32 m_firstLeaf{};
+		oxyU32 m_leafCount{};
+		// Set by the render thread to the cull result, if present
+		std::shared_ptr<std::atomic<oxyBool>> m_culledFeedback;
+	};
+
+	// Everything the render thread needs for one frame. Filled by the
+	// simulation right after Update and immutable once published.
+	struct GfxRenderSnapshot
+	{
+		oxyS32 m_width{};
+		oxyS32 m_height{};
+		oxyBool m_showStats{};
+
+		// Kept alive (and only ever released) by the simulation thread, the
+		// render thread owns its traversal state while it holds the snapshot
+		std::shared_ptr<struct World> m_world;
+		oxyBool m_hasCamera{};
+		oxyMat4x4 m_viewProjectionMatrix;
+		oxyVec3 m_cameraPosition{};
+		std::chrono::steady_clock::time_point m_inputSampleTime{};
+
+		// Orientation to re-latch from the live mouse position before the
+		// world is submitted
+		oxyBool m_lateLatch{};
+		oxyVec3 m_lateLatchEuler{};
+		oxyVec2 m_lateLatchMouseReference{};
+		// Input update the reference belongs to, stale once input moves on
+		oxyU64 m_lateLatchInputSerial{};
+		oxyMat4x4 m_projectionMatrix;
+
+		std::vector<GfxMeshInstance> m_meshes;
+		std::vector<oxyS32> m_meshLeaves;
+		// NDC, drawn after everything else in the order captured
+		std::vector<GfxTri> m_overlayTris;
+	};
 
 	struct GfxRenderer : SingletonBase<GfxRenderer>
 	{
 		GfxRenderer();
+		~GfxRenderer();
+
+		// Render thread only, the view projection of the snapshot being
+		// rendered (after the late latch)
 		auto SetViewProjectionMatrix(const oxyMat4x4& viewProjectionMatrix)
 			-> void
 		{
@@ -85,7 +181,24 @@ namespace oxygen
 		{
 			return m_viewProjectionMatrix;
 		}
+		// When the input behind the current view projection was sampled,
+		// Present measures input to photon latency from it
+		auto SetViewInputSampleTime(std::chrono::steady_clock::time_point time)
+			-> void
+		{
+			m_viewInputSampleTime = time;
+		}
 
+		auto GetLateLatchEnabled() const -> oxyBool
+		{
+			return m_lateLatchEnabled;
+		}
+		auto SetLateLatchEnabled(oxyBool enabled) -> void
+		{
+			m_lateLatchEnabled = enabled;
+		}
+
+		// Window size as of the last capture
 		auto GetWidth() const -> oxyS32
 		{
 			return m_width;
@@ -95,19 +208,65 @@ namespace oxygen
 			return m_height;
 		}
 
+		// World space sphere against the current view projection, using the
+		// same planes as CullClipSpaceTri
+		auto IsSphereInFrustum(const oxyVec3& center, oxyF32 radius) const
+			-> oxyBool;
+		auto IsBoxInFrustum(const oxyVec3& mins, const oxyVec3& maxs) const
+			-> oxyBool;
+
+		auto AddMeshCullStat(oxyBool visible) -> void
+		{
+			if (visible)
+				m_numMeshesVisible++;
+			else
+				m_numMeshesCulled++;
+		}
+
+		auto GetShowStats() const -> oxyBool
+		{
+			return m_showStats;
+		}
+		auto SetShowStats(oxyBool show) -> void
+		{
+			m_showStats = show;
+		}
+
 		auto LoadTexture(std::string_view texturePath)
 			-> std::shared_ptr<const GfxTexture>;
+		// LoadTexture for loads that decode elsewhere (see
+		// GraphicsAbstraction::DecodeTexture), GL thread only. Check
+		// FindTexture before decoding, cached textures are shared.
+		auto FindTexture(std::string_view texturePath) const
+			-> std::shared_ptr<const GfxTexture>;
+		auto UploadTexture(std::string_view texturePath,
+						   const GraphicsAbstraction::DecodedTexture& decoded)
+			-> std::shared_ptr<const GfxTexture>;
 
+		// Simulation thread, only valid while capturing
 		auto OverlayText(std::string_view text, oxyF32 blxndc, oxyF32 blyndc,
 						 const oxyVec3& colour, oxyF32 spacing, oxyF32 size, oxyBool center) -> void;
 		auto OverlayRect(const oxyVec3& col, const oxyVec2& minndc,
 						 const oxyVec2& maxndc) -> void;
+		auto CaptureMesh(GfxMeshInstance&& mesh) -> void;
 
-		auto BeginFrame(oxyS32 w, oxyS32 h) -> void;
-		auto EndFrame() -> void;
+		// Simulation thread, after Update: snapshot the frame and hand it to
+		// the render thread
+		auto CaptureFrame(oxyS32 w, oxyS32 h) -> void;
+		// GL thread, draws the most recent frame the render thread finished
+		auto Present() -> void;
+		// Joins the render thread, nothing is rendered after this
+		auto StopRenderThread() -> void;
+
+		// Render thread, transforms and queues a mesh that passed culling
+		auto SubmitMeshInstance(const GfxMeshInstance& mesh) -> void;
 
 		auto SubmitTriToQueue(const GfxTri& tri, GfxRenderStrategy mode, oxyF32 zmult = 1.0f)
 			-> void;
+		// Quads stay whole in the presorted queues, anything that needs
+		// clipping (or any other strategy) is split into triangles
+		auto SubmitQuadToQueue(const GfxQuad& quad, GfxRenderStrategy mode,
+							   oxyF32 zmult = 1.0f) -> void;
 	  private:
 		enum ClipCode
 		{
@@ -123,11 +282,40 @@ namespace oxygen
 		static auto ClipTri(const GfxTri& tri, ClipCode clipcode, Fun&& cb)
 			-> void;
 
+		auto GetFrustumPlanes(oxyVec4 (&planes)[6]) const -> void;
+
 		auto CullClipSpaceTri(const GfxTri& tri) -> bool;
+		auto CullClipSpaceQuad(const GfxQuad& quad) -> bool;
 
 		auto ConvertTriToNDCAndCull(GfxTri& tri) -> bool;
+		auto ConvertQuadToNDCAndCull(GfxQuad& quad) -> bool;
 
-		auto DrawPreSortedTri(const GfxTri& tri) -> void;
+		auto RenderThreadMain(std::stop_token stopToken) -> void;
+		auto RenderSnapshot(const GfxRenderSnapshot& snapshot) -> void;
+		auto BeginFrame(const GfxRenderSnapshot& snapshot) -> void;
+		auto EndFrame() -> void;
+
+		auto AppendOverlayText(std::vector<GfxTri>& out, std::string_view text,
+							   oxyF32 blxndc, oxyF32 blyndc,
+							   const oxyVec3& colour, oxyF32 spacing,
+							   oxyF32 size, oxyBool center) const -> void;
+		auto AppendOverlayRect(std::vector<GfxTri>& out, const oxyVec3& col,
+							   const oxyVec2& minndc,
+							   const oxyVec2& maxndc) const -> void;
+
+		// Everything the GL thread has to do for a frame
+		struct DrawList
+		{
+			std::vector<GraphicsAbstraction::TexturedQuad> m_quads;
+			// Keeps every texture in m_quads alive until the list is reused
+			std::vector<std::shared_ptr<const GraphicsAbstraction::Texture>>
+				m_textures;
+			std::chrono::steady_clock::time_point m_inputSampleTime{};
+		};
+		auto EmitQuad(GraphicsAbstraction::TexturedQuad& quad,
+					  const GfxTexture* texture) -> void;
+
+		auto DrawPreSortedQuad(const GfxQuad& quad) -> void;
 
 		auto DrawSpans(oxyU16 width, oxyU16 height) -> void;
 		auto GetTriFromID(oxyS16 id) -> const GfxTri*;
@@ -135,14 +323,43 @@ namespace oxygen
 			-> void;
 
 		auto HandleResize(oxyS32 w, oxyS32 h) -> void;
-		oxyS32 m_width;
-		oxyS32 m_height;
+		// Simulation thread
+		oxyS32 m_width{};
+		oxyS32 m_height{};
+		oxyBool m_showStats{};
+		oxyBool m_lateLatchEnabled{true};
+		GfxRenderSnapshot* m_capture{};
+		std::chrono::steady_clock::time_point m_lastPresentTime{};
+
+		// Handoff, simulation -> render thread -> GL thread
+		TripleBuffer<GfxRenderSnapshot> m_snapshots;
+		TripleBuffer<DrawList> m_drawLists;
+		std::atomic<oxyU64> m_snapshotsPublished{};
+		std::jthread m_renderThread;
 
+		// Render thread
+		oxyS32 m_renderWidth{};
+		oxyS32 m_renderHeight{};
 		oxyS32 m_softwareWidth;
 		oxyS32 m_softwareHeight;
 
 		oxyU64 m_frameCounter{};
 
+		oxyBool m_renderShowStats{};
+		oxyBool m_renderLateLatch{};
+		DrawList* m_drawList{};
+		std::unordered_set<const GraphicsAbstraction::Texture*>
+			m_drawListTextures;
+		std::chrono::steady_clock::time_point m_viewInputSampleTime{};
+		oxyU32 m_numMeshesVisible{};
+		oxyU32 m_numMeshesCulled{};
+
+		// Written by the GL thread in Present, shown by the render thread,
+		// smoothed, in milliseconds
+		std::atomic<oxyF32> m_inputToPhotonMs{};
+		std::atomic<oxyF32> m_frameTimeMs{};
+		std::atomic<oxyF32> m_renderThreadMs{};
+
 		std::unique_ptr<oxyF32[]> m_zbuffer;
 		std::unique_ptr<oxyS16[]> m_tribuffer;
 
@@ -160,8 +377,8 @@ namespace oxygen
 		static inline constexpr auto k_fontAtlasRows = 6;
 
 
-		std::vector<GfxTri> m_triQueueSoftwareDepthRasterizePreSorted;
-		std::vector<GfxTri> m_triQueueSoftwareDepthRasterizePreSortedOverlay;
+		std::vector<GfxQuad> m_quadQueueSoftwareDepthRasterizePreSorted;
+		std::vector<GfxQuad> m_quadQueueSoftwareDepthRasterizePreSortedOverlay;
 		std::vector<GfxTri> m_triQueueSoftwareDepthRasterize;
 		std::vector<GfxTri> m_triQueueDirectToGPU;
 
@@ -177,6 +394,18 @@ namespace oxygen
 			auto Expand(const BBox& other) -> oxyBool;
 		};
 
+		// Tiles of the software buffers touched by rasterization this frame,
+		// only these get cleared and scanned for spans
+		static inline constexpr auto k_dirtyTileSize = 16;
+		oxyS32 m_dirtyTilesX{};
+		oxyS32 m_dirtyTilesY{};
+		std::vector<oxyU8> m_dirtyTiles;
+		auto MarkDirtyTiles(const BBox& bbox) -> void;
+		auto ClearDirtyTiles() -> void;
+
 		auto NDCTriToBBox(const GfxTri& tri) -> BBox;
+		auto NDCQuadToBBox(const GfxQuad& quad) -> BBox;
+		auto NDCVerticesToBBox(const GfxVertex* vertices, oxySize count)
+			-> BBox;
 	};
 }; // namespace oxygen
\ No newline at end of file
@@ -2,86 +2,17 @@ namespace oxygen
 {
 	namespace GfxSoftwareRasterizer
 	{
-		template <typename T> struct CountingIterator
-		{
-			using iterator_category = std::random_access_iterator_tag;
-			using value_type = T;
-			using difference_type = T;
-			using pointer = T*;
-			using reference = T&;
-			const T& operator*() const
-			{
-				return m_value;
-			}
-			CountingIterator& operator++()
-			{
-				++m_value;
-				return *this;
-			}
-			CountingIterator operator++(int)
-			{
-				auto temp = *this;
-				++*this;
-				return temp;
-			}
-			CountingIterator& operator--()
-			{
-				--m_value;
-				return *this;
-			}
-			CountingIterator operator--(int)
-			{
-				auto temp = *this;
-				--*this;
-				return temp;
-			}
-			CountingIterator& operator+=(const T& lhs)
-			{
-				m_value += lhs;
-				return *this;
-			}
-			CountingIterator& operator-=(const T& lhs)
-			{
-				m_value -= lhs;
-				return *this;
-			}
-			CountingIterator operator+(const T& lhs) const
-			{
-				auto temp = *this;
-				temp += lhs;
-				return temp;
-			}
-			CountingIterator operator-(const T& lhs) const
-			{
-				auto temp = *this;
-				temp -= lhs;
-				return temp;
-			}
-			bool operator==(const CountingIterator& lhs) const
-			{
-				return m_value == lhs.m_value;
-			}
-			bool operator!=(const CountingIterator& lhs) const
-			{
-				return m_value != lhs.m_value;
-			}
-			const T operator+(const CountingIterator& lhs) const
-			{
-				return m_value + lhs.m_value;
-			}
-			T operator-(const CountingIterator& lhs) const
-			{
-				return m_value - lhs.m_value;
-			}
-			T m_value;
-		};
+		// Rows of a triangle rastered per job, a triangle this short or
+		// shorter stays on the calling thread
+		static inline constexpr auto k_rasterRowsPerJob = oxySize{8};
 
 		inline auto RasterTriDepthTest(const GfxTri& tri, oxyS16 triID,
 									   oxyU32 width, oxyU32 height,
 									   oxyF32* zbuffer, oxyS16* tribuffer, oxyU32 divminx, oxyU32 divminy, oxyU32 divmaxx, oxyU32 divmaxy)
 			-> oxyBool
 		{
-			oxyBool rasteredany{};
+			// Set from every row job that wrote a pixel
+			std::atomic<oxyBool> rasteredany{};
 			oxyVec2 screenSpaceVerts[3];
 			for (auto i = 0; i < 3; ++i)
 			{
@@ -141,9 +72,12 @@ namespace oxygen
 			const auto area = x21 * y02 - x02 * y21;
 			const auto invArea = 1.f / area;
 
-			std::for_each(
-				std::execution::par_unseq, CountingIterator<int>{miny},
-				CountingIterator<int>{maxy}, [&](auto y) {
+			JobSystem::GetInstance().ParallelFor(
+				static_cast<oxySize>(maxy - miny), k_rasterRowsPerJob,
+				[&](oxySize firstRow, oxySize endRow) {
+				for (auto row = firstRow; row < endRow; ++row)
+				{
+					const auto y = miny + static_cast<int>(row);
 					for (auto x = minx; x <= maxx; ++x)
 					{
 						const auto bw0cross =
@@ -181,12 +115,14 @@ namespace oxygen
 							{
 								zbuffer[index] = z;
 								tribuffer[index] = triID;
-								rasteredany = true;
+								rasteredany.store(true,
+												  std::memory_order_relaxed);
 							}
 						}
 					}
+				}
 				});
-			return rasteredany;
+			return rasteredany.load(std::memory_order_relaxed);
 		}
 		inline auto RasterTriNoDepthCompare(const GfxTri& tri, oxyU32 width,
 											oxyU32 height, oxyF32* zbuffer,
@@ -252,9 +188,12 @@ namespace oxygen
 			const auto area = x21 * y02 - x02 * y21;
 			const auto invArea = 1.f / area;
 
-			std::for_each(
-				std::execution::par_unseq, CountingIterator<int>{miny},
-				CountingIterator<int>{maxy}, [&](auto y) {
+			JobSystem::GetInstance().ParallelFor(
+				static_cast<oxySize>(maxy - miny), k_rasterRowsPerJob,
+				[&](oxySize firstRow, oxySize endRow) {
+				for (auto row = firstRow; row < endRow; ++row)
+				{
+					const auto y = miny + static_cast<int>(row);
 					for (auto x = minx; x <= maxx; ++x)
 					{
 						const auto bw0cross =
@@ -291,6 +230,7 @@ namespace oxygen
 							zbuffer[index] = z;
 						}
 					}
+				}
 				});
 		}
 	}; // namespace GfxSoftwareRasterizer
@@ -10,6 +10,8 @@ namespace oxygen
 		m_previousKeyStates = m_currentKeyStates;
 		m_previousMouseStates = m_currentMouseStates;
 
+		m_lastUpdateTime = std::chrono::steady_clock::now();
+		m_updateSerial.fetch_add(1, std::memory_order_release);
 		InputAbstraction::GetKeyStates(m_currentKeyStates);
 		InputAbstraction::GetMouseStates(m_currentMouseStates);
 		oxyF32 mx, my;
@@ -48,4 +50,10 @@ namespace oxygen
 				i, m_controllerAxisStates[i]);
 		}
 	}
+	auto InputManager::PeekMouseDelta(const oxyVec2& reference) -> oxyVec2
+	{
+		oxyF32 mx, my;
+		InputAbstraction::GetMousePosition(mx, my);
+		return {mx - reference.x, my - reference.y};
+	}
 } // namespace oxygen
\ No newline at end of file
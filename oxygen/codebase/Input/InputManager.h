@@ -14,6 +14,19 @@ namespace oxygen
 		{
 			return {m_mouseDeltaX, m_mouseDeltaY};
 		}
+		// Mouse movement since reference (a GetMousePosition result) without
+		// consuming it, the next Update still reports it in GetMouseDelta.
+		// Only reads the platform, safe from any thread.
+		static auto PeekMouseDelta(const oxyVec2& reference) -> oxyVec2;
+		auto GetLastUpdateTime() const -> std::chrono::steady_clock::time_point
+		{
+			return m_lastUpdateTime;
+		}
+		// Bumped at the start of every Update, safe from any thread
+		auto GetUpdateSerial() const -> oxyU64
+		{
+			return m_updateSerial.load(std::memory_order_acquire);
+		}
 		auto IsKeyDown(KeyboardButton key) const -> oxyBool
 		{
 			return m_currentKeyStates[static_cast<size_t>(key)];
@@ -84,6 +97,8 @@ namespace oxygen
 		oxyF32 m_mouseDeltaY{};
 
 		bool m_lockCursor{false};
+		std::chrono::steady_clock::time_point m_lastUpdateTime{};
+		std::atomic<oxyU64> m_updateSerial{};
 
 		static constexpr auto k_maxControllers{4};
 		std::array<std::bitset<ControllerButton_Count>, k_maxControllers>
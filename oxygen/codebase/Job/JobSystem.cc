@@ -0,0 +1,299 @@
+#include "OxygenPCH.h"
+#include "JobSystem.h"
+#include "Platform/Platform.h"
+
+namespace oxygen
+{
+	JobSystem::JobSystem()
+	{
+		const auto workerCount =
+			(std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+		m_deques.resize(k_firstWorkerDeque + workerCount);
+		for (auto& deque : m_deques)
+			deque = std::make_unique<JobDeque>();
+		RegisterThread();
+		m_workers.reserve(workerCount);
+		for (oxySize i = 0; i < workerCount; ++i)
+			m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+	JobSystem::~JobSystem()
+	{
+		// Workers only exit once every queue is empty, so nothing submitted
+		// before this is dropped
+		m_stopping.store(true, std::memory_order_release);
+		m_pushEpoch.fetch_add(1);
+		m_pushEpoch.notify_all();
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	auto JobSystem::RegisterThread() -> void
+	{
+		const auto index = m_registeredThreads.fetch_add(1) + 1;
+		// More threads than deques set aside, the rest share
+		OXYCHECK(index < k_firstWorkerDeque);
+		if (index < k_firstWorkerDeque)
+			t_dequeIndex = index;
+	}
+
+	auto JobSystem::Run(JobFn fn, void* context, JobCounter* counter,
+						JobCounter* after) -> void
+	{
+		const Job job{fn, context, 0, 1, counter, t_inBackground};
+		if (counter)
+			counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+		if (after)
+		{
+			std::lock_guard lock(after->m_mutex);
+			if (!after->IsDone())
+			{
+				after->m_continuations.push_back(job);
+				return;
+			}
+		}
+		Push(job);
+	}
+
+	auto JobSystem::ParallelFor(oxySize count, oxySize grainSize, JobFn fn,
+								void* context) -> void
+	{
+		grainSize = (std::max)(grainSize, oxySize{1});
+		if (count <= grainSize)
+		{
+			if (count)
+				fn(context, 0, count);
+			return;
+		}
+
+		// Counted up front so the counter can not pass through zero while
+		// runs are still being pushed
+		const auto runCount = (count + grainSize - 1) / grainSize;
+		JobCounter counter;
+		counter.m_pending.store(static_cast<oxyU32>(runCount - 1),
+								std::memory_order_relaxed);
+		for (auto run = runCount - 1; run > 0; --run)
+		{
+			Push({fn, context, run * grainSize,
+				  (std::min)(count, (run + 1) * grainSize), &counter,
+				  t_inBackground});
+		}
+		// The first run on this thread, the rest are picked up by whoever
+		// is free, this thread included
+		fn(context, 0, grainSize);
+		Wait(counter);
+	}
+
+	auto JobSystem::Wait(const JobCounter& counter) -> void
+	{
+		Job job;
+		while (!counter.IsDone())
+		{
+			if (TryPop(job, t_inBackground))
+				Execute(job);
+			else
+				std::this_thread::yield();
+		}
+		// The last Finish sets the counter to zero under its lock, taking it
+		// here waits that Finish out before the counter can go away
+		std::lock_guard lock(counter.m_mutex);
+	}
+
+	auto JobSystem::RunBackground(JobFn fn, void* context) -> void
+	{
+		Push(m_background, {fn, context, 0, 1, nullptr, true});
+	}
+
+	auto JobSystem::Push(const Job& job) -> void
+	{
+		Push(job.m_background ? m_backgroundJobs : *m_deques[t_dequeIndex],
+			 job);
+	}
+
+	auto JobSystem::Push(JobDeque& deque, const Job& job) -> void
+	{
+		{
+			std::lock_guard lock(deque.m_mutex);
+			deque.m_jobs.push_back(job);
+			deque.m_count.store(deque.m_jobs.size() - deque.m_front,
+								std::memory_order_relaxed);
+		}
+		// Pairs with the sleeper count and epoch check in WorkerMain, one of
+		// the two sides always sees the other
+		m_pushEpoch.fetch_add(1);
+		if (m_sleepers.load())
+			m_pushEpoch.notify_one();
+	}
+
+	auto JobSystem::TryTake(JobDeque& deque, oxyBool newest,
+							Job& job) -> oxyBool
+	{
+		if (!deque.m_count.load(std::memory_order_relaxed))
+			return false;
+		std::lock_guard lock(deque.m_mutex);
+		if (deque.m_jobs.size() == deque.m_front)
+			return false;
+		if (newest)
+		{
+			job = deque.m_jobs.back();
+			deque.m_jobs.pop_back();
+		}
+		else
+			job = deque.m_jobs[deque.m_front++];
+		if (deque.m_jobs.size() == deque.m_front)
+		{
+			deque.m_jobs.clear();
+			deque.m_front = 0;
+		}
+		deque.m_count.store(deque.m_jobs.size() - deque.m_front,
+							std::memory_order_relaxed);
+		return true;
+	}
+
+	auto JobSystem::TryPop(Job& job, oxyBool background) -> oxyBool
+	{
+		// Newest of our own first, its data is most likely still in cache
+		if (TryTake(*m_deques[t_dequeIndex], true, job))
+			return true;
+		// Then the oldest of someone else's, starting from the next deque
+		// over so thieves spread out. Workers take from anyone, other
+		// threads only from workers.
+		const auto first =
+			t_dequeIndex < k_firstWorkerDeque ? k_firstWorkerDeque : 0;
+		const auto count = m_deques.size() - first;
+		for (oxySize i = 1; i <= count; ++i)
+		{
+			const auto index = first + (t_dequeIndex + i) % count;
+			if (index != t_dequeIndex &&
+				TryTake(*m_deques[index], false, job))
+				return true;
+		}
+		return background && TryTake(m_backgroundJobs, false, job);
+	}
+
+	auto JobSystem::Execute(const Job& job) -> void
+	{
+		// Whatever the job submits is background work too if it is
+		const auto inBackground = t_inBackground;
+		t_inBackground = job.m_background;
+		job.m_fn(job.m_context, job.m_begin, job.m_end);
+		t_inBackground = inBackground;
+		if (job.m_counter)
+			Finish(*job.m_counter);
+	}
+
+	auto JobSystem::Finish(JobCounter& counter) -> void
+	{
+		// Anyone but the last one out leaves without touching the lock
+		auto pending = counter.m_pending.load(std::memory_order_relaxed);
+		while (pending > 1)
+		{
+			if (counter.m_pending.compare_exchange_weak(
+					pending, pending - 1, std::memory_order_acq_rel))
+				return;
+		}
+
+		std::vector<Job> continuations;
+		{
+			std::lock_guard lock(counter.m_mutex);
+			if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+			continuations.swap(counter.m_continuations);
+		}
+		for (const auto& job : continuations)
+			Push(job);
+	}
+
+	auto JobSystem::WorkerMain(oxySize workerIndex) -> void
+	{
+		t_dequeIndex = k_firstWorkerDeque + workerIndex;
+		Job job;
+		oxyU32 idleSpins = 0;
+		for (;;)
+		{
+			const auto epoch = m_pushEpoch.load();
+			if (TryPop(job, true) || TryTake(m_background, false, job))
+			{
+				Execute(job);
+				idleSpins = 0;
+				continue;
+			}
+			if (m_stopping.load(std::memory_order_acquire))
+				return;
+			if (++idleSpins < k_spinsBeforeSleep)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			m_sleepers.fetch_add(1);
+			if (m_pushEpoch.load() == epoch)
+				m_pushEpoch.wait(epoch);
+			m_sleepers.fetch_sub(1);
+			idleSpins = 0;
+		}
+	}
+
+	auto BenchmarkJobSystem(oxySize count) -> void
+	{
+		auto& jobs = JobSystem::GetInstance();
+		const auto Microseconds = [](auto start, oxySize n) {
+			return std::chrono::duration<oxyF64, std::micro>(
+					   std::chrono::steady_clock::now() - start)
+					   .count() /
+				   static_cast<oxyF64>((std::max)(n, oxySize{1}));
+		};
+
+		// Scheduling cost alone, each task does nothing
+		auto start = std::chrono::steady_clock::now();
+		{
+			std::vector<std::future<void>> futures;
+			futures.reserve(count);
+			for (oxySize i = 0; i < count; ++i)
+				futures.push_back(std::async(std::launch::async, []() {}));
+			for (auto& future : futures)
+				future.get();
+		}
+		const auto asyncUs = Microseconds(start, count);
+		start = std::chrono::steady_clock::now();
+		{
+			auto Empty = []() {};
+			JobCounter counter;
+			for (oxySize i = 0; i < count; ++i)
+				jobs.Run(Empty, counter);
+			jobs.Wait(counter);
+		}
+		const auto jobUs = Microseconds(start, count);
+		LogMessage(std::format("JobSystem: {} workers, {} empty tasks, "
+							   "std::async {:.3f} us each, Run {:.3f} us "
+							   "each\n",
+							   jobs.GetWorkerCount(), count, asyncUs, jobUs)
+					   .c_str());
+
+		// A loop body too small to hide the split
+		std::vector<oxyF32> values(count);
+		const auto Body = [&](oxySize i) {
+			values[i] = std::sqrt(static_cast<oxyF32>(i));
+		};
+		std::vector<oxySize> indices(count);
+		for (oxySize i = 0; i < count; ++i)
+			indices[i] = i;
+		start = std::chrono::steady_clock::now();
+		std::for_each(std::execution::par_unseq, indices.begin(),
+					  indices.end(), Body);
+		LogMessage(std::format("JobSystem: par_unseq over {}: {:.4f} us per "
+							   "index\n",
+							   count, Microseconds(start, count))
+					   .c_str());
+		for (const auto grainSize : {oxySize{64}, oxySize{1024}, oxySize{16384}})
+		{
+			start = std::chrono::steady_clock::now();
+			jobs.ParallelFor(count, grainSize, [&](oxySize begin, oxySize end) {
+				for (auto i = begin; i < end; ++i)
+					Body(i);
+			});
+			LogMessage(std::format("JobSystem: ParallelFor over {}, grain {}: "
+								   "{:.4f} us per index\n",
+								   count, grainSize, Microseconds(start, count))
+						   .c_str());
+		}
+	}
+}; // namespace oxygen
@@ -0,0 +1,170 @@
+#pragma once
+
+namespace oxygen
+{
+	// Runs [begin, end) of whatever range the job was split from
+	using JobFn = void (*)(void* context, oxySize begin, oxySize end);
+
+	struct Job
+	{
+		JobFn m_fn{};
+		void* m_context{};
+		oxySize m_begin{};
+		oxySize m_end{};
+		struct JobCounter* m_counter{};
+		// Submitted from inside a background task, runs as part of it
+		oxyBool m_background{};
+	};
+
+	// Number of jobs left to finish. Jobs run with a counter count it up when
+	// submitted and down when done, Wait returns and dependent jobs start
+	// once it is back to zero.
+	struct JobCounter : NonCopyable
+	{
+		auto IsDone() const -> oxyBool
+		{
+			return m_pending.load(std::memory_order_acquire) == 0;
+		}
+
+	  private:
+		std::atomic<oxyU32> m_pending{};
+		// Jobs waiting on this counter, submitted by whoever finishes the
+		// last pending one
+		mutable std::mutex m_mutex;
+		std::vector<Job> m_continuations;
+
+		friend struct JobSystem;
+	};
+
+	// One worker per core beside the thread that created it. Each worker owns
+	// a deque, it pushes and pops its own jobs at the back and steals from the
+	// front of the others' when it runs dry. Threads that are not workers
+	// (simulation, render) register for a deque of their own, while they
+	// wait they only run their own jobs or steal from workers, never from
+	// each other, so one can not end up running the other's frame work.
+	// Any thread waiting on a counter runs jobs in the meantime, so waiting
+	// from inside a job cannot deadlock.
+	// Jobs a background task submits are kept apart, only idle workers and
+	// other background work run them.
+	struct JobSystem : SingletonBase<JobSystem>
+	{
+		JobSystem();
+		~JobSystem();
+
+		auto GetWorkerCount() const -> oxySize
+		{
+			return m_workers.size();
+		}
+
+		// Gives the calling thread, which is not a worker, a deque of its
+		// own. Called once at thread start, the thread that creates the
+		// JobSystem is registered already. Threads that never register
+		// share one deque.
+		auto RegisterThread() -> void;
+
+		// Starts fn once after (if given) is done. counter, if given, is done
+		// again once fn has run.
+		auto Run(JobFn fn, void* context, JobCounter* counter = nullptr,
+				 JobCounter* after = nullptr) -> void;
+		// fn is called with (begin, end) for runs of at most grainSize
+		// indices covering [0, count), returns when all of them are done
+		auto ParallelFor(oxySize count, oxySize grainSize, JobFn fn,
+						 void* context) -> void;
+		// Runs jobs until counter is done
+		auto Wait(const JobCounter& counter) -> void;
+
+		// fn has to outlive the job, it is not copied
+		template <typename F>
+		auto Run(F& fn, JobCounter& counter, JobCounter* after = nullptr)
+			-> void
+		{
+			Run([](void* context, oxySize, oxySize) {
+				(*static_cast<F*>(context))();
+			}, const_cast<std::remove_const_t<F>*>(&fn), &counter, after);
+		}
+		template <typename F>
+		auto ParallelFor(oxySize count, oxySize grainSize, const F& fn) -> void
+		{
+			ParallelFor(count, grainSize,
+						[](void* context, oxySize begin, oxySize end) {
+							(*static_cast<const F*>(context))(begin, end);
+						},
+						const_cast<F*>(&fn));
+		}
+		// For long running work (file loads, decodes) the submitter polls
+		// rather than waits on. Only idle workers pick it up, and the jobs
+		// it submits in turn only go to idle workers or to waits inside
+		// background work, a thread helping out in Wait from the simulation
+		// or render thread never gets stuck in one.
+		template <typename F>
+		auto Async(F&& fn) -> std::future<std::invoke_result_t<F>>
+		{
+			using Task = std::packaged_task<std::invoke_result_t<F>()>;
+			const auto task = new Task(std::forward<F>(fn));
+			auto future = task->get_future();
+			RunBackground([](void* context, oxySize, oxySize) {
+				const auto task = static_cast<Task*>(context);
+				(*task)();
+				delete task;
+			}, task);
+			return future;
+		}
+
+	  private:
+		// Yields an idle worker gives before it sleeps
+		static inline constexpr auto k_spinsBeforeSleep = oxyU32{64};
+		// Deques for threads that are not workers, after the shared one
+		static inline constexpr auto k_threadDeques = oxySize{4};
+		static inline constexpr auto k_firstWorkerDeque = k_threadDeques + 1;
+
+		struct JobDeque
+		{
+			std::mutex m_mutex;
+			// Live jobs are [m_front, size), emptied out once they are gone
+			std::vector<Job> m_jobs;
+			oxySize m_front{};
+			// Live job count, read without the lock to skip empty deques
+			std::atomic<oxySize> m_count{};
+		};
+
+		auto RunBackground(JobFn fn, void* context) -> void;
+		// The calling thread's deque, or m_backgroundJobs for a job
+		// submitted from background work
+		auto Push(const Job& job) -> void;
+		auto Push(JobDeque& deque, const Job& job) -> void;
+		// Own deque first (newest job), then the oldest job of another deque
+		// (any for a worker, only workers' for other threads), then
+		// background jobs if the caller is allowed them
+		auto TryPop(Job& job, oxyBool background) -> oxyBool;
+		static auto TryTake(JobDeque& deque, oxyBool newest,
+							Job& job) -> oxyBool;
+		auto Execute(const Job& job) -> void;
+		auto Finish(JobCounter& counter) -> void;
+		auto WorkerMain(oxySize workerIndex) -> void;
+
+		// Index into m_deques of the calling thread's deque, the shared
+		// one's for threads that never registered
+		static inline thread_local oxySize t_dequeIndex{};
+		// Set while the calling thread runs a background task or one of the
+		// jobs it submitted
+		static inline thread_local oxyBool t_inBackground{};
+
+		// m_deques[0] is shared by unregistered threads, registered threads
+		// own the next k_threadDeques, worker i owns
+		// m_deques[k_firstWorkerDeque + i]
+		std::vector<std::unique_ptr<JobDeque>> m_deques;
+		std::atomic<oxySize> m_registeredThreads{};
+		// Background tasks, and the jobs submitted from inside them
+		JobDeque m_background;
+		JobDeque m_backgroundJobs;
+		std::vector<std::thread> m_workers;
+		// Bumped on every push, idle workers sleep on it
+		std::atomic<oxyU32> m_pushEpoch{};
+		std::atomic<oxyU32> m_sleepers{};
+		std::atomic<oxyBool> m_stopping{};
+	};
+
+	// Logs the cost of count empty jobs and of parallel loops over count
+	// indices at a few grain sizes, against std::async and par_unseq
+	auto BenchmarkJobSystem(oxySize count) -> void;
+}; // namespace oxygen
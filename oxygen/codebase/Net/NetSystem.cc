@@ -169,8 +169,6 @@ namespace oxygen
 		m_clientHostSocket.m_socket.reset();
 		if (m_clientBroadcastSendThread.joinable())
 			m_clientBroadcastSendThread.join();
-
-		m_nextNetObjID = k_netSessionDefaultMinObjid;
 	}
 	auto NetSystem::HostSendToAll(oxyU16 type,
 								  const std::span<oxyU8>& data) -> void
@@ -194,6 +192,18 @@ namespace oxygen
 			}
 		}
 	}
+	auto NetSystem::HostSendTo(oxyU64 clientID, oxyU16 type,
+							   const std::span<oxyU8>& data) -> void
+	{
+		for (const auto& client : m_clients)
+		{
+			if (client->m_connected && client->m_uniqueID == clientID)
+			{
+				client->WriteData(type, data);
+				return;
+			}
+		}
+	}
 	auto NetSystem::CliSendToHost(oxyU16 type,
 								  const std::span<oxyU8>& data) -> void
 	{
@@ -66,6 +66,8 @@ namespace oxygen
 		auto HostSendToAll(oxyU16 type, const std::span<oxyU8>& data) -> void;
 		auto HostSendToAllExcept(oxyU64 excludeClientID, oxyU16 type,
 								 const std::span<oxyU8>& data) -> void;
+		auto HostSendTo(oxyU64 clientID, oxyU16 type,
+						const std::span<oxyU8>& data) -> void;
 
 		auto CliSendToHost(oxyU16 type, const std::span<oxyU8>& data) -> void;
 
@@ -81,7 +83,7 @@ namespace oxygen
 
 		auto GetNewNetObjID() -> oxyObjectID
 		{
-			return m_nextNetObjID++;
+			return ObjectManager::GetInstance().AllocateNetworkID();
 		}
 
 		auto IsHost() const -> oxyBool
@@ -97,8 +99,6 @@ namespace oxygen
 		static inline constexpr auto k_enginePort = 28672;
 		static inline constexpr auto k_engineBroadcastPort = 28678;
 		static inline constexpr auto k_timeBetweenPing = 4.0f;
-		static inline constexpr auto k_netSessionDefaultMinObjid =
-			oxyObjectID{0xC0000001};
 
 	  private:
 		auto PingAll() -> void;
@@ -148,6 +148,5 @@ namespace oxygen
 		oxyBool m_requestShutdown{};
 
 		oxyF32 m_timeSinceLastPing{};
-		oxyObjectID m_nextNetObjID{k_netSessionDefaultMinObjid};
 	};
 }; // namespace oxygen
\ No newline at end of file
@@ -6,11 +6,6 @@ namespace oxygen
 	{
 		OXYGENOBJECT(ManagedObject, Object);
 
-		auto GetObjectID() const -> oxyObjectID
-		{
-			return m_id;
-		}
-
 		template <typename RefType>
 		auto GetHardRef() const -> std::shared_ptr<RefType>
 			requires std::is_base_of_v<ManagedObject, RefType>
@@ -22,7 +17,6 @@ namespace oxygen
 		}
 
 	  private:
-		oxyObjectID m_id{};
 		std::weak_ptr<ManagedObject> m_self{};
 
 		friend struct ObjectManager;
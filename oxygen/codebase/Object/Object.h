@@ -12,6 +12,13 @@ namespace oxygen
 		oxySize m_align{};
 		using constructor_t = Object* (*)(void* p);
 		constructor_t m_constructor{};
+		// 1-based index of the ObjectManager pool for this type, 0 until the
+		// first instance is created
+		mutable oxyU32 m_poolIndex{};
+		// Depth-first numbering of the type tree, this type and every
+		// subclass fall in [m_typeIndex, m_typeIndexEnd)
+		mutable oxyU32 m_typeIndex{};
+		mutable oxyU32 m_typeIndexEnd{};
 	};
 
 	inline auto GetObjectDescriptionMap()
@@ -88,16 +95,12 @@ namespace oxygen
 			return GetStaticDescription();
 		}
 
+		// Needs the type intervals the ObjectManager assigns on construction
 		auto IsA(const ObjectDescription& desc) const -> bool
 		{
-			auto* p = &GetDescription();
-			while (p)
-			{
-				if (p->m_id == desc.m_id)
-					return true;
-				p = p->m_parent;
-			}
-			return false;
+			const auto typeIndex = GetDescription().m_typeIndex;
+			return typeIndex >= desc.m_typeIndex &&
+				   typeIndex < desc.m_typeIndexEnd;
 		}
 		template <typename T>
 		auto IsA() const -> bool
@@ -118,7 +121,17 @@ namespace oxygen
 			return IsA<T>() ? static_cast<const T*>(this) : nullptr;
 		}
 
+		// Generational handle assigned by the ObjectManager
+		auto GetObjectID() const -> oxyObjectID
+		{
+			return m_objectID;
+		}
+
 	  private:
+		oxyObjectID m_objectID{};
+
+		friend struct ObjectManager;
+
 		struct ObjectInternalDef
 		{
 			static auto GetStaticDescription() -> const ObjectDescription&
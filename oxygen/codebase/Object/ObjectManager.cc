@@ -1,30 +1,154 @@
 #include "OxygenPCH.h"
 #include "ObjectManager.h"
+#include "Platform/Platform.h"
+
+#include "World/World.h"
+#include "Entity/Entity.h"
+#include "Component/HullComponent/HullComponent.h"
+#include "Component/ProjectileComponent/ProjectileComponent.h"
 
 namespace oxygen
 {
+	ObjectManager::ObjectManager()
+	{
+		AssignTypeIntervals();
+	}
+
 	ObjectManager::~ObjectManager()
 	{
-		OXYCHECK(m_objects.empty());
+		OXYCHECK(m_liveObjectCount == 0);
+	}
+
+	auto ObjectManager::AssignTypeIntervals() -> void
+	{
+		// Every registered type and its ancestors, in case a parent never
+		// made it into the description map itself
+		std::vector<const ObjectDescription*> types;
+		std::unordered_set<const ObjectDescription*> seen;
+		for (const auto& [id, desc] : GetObjectDescriptionMap())
+		{
+			for (auto p = desc; p && seen.insert(p).second; p = p->m_parent)
+				types.push_back(p);
+		}
+		// Sorted by name so the numbering does not depend on registration
+		// order
+		std::sort(types.begin(), types.end(), [](const auto* a, const auto* b) {
+			return a->m_name < b->m_name;
+		});
+		std::unordered_map<const ObjectDescription*,
+						   std::vector<const ObjectDescription*>>
+			children;
+		std::vector<const ObjectDescription*> roots;
+		for (const auto desc : types)
+		{
+			if (desc->m_parent)
+				children[desc->m_parent].push_back(desc);
+			else
+				roots.push_back(desc);
+		}
+
+		// Index 0 is left unused so an unassigned description never matches
+		auto nextIndex = oxyU32{1};
+		const auto Assign = [&](const auto& self,
+								const ObjectDescription* desc) -> void {
+			desc->m_typeIndex = nextIndex++;
+			const auto it = children.find(desc);
+			if (it != children.end())
+			{
+				for (const auto child : it->second)
+					self(self, child);
+			}
+			desc->m_typeIndexEnd = nextIndex;
+		};
+		for (const auto root : roots)
+			Assign(Assign, root);
+	}
+
+	auto ObjectManager::AllocateHandle(SlotTable& table,
+									   oxyObjectID networkBit) -> oxyObjectID
+	{
+		while (table.m_freeIndices.size() - table.m_freeFront >
+			   k_handleReuseDelay)
+		{
+			const auto index = table.m_freeIndices[table.m_freeFront++];
+			// Shifting the queue down once its dead half is the larger keeps
+			// popping constant time on average
+			if (table.m_freeFront * 2 >= table.m_freeIndices.size())
+			{
+				table.m_freeIndices.erase(
+					table.m_freeIndices.begin(),
+					table.m_freeIndices.begin() +
+						static_cast<std::ptrdiff_t>(table.m_freeFront));
+				table.m_freeFront = 0;
+			}
+			// Clients place network objects at the host's indices, so a
+			// freed index may have been taken again since it was pushed
+			const auto& slot = table.m_slots[index];
+			if (!slot.m_object && !slot.m_reserved)
+				return networkBit | (slot.m_generation << k_handleIndexBits) |
+					   index;
+		}
+		OXYCHECK(table.m_slots.size() <= k_handleIndexMask);
+		const auto index = static_cast<oxyObjectID>(table.m_slots.size());
+		table.m_slots.emplace_back();
+		return networkBit | (oxyObjectID{1} << k_handleIndexBits) | index;
+	}
+
+	auto ObjectManager::AllocateNetworkID() -> oxyObjectID
+	{
+		const auto id = AllocateHandle(m_networkSlots, k_handleNetworkBit);
+		m_networkSlots.m_slots[id & k_handleIndexMask].m_reserved = true;
+		return id;
+	}
+
+	auto ObjectManager::FindSlot(oxyObjectID id) const -> const Slot*
+	{
+		const auto& table = GetTable(id);
+		const auto index = id & k_handleIndexMask;
+		if (index >= table.m_slots.size())
+			return nullptr;
+		const auto& slot = table.m_slots[index];
+		if (!slot.m_object ||
+			slot.m_generation !=
+				((id >> k_handleIndexBits) & k_handleGenerationMask))
+			return nullptr;
+		return &slot;
 	}
 
 	auto ObjectManager::NewObject(const ObjectDescription& desc,
 								  oxyObjectID id) -> Object*
 	{
 		if (!id)
-			id = m_nextDynamicID++;
-		else
+			id = AllocateHandle(m_localSlots, 0);
+		const auto generation =
+			static_cast<oxyU32>((id >> k_handleIndexBits) &
+								k_handleGenerationMask);
+		if (!generation)
+			return nullptr;
+		auto& table = GetTable(id);
+		const auto index = static_cast<oxyU32>(id & k_handleIndexMask);
+		if (index >= table.m_slots.size())
 		{
-			const auto it = m_objects.find(id);
-			if (it != m_objects.end())
-				return it->second;
+			// A handle from the host past the end of our table, the gap
+			// stays allocatable
+			for (auto i = static_cast<oxyU32>(table.m_slots.size());
+				 i < index; ++i)
+				table.m_freeIndices.push_back(i);
+			table.m_slots.resize(index + 1);
 		}
-		const auto storage =
-			::operator new[](desc.m_size, std::align_val_t{desc.m_align});
+		auto& slot = table.m_slots[index];
+		if (slot.m_object)
+			return slot.m_generation == generation ? slot.m_object : nullptr;
+
+		const auto storage = GetPool(desc).Allocate();
 		const auto obj = desc.m_constructor(storage);
 		OXYCHECK(storage == obj);
-		m_objects.emplace(id, obj);
-		m_objectIDs.emplace(obj, id);
+		obj->m_objectID = id;
+		slot.m_object = obj;
+		slot.m_generation = generation;
+		slot.m_reserved = false;
+		slot.m_managed = false;
+		++m_liveObjectCount;
 		return obj;
 	};
 
@@ -32,101 +156,364 @@ namespace oxygen
 	{
 		if (!obj && !id)
 			return;
-		auto idit = m_objectIDs.end();
-		auto objit = m_objects.end();
-		if (id)
-		{
-			objit = m_objects.find(id);
-			OXYCHECK(objit != m_objects.end());
-			obj = objit->second;
-		}
 		if (obj)
 		{
-			idit = m_objectIDs.find(obj);
-			OXYCHECK(idit != m_objectIDs.end());
-			id = idit->second;
+			OXYCHECK(!id || id == obj->m_objectID);
+			id = obj->m_objectID;
 		}
-		OXYCHECK(obj);
-		OXYCHECK(id);
-		if (idit == m_objectIDs.end())
-		{
-			idit = m_objectIDs.find(obj);
-		}
-		if (objit == m_objects.end())
+		OXYCHECK(FindSlot(id));
+		auto& table = GetTable(id);
+		const auto index = static_cast<oxyU32>(id & k_handleIndexMask);
+		auto& slot = table.m_slots[index];
+		if (!obj)
+			obj = slot.m_object;
+		OXYCHECK(slot.m_object == obj);
+
+		// Bumping the generation is what turns every outstanding handle to
+		// this slot stale. Wrapping it would bring the oldest of them back,
+		// the last generation retires the slot instead.
+		slot.m_object = nullptr;
+		slot.m_managed = false;
+		if (slot.m_generation < k_handleGenerationMask)
 		{
-			objit = m_objects.find(id);
+			++slot.m_generation;
+			table.m_freeIndices.push_back(index);
 		}
-		OXYCHECK(idit != m_objectIDs.end());
-		OXYCHECK(objit != m_objects.end());
-		OXYCHECK(idit->second == objit->first);
-		m_objectIDs.erase(idit);
-		m_objects.erase(objit);
+		--m_liveObjectCount;
 
 		const auto& desc = obj->GetDescription();
 
 		// destroy object
 		obj->~Object();
-		::operator delete[](obj, std::align_val_t{desc.m_align});
+		GetPool(desc).Free(obj);
 	}
 
 	auto ObjectManager::CreateManagedObject(const ObjectDescription& desc,
 											oxyObjectID id)
 		-> std::shared_ptr<ManagedObject>
 	{
-		if (!id)
-			id = m_nextManagedID++;
-		else
-		{
-			const auto it = m_managedObjects.find(id);
-			if (it != m_managedObjects.end())
-			{
-				const auto sptr = it->second.lock();
-				return sptr;
-			}
-		}
 		const auto ptr = static_cast<ManagedObject*>(NewObject(desc, id));
-		const auto sptr =
-			std::shared_ptr<ManagedObject>(ptr, ManagedObjectDeleter{});
-		ptr->m_id = id;
+		if (!ptr)
+			return nullptr;
+		// Already created under this handle
+		auto sptr = ptr->m_self.lock();
+		if (sptr)
+			return sptr;
+		sptr = std::shared_ptr<ManagedObject>(
+			ptr, ManagedObjectDeleter{},
+			ControlBlockAllocator<ManagedObject>{});
 		ptr->m_self = sptr;
-		m_managedObjects.emplace(id, sptr);
+		GetTable(ptr->m_objectID)
+			.m_slots[ptr->m_objectID & k_handleIndexMask]
+			.m_managed = true;
 		return sptr;
 	}
 
 	auto ObjectManager::GetObjectPtr(oxyObjectID id) const -> Object*
 	{
-		const auto it = m_objects.find(id);
-		if (it == m_objects.end())
-			return nullptr;
-		return it->second;
+		const auto slot = FindSlot(id);
+		return slot ? slot->m_object : nullptr;
 	}
 
 	auto ObjectManager::GetObjectID(Object* obj) const -> oxyObjectID
 	{
-		const auto it = m_objectIDs.find(obj);
-		if (it == m_objectIDs.end())
-			return 0;
-		return it->second;
+		return obj ? obj->m_objectID : 0;
 	}
 
 	auto ObjectManager::GetManagedRef(oxyObjectID id) const
 		-> std::shared_ptr<ManagedObject>
 	{
-		const auto it = m_managedObjects.find(id);
-		if (it == m_managedObjects.end())
+		const auto slot = FindSlot(id);
+		if (!slot || !slot->m_managed)
 			return nullptr;
-		return it->second.lock();
+		return static_cast<ManagedObject*>(slot->m_object)->m_self.lock();
+	}
+
+	auto ObjectManager::GetPool(const ObjectDescription& desc) -> ObjectPool&
+	{
+		if (!desc.m_poolIndex)
+		{
+			auto blocksPerChunk = k_defaultBlocksPerChunk;
+			auto initialChunks = oxyU32{0};
+			for (const auto& config : k_poolConfigs)
+			{
+				if (config.m_typeName == desc.m_name)
+				{
+					blocksPerChunk = config.m_blocksPerChunk;
+					initialChunks = config.m_initialChunks;
+				}
+			}
+			m_pools.push_back(std::make_unique<ObjectPool>(
+				desc.m_name, desc.m_size, desc.m_align, blocksPerChunk,
+				initialChunks));
+			desc.m_poolIndex = static_cast<oxyU32>(m_pools.size());
+		}
+		return *m_pools[desc.m_poolIndex - 1];
+	}
+
+	auto ObjectManager::GetControlBlockPool(oxySize size,
+											oxySize align) -> ObjectPool&
+	{
+		const auto blockSize = ObjectPool::GetSizeClass(size, align);
+		for (const auto& pool : m_controlBlockPools)
+		{
+			if (pool->GetStats().m_blockSize == blockSize)
+				return *pool;
+		}
+		m_controlBlockPools.push_back(std::make_unique<ObjectPool>(
+			"shared_ptr control block", size, align, k_controlBlocksPerChunk));
+		return *m_controlBlockPools.back();
+	}
+
+	auto ObjectManager::GetPoolStats() const -> std::vector<ObjectPoolStats>
+	{
+		std::vector<ObjectPoolStats> stats;
+		for (const auto& pool : m_pools)
+			stats.push_back(pool->GetStats());
+		for (const auto& pool : m_controlBlockPools)
+			stats.push_back(pool->GetStats());
+		return stats;
+	}
+
+	auto ObjectManager::LogPoolStats() const -> void
+	{
+		for (const auto& stats : GetPoolStats())
+		{
+			LogMessage(std::format("ObjectPool {}: {} byte blocks, {} live "
+								   "({} peak) in {} chunks of {}, {} "
+								   "allocations, {} frees\n",
+								   stats.m_name, stats.m_blockSize,
+								   stats.m_live, stats.m_peak, stats.m_chunks,
+								   stats.m_blocksPerChunk, stats.m_allocations,
+								   stats.m_frees)
+						   .c_str());
+		}
 	}
 
 	auto
 	ObjectManager::ManagedObjectDeleter::operator()(ManagedObject* obj) -> void
 	{
 		if (obj)
+			ObjectManager::GetInstance().DeleteObject(obj);
+	}
+
+	namespace
+	{
+		// The hashed bookkeeping ObjectManager did before the slot tables,
+		// kept as the baseline for BenchmarkObjectManager
+		struct HashedObjectMaps
 		{
-			auto& om = ObjectManager::GetInstance();
-			const auto id = obj->GetObjectID();
-			om.DeleteObject(obj);
-			om.m_managedObjects.erase(id);
+			auto Create() -> std::shared_ptr<ManagedObject>
+			{
+				const auto id = m_nextManagedID++;
+				const auto& desc = ManagedObject::GetStaticDescription();
+				const auto storage = ::operator new[](
+					desc.m_size, std::align_val_t{desc.m_align});
+				const auto obj =
+					static_cast<ManagedObject*>(desc.m_constructor(storage));
+				m_objects.emplace(id, obj);
+				m_objectIDs.emplace(obj, id);
+				auto sptr = std::shared_ptr<ManagedObject>(
+					obj, [this](ManagedObject* p) { Destroy(p); });
+				m_managedObjects.emplace(id, sptr);
+				return sptr;
+			}
+			auto GetID(Object* obj) const -> oxyU64
+			{
+				const auto it = m_objectIDs.find(obj);
+				return it == m_objectIDs.end() ? 0 : it->second;
+			}
+			auto GetManagedRef(oxyU64 id) const
+				-> std::shared_ptr<ManagedObject>
+			{
+				const auto it = m_managedObjects.find(id);
+				if (it == m_managedObjects.end())
+					return nullptr;
+				return it->second.lock();
+			}
+			auto Destroy(ManagedObject* obj) -> void
+			{
+				const auto idit = m_objectIDs.find(obj);
+				OXYCHECK(idit != m_objectIDs.end());
+				const auto id = idit->second;
+				m_objectIDs.erase(idit);
+				m_objects.erase(id);
+				m_managedObjects.erase(id);
+				const auto& desc = obj->GetDescription();
+				obj->~Object();
+				::operator delete[](obj, std::align_val_t{desc.m_align});
+			}
+
+		  private:
+			oxyU64 m_nextManagedID{0x80000001};
+			std::unordered_map<oxyU64, Object*> m_objects{};
+			std::unordered_map<Object*, oxyU64> m_objectIDs{};
+			std::unordered_map<oxyU64, std::weak_ptr<ManagedObject>>
+				m_managedObjects{};
+		};
+
+		struct ObjectBenchmarkRates
+		{
+			oxyF64 m_create{};
+			oxyF64 m_lookup{};
+			oxyF64 m_destroy{};
+			oxySize m_staleResolves{};
+		};
+
+		// create, GetID + GetManagedRef on every object in a shuffled order,
+		// then release in another shuffled order and resolve the now stale ids
+		template <typename CreateFn, typename GetIDFn, typename ResolveFn>
+		auto MeasureObjectStore(oxySize count, const CreateFn& create,
+								const GetIDFn& getID,
+								const ResolveFn& resolve)
+			-> ObjectBenchmarkRates
+		{
+			constexpr auto k_lookupPasses = 8;
+			const auto Rate = [](oxySize ops, const auto& start) {
+				const auto seconds = std::chrono::duration<oxyF64>(
+										 std::chrono::steady_clock::now() -
+										 start)
+										 .count();
+				return seconds > 0.0 ? ops / seconds : 0.0;
+			};
+			const auto Shuffle = [](auto& values) {
+				for (oxySize i = values.size(); i > 1; --i)
+					std::swap(values[i - 1],
+							  values[RandomU64(0, static_cast<oxyU64>(i - 1))]);
+			};
+
+			ObjectBenchmarkRates rates{};
+			std::vector<std::shared_ptr<ManagedObject>> objects;
+			objects.reserve(count);
+			auto start = std::chrono::steady_clock::now();
+			for (oxySize i = 0; i < count; ++i)
+				objects.push_back(create());
+			rates.m_create = Rate(count, start);
+
+			Shuffle(objects);
+			std::vector<oxyU64> ids;
+			ids.reserve(count);
+			oxySize resolved = 0;
+			start = std::chrono::steady_clock::now();
+			for (auto pass = 0; pass < k_lookupPasses; ++pass)
+			{
+				ids.clear();
+				for (const auto& obj : objects)
+					ids.push_back(getID(obj.get()));
+				for (const auto id : ids)
+					resolved += resolve(id) ? 1 : 0;
+			}
+			rates.m_lookup = Rate(count * k_lookupPasses, start);
+			OXYCHECK(resolved == count * k_lookupPasses);
+
+			Shuffle(objects);
+			start = std::chrono::steady_clock::now();
+			for (auto& obj : objects)
+				obj.reset();
+			rates.m_destroy = Rate(count, start);
+
+			for (const auto id : ids)
+				rates.m_staleResolves += resolve(id) ? 1 : 0;
+			return rates;
 		}
+	}; // namespace
+
+	auto BenchmarkObjectManager(oxySize count) -> void
+	{
+		HashedObjectMaps hashed;
+		const auto hashedRates = MeasureObjectStore(
+			count, [&]() { return hashed.Create(); },
+			[&](Object* obj) { return hashed.GetID(obj); },
+			[&](oxyU64 id) { return hashed.GetManagedRef(id); });
+
+		auto& om = ObjectManager::GetInstance();
+		const auto slotRates = MeasureObjectStore(
+			count, [&]() { return om.CreateManagedObject<ManagedObject>(); },
+			[&](Object* obj) { return om.GetObjectID(obj); },
+			[&](oxyU64 id) {
+				return om.GetManagedRef(static_cast<oxyObjectID>(id));
+			});
+
+		LogMessage(
+			std::format("BenchmarkObjectManager x{}: hashed maps create "
+						"{:.0f}/s lookup {:.0f}/s destroy {:.0f}/s, slot "
+						"tables create {:.0f}/s lookup {:.0f}/s destroy "
+						"{:.0f}/s ({} stale handles resolved)\n",
+						count, hashedRates.m_create, hashedRates.m_lookup,
+						hashedRates.m_destroy, slotRates.m_create,
+						slotRates.m_lookup, slotRates.m_destroy,
+						slotRates.m_staleResolves)
+				.c_str());
+	}
+	auto BenchmarkProjectileChurn(oxySize count) -> void
+	{
+		constexpr auto k_rounds = 10;
+		const auto Seconds = [](const auto& start) {
+			return std::chrono::duration<oxyF64>(
+					   std::chrono::steady_clock::now() - start)
+				.count();
+		};
+
+		auto& om = ObjectManager::GetInstance();
+		auto world = om.CreateManagedObject<World>();
+		std::vector<std::shared_ptr<Entity>> projectiles;
+		projectiles.reserve(count);
+		oxyF64 spawnSeconds{};
+		oxyF64 iterateSeconds{};
+		oxyF64 destroySeconds{};
+		for (auto round = 0; round < k_rounds; ++round)
+		{
+			// Set up as GameManager spawns a grenade, less the mesh
+			auto start = std::chrono::steady_clock::now();
+			for (oxySize i = 0; i < count; ++i)
+			{
+				auto ent = world->SpawnEntity();
+				ent->SetFlag(EntityFlags_Dynamic, true);
+				ent->SetFlag(EntityFlags_HasHull, true);
+				auto hull = ent->AddComponent<HullComponent>();
+				hull->SetHull(CollisionHull_Grenade);
+				hull->SetGravityPerSecond(800.f);
+				hull->SetResponse(CollisionResponseType_Bounce);
+				hull->SetSolidToOtherHulls(false);
+				hull->SetVelocity({1.f, 0.f, 0.f});
+				auto proj = ent->AddComponent<ProjectileComponent>();
+				proj->SetBouncesLeft(0);
+				proj->SetDamage(128.f);
+				proj->SetDamageRadius(64.f);
+				proj->SetHull(hull);
+				projectiles.push_back(std::move(ent));
+			}
+			spawnSeconds += Seconds(start);
+
+			start = std::chrono::steady_clock::now();
+			auto sum = 0.f;
+			om.ForEachObject<HullComponent>(
+				[&](const HullComponent& hull) { sum += hull.GetVelocity().x; });
+			iterateSeconds += Seconds(start);
+			OXYCHECK(sum == static_cast<oxyF32>(count));
+
+			// Destroy in a shuffled order so the free lists are fragmented
+			// the way a running game leaves them
+			for (oxySize i = projectiles.size(); i > 1; --i)
+				std::swap(projectiles[i - 1],
+						  projectiles[RandomU64(0, static_cast<oxyU64>(i - 1))]);
+			start = std::chrono::steady_clock::now();
+			for (auto& ent : projectiles)
+			{
+				ent->Destroy();
+				ent.reset();
+			}
+			projectiles.clear();
+			destroySeconds += Seconds(start);
+		}
+
+		const auto spawned = static_cast<oxyF64>(count) * k_rounds;
+		LogMessage(std::format("BenchmarkProjectileChurn {} x{}: spawn "
+							   "{:.0f}/s iterate {:.0f}/s destroy {:.0f}/s\n",
+							   count, k_rounds, spawned / spawnSeconds,
+							   spawned / iterateSeconds,
+							   spawned / destroySeconds)
+					   .c_str());
+		om.LogPoolStats();
 	}
-}; // namespace oxygen
\ No newline at end of file
+}; // namespace oxygen
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "Singleton/Singleton.h"
+#include "Object/ObjectPool.h"
 
 namespace oxygen
 {
+	// Objects live in slot tables addressed by 32-bit generational handles:
+	// bits 0-19 are the slot index, bits 20-30 the slot generation (never 0,
+	// so a valid handle is never 0) and bit 31 selects the network table,
+	// whose handles the host hands out and clients mirror verbatim. A freed
+	// slot waits behind k_handleReuseDelay others before it is handed out
+	// again, and one whose generation runs out is retired rather than
+	// wrapped, so a stale handle never resolves to a newer object.
 	struct ObjectManager : SingletonBase<ObjectManager>
 	{
+		ObjectManager();
 		~ObjectManager();
 
 		template <typename T>
@@ -37,18 +46,170 @@ namespace oxygen
 		auto
 		GetManagedRef(oxyObjectID id) const -> std::shared_ptr<ManagedObject>;
 
+		// Reserves a network handle for an object the host is about to
+		// create and replicate
+		auto AllocateNetworkID() -> oxyObjectID;
+
+		auto GetLiveObjectCount() const -> oxySize
+		{
+			return m_liveObjectCount;
+		}
+
+		// Visits every live instance of exactly T, pool chunk by pool chunk
+		template <typename T, typename Fn>
+		auto ForEachObject(const Fn& fn) -> void
+			requires std::is_base_of_v<Object, T> &&
+					 std::is_same_v<typename T::SelfType, T>;
+
+		auto GetPoolStats() const -> std::vector<ObjectPoolStats>;
+		auto LogPoolStats() const -> void;
+
+		// Blocks per chunk for the types that are spawned in bulk, others
+		// grow k_defaultBlocksPerChunk at a time
+		struct PoolConfig
+		{
+			std::string_view m_typeName{};
+			oxyU32 m_blocksPerChunk{};
+			oxyU32 m_initialChunks{};
+		};
+		static inline constexpr PoolConfig k_poolConfigs[] = {
+			{"Entity", 256, 1},
+			{"HullComponent", 256, 1},
+			{"StaticMeshComponent", 256, 1},
+			{"ProjectileComponent", 128, 1},
+			{"HealthComponent", 64, 0},
+			{"WeaponComponent", 64, 0},
+		};
+		static inline constexpr auto k_defaultBlocksPerChunk = oxyU32{32};
+		static inline constexpr auto k_controlBlocksPerChunk = oxyU32{512};
+
+		static inline constexpr auto k_handleIndexBits = 20;
+		static inline constexpr auto k_handleGenerationBits = 11;
+		static inline constexpr auto k_handleIndexMask =
+			(oxyObjectID{1} << k_handleIndexBits) - 1;
+		static inline constexpr auto k_handleGenerationMask =
+			(oxyObjectID{1} << k_handleGenerationBits) - 1;
+		static inline constexpr auto k_handleNetworkBit = oxyObjectID{1}
+														  << 31;
+		// Free slots a table keeps before it reuses the oldest of them
+		static inline constexpr auto k_handleReuseDelay = oxySize{1024};
+
 	  private:
-		oxyObjectID m_nextDynamicID{0x40000001};
-		std::unordered_map<oxyObjectID, Object*> m_objects{};
-		std::unordered_map<Object*, oxyObjectID> m_objectIDs{};
+		struct Slot
+		{
+			Object* m_object{};
+			oxyU32 m_generation{1};
+			oxyBool m_reserved{};
+			oxyBool m_managed{};
+		};
+		struct SlotTable
+		{
+			std::vector<Slot> m_slots{};
+			// Queued oldest first, live ones are [m_freeFront, size)
+			std::vector<oxyU32> m_freeIndices{};
+			oxySize m_freeFront{};
+		};
+
+		auto GetTable(oxyObjectID id) -> SlotTable&
+		{
+			return (id & k_handleNetworkBit) ? m_networkSlots : m_localSlots;
+		}
+		auto GetTable(oxyObjectID id) const -> const SlotTable&
+		{
+			return (id & k_handleNetworkBit) ? m_networkSlots : m_localSlots;
+		}
+		static auto AssignTypeIntervals() -> void;
+		auto AllocateHandle(SlotTable& table,
+							oxyObjectID networkBit) -> oxyObjectID;
+		auto FindSlot(oxyObjectID id) const -> const Slot*;
+		auto GetPool(const ObjectDescription& desc) -> ObjectPool&;
+		auto GetControlBlockPool(oxySize size, oxySize align) -> ObjectPool&;
+
+		SlotTable m_localSlots{};
+		SlotTable m_networkSlots{};
+		oxySize m_liveObjectCount{};
+
+		std::vector<std::unique_ptr<ObjectPool>> m_pools{};
+		std::vector<std::unique_ptr<ObjectPool>> m_controlBlockPools{};
 
-		oxyObjectID m_nextManagedID{0x80000001};
-		std::unordered_map<oxyObjectID, std::weak_ptr<ManagedObject>>
-			m_managedObjects{};
 		struct ManagedObjectDeleter
 		{
 			auto operator()(ManagedObject* obj) -> void;
 		};
+		// Lets shared_ptr place its control blocks in a pool as well
+		template <typename T> struct ControlBlockAllocator
+		{
+			using value_type = T;
+			ControlBlockAllocator() = default;
+			template <typename U>
+			ControlBlockAllocator(const ControlBlockAllocator<U>&)
+			{
+			}
+			auto allocate(oxySize n) -> T*
+			{
+				OXYCHECK(n == 1);
+				return static_cast<T*>(GetPool().Allocate());
+			}
+			auto deallocate(T* p, oxySize) -> void
+			{
+				GetPool().Free(p);
+			}
+			template <typename U>
+			auto operator==(const ControlBlockAllocator<U>&) const -> bool
+			{
+				return true;
+			}
+
+		  private:
+			static auto GetPool() -> ObjectPool&
+			{
+				static auto& pool =
+					ObjectManager::GetInstance().GetControlBlockPool(
+						sizeof(T), alignof(T));
+				return pool;
+			}
+		};
+	};
+
+	// Compares and serialises as a plain handle, resolves in O(1) and
+	// yields null once the object is gone or the slot has been reused
+	template <typename T> struct ObjectHandle
+	{
+		ObjectHandle() = default;
+		explicit ObjectHandle(oxyObjectID id) : m_id(id)
+		{
+		}
+		explicit ObjectHandle(const T* obj)
+			: m_id(obj ? obj->GetObjectID() : 0)
+		{
+		}
+
+		auto Get() const -> T*
+		{
+			return ObjectManager::GetInstance().GetObjectPtr<T>(m_id);
+		}
+		auto GetRef() const -> std::shared_ptr<T>
+			requires std::is_base_of_v<ManagedObject, T>
+		{
+			return ObjectManager::GetInstance()
+				.GetManagedRef<std::remove_const_t<T>>(m_id);
+		}
+		auto GetID() const -> oxyObjectID
+		{
+			return m_id;
+		}
+		auto Reset() -> void
+		{
+			m_id = 0;
+		}
+		explicit operator bool() const
+		{
+			return m_id != 0;
+		}
+		auto operator==(const ObjectHandle&) const -> bool = default;
+
+	  private:
+		oxyObjectID m_id{};
 	};
 
 	template <typename T>
@@ -56,21 +217,7 @@ namespace oxygen
 		requires std::is_base_of_v<Object, T> &&
 				 std::is_same_v<typename T::SelfType, T>
 	{
-		if (!id)
-			id = ++m_nextDynamicID;
-		else
-		{
-			const auto it = m_objects.find(id);
-			if (it != m_objects.end())
-				return static_cast<T*>(it->second);
-		}
-		const auto storage =
-			::operator new[](sizeof(T), std::align_val_t{alignof(T)});
-		const auto obj = new (storage) T{};
-		OXYCHECK(storage == obj);
-		m_objects.emplace(id, obj);
-		m_objectIDs.emplace(obj, id);
-		return obj;
+		return static_cast<T*>(NewObject(T::GetStaticDescription(), id));
 	}
 
 	template <typename T>
@@ -79,32 +226,33 @@ namespace oxygen
 		requires std::is_base_of_v<ManagedObject, T> &&
 				 std::is_same_v<typename T::SelfType, T>
 	{
-		if (!id)
-			id = ++m_nextManagedID;
-		else
-		{
-			const auto it = m_managedObjects.find(id);
-			if (it != m_managedObjects.end())
-			{
-				auto sptr = it->second.lock();
-				if (sptr)
-					return std::static_pointer_cast<T>(std::move(sptr));
-				return nullptr;
-			}
-		}
-		const auto ptr = NewObject<T>(id);
-		auto sptr = std::shared_ptr<T>(ptr, ManagedObjectDeleter{});
-		ptr->m_id = id;
-		ptr->m_self = sptr;
-		m_managedObjects.emplace(id, sptr);
-		return sptr;
+		auto sptr = CreateManagedObject(T::GetStaticDescription(), id);
+		if (sptr && sptr->IsA(T::GetStaticDescription()))
+			return std::static_pointer_cast<T>(std::move(sptr));
+		return nullptr;
+	}
+
+	template <typename T, typename Fn>
+	auto ObjectManager::ForEachObject(const Fn& fn) -> void
+		requires std::is_base_of_v<Object, T> &&
+				 std::is_same_v<typename T::SelfType, T>
+	{
+		const auto& desc = T::GetStaticDescription();
+		if (!desc.m_poolIndex)
+			return;
+		m_pools[desc.m_poolIndex - 1]->ForEachAllocated([&](void* block) {
+			fn(*static_cast<T*>(static_cast<Object*>(block)));
+		});
 	}
 
 	template <typename T>
 	auto ObjectManager::GetObjectPtr(oxyObjectID id) const -> T*
 		requires std::is_base_of_v<Object, T>
 	{
-		return static_cast<T*>(GetObjectPtr(id));
+		const auto obj = GetObjectPtr(id);
+		if (obj && obj->IsA<std::remove_const_t<T>>())
+			return static_cast<T*>(obj);
+		return nullptr;
 	}
 
 	template <typename T>
@@ -120,4 +268,12 @@ namespace oxygen
 		}
 		return ref;
 	}
-}; // namespace oxygen
\ No newline at end of file
+
+	// Times create, lookup and destroy of count managed objects through the
+	// slot tables against the unordered_map bookkeeping they replaced
+	auto BenchmarkObjectManager(oxySize count) -> void;
+	// Spawns count grenade projectiles (entity, hull and projectile
+	// component) into a world and destroys them with Entity::Destroy, a few
+	// rounds over, and logs the rates with the pool stats
+	auto BenchmarkProjectileChurn(oxySize count) -> void;
+}; // namespace oxygen
@@ -0,0 +1,112 @@
+#include "OxygenPCH.h"
+#include "ObjectPool.h"
+
+namespace oxygen
+{
+	ObjectPool::ObjectPool(std::string_view name, oxySize size, oxySize align,
+						   oxySize blocksPerChunk, oxySize initialChunks)
+		: m_align((std::max)(align, alignof(FreeBlock)))
+	{
+		m_stats.m_name = name;
+		m_stats.m_blockSize = GetSizeClass(size, m_align);
+		m_stats.m_blocksPerChunk = (std::max)(blocksPerChunk, oxySize{1});
+		for (oxySize i = 0; i < initialChunks; ++i)
+			AddChunk();
+	}
+
+	ObjectPool::~ObjectPool()
+	{
+		// Control blocks outlive their objects while weak_ptrs to them are
+		// around, those are left to the process exit rather than freed under
+		// the weak_ptrs still pointing into the chunk
+		if (m_stats.m_live)
+			return;
+		for (const auto& chunk : m_chunks)
+			::operator delete[](chunk.m_blocks, std::align_val_t{m_align});
+	}
+
+	auto ObjectPool::GetSizeClass(oxySize size, oxySize align) -> oxySize
+	{
+		const auto step = size <= 256 ? 16 : size <= 1024 ? 64 : 256;
+		const auto granularity = (std::max)(oxySize(step), align);
+		size = (std::max)(size, sizeof(FreeBlock));
+		return (size + granularity - 1) / granularity * granularity;
+	}
+
+	auto ObjectPool::AddChunk() -> void
+	{
+		Chunk chunk{};
+		chunk.m_blocks = static_cast<oxyU8*>(::operator new[](
+			m_stats.m_blockSize * m_stats.m_blocksPerChunk,
+			std::align_val_t{m_align}));
+		chunk.m_used.Resize(m_stats.m_blocksPerChunk);
+		// Thread the blocks in reverse so the first allocation comes from
+		// the start of the chunk
+		for (auto i = m_stats.m_blocksPerChunk; i > 0; --i)
+		{
+			const auto block = reinterpret_cast<FreeBlock*>(
+				chunk.m_blocks + (i - 1) * m_stats.m_blockSize);
+			block->m_next = m_freeList;
+			m_freeList = block;
+		}
+		const auto it = std::upper_bound(
+			m_chunks.begin(), m_chunks.end(), chunk.m_blocks,
+			[](const oxyU8* blocks, const Chunk& c) {
+				return blocks < c.m_blocks;
+			});
+		m_chunks.insert(it, std::move(chunk));
+		++m_stats.m_chunks;
+	}
+
+	auto ObjectPool::FindChunk(const void* block) -> Chunk&
+	{
+		const auto bytes = static_cast<const oxyU8*>(block);
+		auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), bytes,
+								   [](const oxyU8* b, const Chunk& c) {
+									   return b < c.m_blocks;
+								   });
+		OXYCHECK(it != m_chunks.begin());
+		--it;
+		OXYCHECK(bytes < it->m_blocks +
+							 m_stats.m_blockSize * m_stats.m_blocksPerChunk);
+		return *it;
+	}
+
+	auto ObjectPool::Allocate() -> void*
+	{
+		if (!m_freeList)
+			AddChunk();
+		const auto block = m_freeList;
+		m_freeList = block->m_next;
+
+		auto& chunk = FindChunk(block);
+		const auto index =
+			(reinterpret_cast<oxyU8*>(block) - chunk.m_blocks) /
+			m_stats.m_blockSize;
+		OXYCHECK(!chunk.m_used.Test(index));
+		chunk.m_used.Set(index);
+
+		++m_stats.m_allocations;
+		++m_stats.m_live;
+		m_stats.m_peak = (std::max)(m_stats.m_peak, m_stats.m_live);
+		return block;
+	}
+
+	auto ObjectPool::Free(void* block) -> void
+	{
+		if (!block)
+			return;
+		auto& chunk = FindChunk(block);
+		const auto index =
+			(static_cast<oxyU8*>(block) - chunk.m_blocks) / m_stats.m_blockSize;
+		OXYCHECK(chunk.m_used.Test(index));
+		chunk.m_used.Reset(index);
+
+		const auto freeBlock = static_cast<FreeBlock*>(block);
+		freeBlock->m_next = m_freeList;
+		m_freeList = freeBlock;
+
+		++m_stats.m_frees;
+		--m_stats.m_live;
+	}
+}; // namespace oxygen
@@ -0,0 +1,71 @@
+#pragma once
+
+namespace oxygen
+{
+	struct ObjectPoolStats
+	{
+		std::string_view m_name{};
+		oxySize m_blockSize{};
+		oxySize m_blocksPerChunk{};
+		oxySize m_chunks{};
+		oxySize m_live{};
+		oxySize m_peak{};
+		oxySize m_allocations{};
+		oxySize m_frees{};
+	};
+
+	// Fixed-size blocks carved out of chunks that are never returned while
+	// the pool lives. Instances of one type end up side by side and are
+	// walked chunk by chunk.
+	struct ObjectPool : NonCopyable
+	{
+		ObjectPool(std::string_view name, oxySize size, oxySize align,
+				   oxySize blocksPerChunk, oxySize initialChunks = 0);
+		~ObjectPool();
+
+		auto Allocate() -> void*;
+		auto Free(void* block) -> void;
+
+		// Calls fn(void*) for every allocated block in address order
+		template <typename Fn> auto ForEachAllocated(const Fn& fn) const -> void
+		{
+			for (const auto& chunk : m_chunks)
+			{
+				for (oxySize i = 0; i < m_stats.m_blocksPerChunk; ++i)
+				{
+					if (chunk.m_used.Test(i))
+						fn(chunk.m_blocks + i * m_stats.m_blockSize);
+				}
+			}
+		}
+
+		auto GetStats() const -> const ObjectPoolStats&
+		{
+			return m_stats;
+		}
+
+		// Rounds size up to the block stride its pool uses: 16 byte steps to
+		// 256, 64 byte steps to 1024, 256 byte steps past that
+		static auto GetSizeClass(oxySize size, oxySize align) -> oxySize;
+
+	  private:
+		struct Chunk
+		{
+			oxyU8* m_blocks{};
+			DynamicBitset m_used{};
+		};
+		struct FreeBlock
+		{
+			FreeBlock* m_next{};
+		};
+
+		auto AddChunk() -> void;
+		auto FindChunk(const void* block) -> Chunk&;
+
+		// Sorted by address so a block finds its chunk with a binary search
+		std::vector<Chunk> m_chunks{};
+		FreeBlock* m_freeList{};
+		oxySize m_align{};
+		ObjectPoolStats m_stats{};
+	};
+}; // namespace oxygen
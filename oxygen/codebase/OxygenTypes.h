@@ -21,13 +21,15 @@ using oxyWChar = wchar_t;
 using oxySize = size_t;
 using oxySSize = ptrdiff_t;
 
-using oxyObjectID = oxyU64;
+using oxyObjectID = oxyU32;
 
 #include "Math/Defs.h"
 #include "Math/Hash.h"
 #include "Math/Random.h"
 
+#include "Containers/DynamicBitset.h"
 #include "Containers/SPSCQueue.h"
+#include "Containers/TripleBuffer.h"
 
 namespace oxygen
 {
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <bitset>
 
 // spans
@@ -41,6 +42,10 @@
 
 // formatting
 #include <format>
+#include <charconv>
+
+// time
+#include <chrono>
 
 // math
 #include <cmath>
@@ -10,6 +10,11 @@ namespace oxygen
 	auto LogMessage(const char* str) -> void;
 
 	auto ReadFileContents(std::string_view absolutePath) -> std::vector<oxyU8>;
+	auto WriteFileContents(std::string_view absolutePath,
+						   std::span<const oxyU8> contents) -> oxyBool;
+	// Size and last write time without opening the file, false if missing
+	auto GetFileStamp(std::string_view absolutePath, oxyU64& size,
+					  oxyU64& writeTime) -> oxyBool;
 
 	struct FileMap : NonCopyable
 	{
@@ -56,6 +61,18 @@ namespace oxygen
 		};
 		auto
 		LoadTexture(const char* absolutePath) -> std::shared_ptr<const Texture>;
+		// LoadTexture in two halves, the decode can run on any thread and the
+		// upload has to happen on the GL thread
+		struct DecodedTexture
+		{
+			oxyU32 m_width{};
+			oxyU32 m_height{};
+			std::shared_ptr<const oxyU8> m_rgba{};
+		};
+		auto DecodeTexture(const char* absolutePath)
+			-> std::optional<DecodedTexture>;
+		auto UploadTexture(const DecodedTexture& decoded)
+			-> std::shared_ptr<const Texture>;
 
 		struct TexturedQuad
 		{
@@ -9,6 +9,7 @@
 
 // Ubisoft API
 #include "App/app.h"
+#include "stb_image/stb_image.h"
 #include "PrivateMembers.h"
 
 
@@ -28,6 +29,54 @@ namespace oxygen
 		oxyBool g_wsaInitialized{};
 		oxyU64 g_renderCount{};
 		oxyU64 g_updateCount{};
+
+		// Sprites own GL textures, which can only be released on the GL
+		// thread. Anything dropped elsewhere (the render thread) waits here.
+		std::thread::id g_glThreadId{};
+		std::mutex g_pendingSpriteDeletesMutex;
+		std::vector<CSimpleSprite*> g_pendingSpriteDeletes;
+		// Uploaded textures, unlike the framework's, are not shared
+		std::vector<GLuint> g_pendingTextureDeletes;
+
+		auto FlushPendingSpriteDeletes() -> void
+		{
+			std::vector<CSimpleSprite*> sprites;
+			std::vector<GLuint> textures;
+			{
+				std::lock_guard lock{g_pendingSpriteDeletesMutex};
+				sprites.swap(g_pendingSpriteDeletes);
+				textures.swap(g_pendingTextureDeletes);
+			}
+			for (const auto sprite : sprites)
+				delete sprite;
+			if (!textures.empty())
+				glDeleteTextures(static_cast<GLsizei>(textures.size()),
+								 textures.data());
+		}
+
+		struct TextureDeleter
+		{
+			// Set for textures made by UploadTexture
+			GLuint m_ownedTexture{};
+
+			auto operator()(const GraphicsAbstraction::Texture* texture) -> void
+			{
+				const auto sprite =
+					static_cast<CSimpleSprite*>(texture->m_internalPlatformHandle);
+				delete texture;
+				if (std::this_thread::get_id() == g_glThreadId)
+				{
+					delete sprite;
+					if (m_ownedTexture)
+						glDeleteTextures(1, &m_ownedTexture);
+					return;
+				}
+				std::lock_guard lock{g_pendingSpriteDeletesMutex};
+				g_pendingSpriteDeletes.push_back(sprite);
+				if (m_ownedTexture)
+					g_pendingTextureDeletes.push_back(m_ownedTexture);
+			}
+		};
 	}; // namespace
 	auto GetExecutableDirectory() -> std::string_view
 	{
@@ -72,6 +121,39 @@ namespace oxygen
 		fileContents.resize(bytesRead);
 		return fileContents;
 	}
+	auto WriteFileContents(std::string_view absolutePath,
+						   std::span<const oxyU8> contents) -> oxyBool
+	{
+		const auto path = std::string{absolutePath};
+		const auto file =
+			CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+						FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		DWORD bytesWritten{};
+		const auto ok =
+			WriteFile(file, contents.data(),
+					  static_cast<DWORD>(contents.size()), &bytesWritten,
+					  nullptr) &&
+			bytesWritten == contents.size();
+		CloseHandle(file);
+		return ok;
+	}
+	auto GetFileStamp(std::string_view absolutePath, oxyU64& size,
+					  oxyU64& writeTime) -> oxyBool
+	{
+		const auto path = std::string{absolutePath};
+		WIN32_FILE_ATTRIBUTE_DATA data{};
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+			return false;
+		size = (static_cast<oxyU64>(data.nFileSizeHigh) << 32) |
+			   data.nFileSizeLow;
+		writeTime = (static_cast<oxyU64>(data.ftLastWriteTime.dwHighDateTime)
+					 << 32) |
+					data.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
 
 	struct InternalFileMapWinX64 : FileMap
 	{
@@ -212,6 +294,7 @@ namespace oxygen
 			g_wsaInitialized = false;
 		});
 
+		g_glThreadId = std::this_thread::get_id();
 		EngineSingletons::Construct();
 		std::atexit(EngineSingletons::Destruct);
 	}
@@ -219,10 +302,10 @@ namespace oxygen
 	{
 		if (!g_updateCount)
 			return;
-		oxyS32 w, h;
-		GraphicsAbstraction::GetWindowSize(w, h);
-		GfxRenderer::GetInstance().BeginFrame(w, h);
-		GfxRenderer::GetInstance().EndFrame();
+		// The frame itself was built on the render thread, only the GL
+		// calls are left for here
+		GfxRenderer::GetInstance().Present();
+		FlushPendingSpriteDeletes();
 		++g_renderCount;
 	}
 	auto Win64PlatformUpdate(float deltaTimeSeconds) -> void
@@ -231,11 +314,17 @@ namespace oxygen
 		InputManager::GetInstance().Update();
 		UIManager::GetInstance().Update();
 		GameManager::GetInstance().Update(deltaTimeSeconds);
+		oxyS32 w, h;
+		GraphicsAbstraction::GetWindowSize(w, h);
+		GfxRenderer::GetInstance().CaptureFrame(w, h);
 		++g_updateCount;
 	}
 	auto Win64PlatformShutdown() -> void
 	{
+		// Nothing may still be rendering while the singletons go away
+		GfxRenderer::GetInstance().StopRenderThread();
 		EngineSingletons::Destruct();
+		FlushPendingSpriteDeletes();
 		if (g_wsaInitialized)
 			WSACleanup();
 		g_wsaInitialized = false;
@@ -266,20 +355,70 @@ namespace oxygen
 				delete ubisprite;
 				return nullptr;
 			}
-			struct TextureDeleter
-			{
-				auto operator()(const Texture* texture) -> void
-				{
-					delete static_cast<CSimpleSprite*>(
-						texture->m_internalPlatformHandle);
-				}
-			};
 			const auto tex = new Texture;
 			tex->m_width = width;
 			tex->m_height = height;
 			tex->m_internalPlatformHandle = ubisprite;
 			return std::unique_ptr<const Texture, TextureDeleter>{tex};
 		}
+		auto DecodeTexture(const char* absolutePath)
+			-> std::optional<DecodedTexture>
+		{
+			int width, height, channels;
+			const auto pixels =
+				stbi_load(absolutePath, &width, &height, &channels, 4);
+			if (!pixels)
+				return std::nullopt;
+			if (width <= 0 || height <= 0)
+			{
+				stbi_image_free(pixels);
+				return std::nullopt;
+			}
+			return DecodedTexture{static_cast<oxyU32>(width),
+								  static_cast<oxyU32>(height),
+								  {pixels, stbi_image_free}};
+		}
+		auto UploadTexture(const DecodedTexture& decoded)
+			-> std::shared_ptr<const Texture>
+		{
+			if (!decoded.m_rgba || !decoded.m_width || !decoded.m_height)
+				return nullptr;
+
+			// Same setup as CSimpleSprite::LoadTexture
+			GLuint texture{};
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+							GL_LINEAR_MIPMAP_NEAREST);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			gluBuild2DMipmaps(GL_TEXTURE_2D, 4, decoded.m_width,
+							  decoded.m_height, GL_RGBA, GL_UNSIGNED_BYTE,
+							  decoded.m_rgba.get());
+
+			// The framework only makes sprites from files, so an empty one is
+			// pointed at the new texture instead
+			const auto ubisprite = App::CreateSprite("", 1, 1);
+			if (!ubisprite)
+			{
+				glDeleteTextures(1, &texture);
+				return nullptr;
+			}
+			*ubisprite.*g_CSimpleSpriteMemberPointerMTexture = texture;
+			*ubisprite.*g_CSimpleSpriteMemberPointerMTexWidth =
+				static_cast<int>(decoded.m_width);
+			*ubisprite.*g_CSimpleSpriteMemberPointerMTexHeight =
+				static_cast<int>(decoded.m_height);
+
+			const auto tex = new Texture;
+			tex->m_width = decoded.m_width;
+			tex->m_height = decoded.m_height;
+			tex->m_internalPlatformHandle = ubisprite;
+			return std::unique_ptr<const Texture, TextureDeleter>{
+				tex, TextureDeleter{texture}};
+		}
 
 		auto DrawTexturedQuad(const TexturedQuad& quad) -> void
 		{
@@ -47,6 +47,11 @@ namespace oxygen
 		static inline float CSimpleSprite::*g_CSimpleSpriteMemberPointerMYPos{};
 		template struct NTTPAssigner<g_CSimpleSpriteMemberPointerMYPos,
 									 &CSimpleSprite::m_ypos>;
+		// GLuint m_texture;
+		static inline GLuint CSimpleSprite::*
+			g_CSimpleSpriteMemberPointerMTexture{};
+		template struct NTTPAssigner<g_CSimpleSpriteMemberPointerMTexture,
+									 &CSimpleSprite::m_texture>;
 		// int m_texWidth;
 		static inline int CSimpleSprite::*
 			g_CSimpleSpriteMemberPointerMTexWidth{};
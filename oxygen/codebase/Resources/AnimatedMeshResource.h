@@ -1,5 +1,7 @@
 #pragma once
 
+#include "StaticMeshResource.h"
+
 namespace oxygen
 {
 	struct AnimationInfo
@@ -8,7 +10,9 @@ namespace oxygen
 	};
 	struct AnimatedMeshResource
 	{
-		std::shared_ptr<const struct StaticMeshResource> m_rootPose;
+		std::shared_ptr<const StaticMeshResource> m_rootPose;
 		std::unordered_map<oxyU32, AnimationInfo> m_animations;
+		// Encloses the root pose and every animation frame
+		MeshBounds m_bounds;
 	};
 };
\ No newline at end of file
@@ -8,6 +8,40 @@
 
 namespace oxygen
 {
+	namespace
+	{
+		// AABB, then a sphere around its centre enclosing every point
+		template <typename Fun>
+		auto ComputeMeshBounds(Fun&& forEachPoint) -> MeshBounds
+		{
+			MeshBounds bounds{};
+			oxyBool first = true;
+			forEachPoint([&](const oxyVec3& p) {
+				if (first)
+				{
+					bounds.m_min = p;
+					bounds.m_max = p;
+					first = false;
+					return;
+				}
+				bounds.m_min = {std::min(bounds.m_min.x, p.x),
+								std::min(bounds.m_min.y, p.y),
+								std::min(bounds.m_min.z, p.z)};
+				bounds.m_max = {std::max(bounds.m_max.x, p.x),
+								std::max(bounds.m_max.y, p.y),
+								std::max(bounds.m_max.z, p.z)};
+			});
+			bounds.m_sphereCenter = (bounds.m_min + bounds.m_max) * 0.5f;
+			oxyF32 radiusSq{};
+			forEachPoint([&](const oxyVec3& p) {
+				radiusSq = std::max(
+					radiusSq, (p - bounds.m_sphereCenter).MagnitudeSquared());
+			});
+			bounds.m_sphereRadius = std::sqrtf(radiusSq);
+			return bounds;
+		}
+	}; // namespace
+
 	auto ResourceManager::LoadStaticMesh(std::string_view name)
 		-> std::shared_ptr<const StaticMeshResource>
 	{
@@ -60,6 +94,12 @@ namespace oxygen
 			return {};
 		res->m_texname = {texname, len};
 
+		res->m_bounds = ComputeMeshBounds([&](auto&& cb) {
+			for (const auto& tri : res->m_tris)
+				for (const auto& vert : tri.m_vertices)
+					cb(vert.m_position);
+		});
+
 		m_staticMeshes[hash] = res;
 		return res;
 	}
@@ -114,6 +154,17 @@ namespace oxygen
 
 		while (ReadOutFrame())
 			;
+
+		res->m_bounds = ComputeMeshBounds([&](auto&& cb) {
+			if (res->m_rootPose)
+				for (const auto& tri : res->m_rootPose->m_tris)
+					for (const auto& vert : tri.m_vertices)
+						cb(vert.m_position);
+			for (const auto& [hash, anim] : res->m_animations)
+				for (const auto& frame : anim.m_frames)
+					for (const auto& vert : frame)
+						cb(vert);
+		});
 		return res;
 	}
 }; // namespace oxygen
\ No newline at end of file
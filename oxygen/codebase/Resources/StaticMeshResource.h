@@ -19,10 +19,20 @@ namespace oxygen
 		oxyVec3 m_position;
 	};
 
+	// Local space, computed on load
+	struct MeshBounds
+	{
+		oxyVec3 m_min{};
+		oxyVec3 m_max{};
+		oxyVec3 m_sphereCenter{};
+		oxyF32 m_sphereRadius{};
+	};
+
 	struct StaticMeshResource
 	{
 		std::vector<StaticMeshPointDef> m_points;
 		std::vector<StaticMeshTri> m_tris;
 		std::string m_texname;
+		MeshBounds m_bounds;
 	};
 };
\ No newline at end of file
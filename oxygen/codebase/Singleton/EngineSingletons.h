@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Singleton.h"
+#include "Job/JobSystem.h"
 #include "Object/ObjectManager.h"
 #include "Input/InputManager.h"
 #include "Gfx/GfxRenderer.h"
@@ -13,6 +14,8 @@ namespace oxygen
 {
 	struct InternalEngineSingletonsOrder
 	{
+		// First in, last out, every other singleton may submit jobs
+		SingletonInstance<JobSystem> m_jobSystemInstance{};
 		SingletonInstance<ObjectManager> m_objectManagerInstance{};
 		SingletonInstance<InputManager> m_inputManagerInstance{};
 		SingletonInstance<GfxRenderer> m_gfxRendererInstance{};
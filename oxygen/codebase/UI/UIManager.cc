@@ -58,6 +58,19 @@ namespace oxygen
 			m_mainMenuOpen = !m_mainMenuOpen;
 		}
 
+		if (InputManager::GetInstance().IsKeyDown(KeyboardButton_F3) &&
+			!InputManager::GetInstance().WasKeyDown(KeyboardButton_F3))
+		{
+			auto& gfx = GfxRenderer::GetInstance();
+			gfx.SetShowStats(!gfx.GetShowStats());
+		}
+		if (InputManager::GetInstance().IsKeyDown(KeyboardButton_F4) &&
+			!InputManager::GetInstance().WasKeyDown(KeyboardButton_F4))
+		{
+			auto& gfx = GfxRenderer::GetInstance();
+			gfx.SetLateLatchEnabled(!gfx.GetLateLatchEnabled());
+		}
+
 		if (m_mainMenuOpen)
 		{
 			const auto mainmenuitemselected = MainMenuItemSelected();
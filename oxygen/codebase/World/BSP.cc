@@ -5,147 +5,213 @@
 
 namespace oxygen
 {
-	auto BSPWorldData::Load(std::string_view mapname) -> oxyBool
+	namespace
 	{
-		const auto filemap = CreateFileMap(
-			std::format("{}/maps/{}.bsp", GetExecutableDirectory(), mapname));
-		if (!filemap)
-			return false;
-
-		const auto GetLumpInfo =
-			[&](BSPDefines::LumpIndex index) -> std::pair<const void*, oxySize> {
-			const auto header =
-				reinterpret_cast<const BSPDefines::Header*>(filemap->GetMap());
-			if (!filemap->ValidateRange(header, sizeof(BSPDefines::Header)))
+		auto GetLumpRange(const FileMap& filemap, BSPDefines::LumpIndex index)
+			-> std::span<const oxyU8>
+		{
+			const auto base = reinterpret_cast<const oxyU8*>(filemap.GetMap());
+			if (!filemap.ValidateRange(base, sizeof(BSPDefines::Header)))
 				return {};
 
 			BSPDefines::Lump lump;
-			std::memcpy(&lump, &header->m_lumps[index], sizeof(BSPDefines::Lump));
-			const auto ptr = reinterpret_cast<const oxyU8*>(filemap->GetMap()) +
-							 lump.m_fileOffset;
-			return {ptr, static_cast<oxySize>(lump.m_length)};
-		};
+			std::memcpy(&lump,
+						&reinterpret_cast<const BSPDefines::Header*>(base)
+							 ->m_lumps[index],
+						sizeof(BSPDefines::Lump));
+			if (!lump.m_length || lump.m_fileOffset > filemap.GetSize() ||
+				lump.m_length > filemap.GetSize() - lump.m_fileOffset)
+				return {};
+			return {base + lump.m_fileOffset, lump.m_length};
+		}
 
-		const auto LoadLump = [&](auto& storage,
-								  BSPDefines::LumpIndex index) -> oxyBool {
-			storage.clear();
-			const auto [addr, size] = GetLumpInfo(index);
-			if (!addr || !size)
+		// The view aliases the mapping, so the lump must be suitably aligned
+		// and a whole number of elements
+		template <typename T>
+		auto MapLump(const FileMap& filemap, BSPDefines::LumpIndex index,
+					 std::span<const T>& view) -> oxyBool
+		{
+			view = {};
+			const auto bytes = GetLumpRange(filemap, index);
+			if (bytes.empty())
 				return false;
-
-			if (!filemap->ValidateRange(addr, size))
+			if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) ||
+				bytes.size() % sizeof(T))
 				return false;
+			view = {reinterpret_cast<const T*>(bytes.data()),
+					bytes.size() / sizeof(T)};
+			return true;
+		}
 
-			const auto count =
-				size /
-				sizeof(std::remove_reference_t<decltype(storage)>::value_type);
-			storage.resize(count);
-			std::memcpy(storage.data(), addr, size);
+		// BSP30 to BSP2 layouts, indices are widened and bounds made float
+		auto Widen(const BSPDefines::Node16& node) -> BSPDefines::Node
+		{
+			BSPDefines::Node wide{node.m_planeIndex,
+								  {node.m_children[0], node.m_children[1]}};
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				wide.m_mins[axis] = node.m_mins[axis];
+				wide.m_maxs[axis] = node.m_maxs[axis];
+			}
+			wide.m_firstFaceIndex = node.m_firstFaceIndex;
+			wide.m_faceCount = node.m_faceCount;
+			return wide;
+		}
+		auto Widen(const BSPDefines::Face16& face) -> BSPDefines::Face
+		{
+			BSPDefines::Face wide{face.m_planeIndex, face.m_side,
+								  face.m_firstEdgeIndex, face.m_edgeCount,
+								  face.m_texInfoIndex};
+			std::copy(std::begin(face.m_lightStyles),
+					  std::end(face.m_lightStyles),
+					  std::begin(wide.m_lightStyles));
+			wide.m_lightMapOffset = face.m_lightMapOffset;
+			return wide;
+		}
+		auto Widen(const BSPDefines::ClipNode16& clipNode)
+			-> BSPDefines::ClipNode
+		{
+			return {clipNode.m_planeIndex,
+					{clipNode.m_children[0], clipNode.m_children[1]}};
+		}
+		auto Widen(const BSPDefines::Leaf16& leaf) -> BSPDefines::Leaf
+		{
+			BSPDefines::Leaf wide{leaf.m_contents, leaf.m_visOffset};
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				wide.m_mins[axis] = leaf.m_mins[axis];
+				wide.m_maxs[axis] = leaf.m_maxs[axis];
+			}
+			wide.m_firstMarkSurfaceIndex = leaf.m_firstMarkSurfaceIndex;
+			wide.m_markSurfaceCount = leaf.m_markSurfaceCount;
+			std::copy(std::begin(leaf.m_ambientLevels),
+					  std::end(leaf.m_ambientLevels),
+					  std::begin(wide.m_ambientLevels));
+			return wide;
+		}
+		auto Widen(const oxyU16 marksurface) -> oxyU32
+		{
+			return marksurface;
+		}
+		auto Widen(const BSPDefines::Edge16& edge) -> BSPDefines::Edge
+		{
+			return {{edge.m_vertexIndices[0], edge.m_vertexIndices[1]}};
+		}
+
+		// A BSP2 lump is mapped as is, a BSP30 one in its own layout and
+		// copied out wide into storage
+		template <typename Narrow, typename Wide>
+		auto MapWideLump(const FileMap& filemap, BSPDefines::LumpIndex index,
+						 oxyBool isBSP2, std::vector<Wide>& storage,
+						 std::span<const Wide>& view) -> oxyBool
+		{
+			storage.clear();
+			if (isBSP2)
+				return MapLump(filemap, index, view);
+			std::span<const Narrow> narrow;
+			if (!MapLump(filemap, index, narrow))
+				return false;
+			storage.reserve(narrow.size());
+			for (const auto& element : narrow)
+				storage.push_back(Widen(element));
+			view = storage;
 			return true;
-		};
+		}
+	}; // namespace
 
-		if (!LoadLump(m_planes, BSPDefines::LumpIndex_Planes))
+	auto BSPWorldData::GetFileBytes() const -> std::span<const oxyU8>
+	{
+		if (!m_fileMap)
+			return {};
+		return {reinterpret_cast<const oxyU8*>(m_fileMap->GetMap()),
+				m_fileMap->GetSize()};
+	}
+
+	auto BSPWorldData::Load(std::string_view mapname) -> oxyBool
+	{
+		m_fileMap = CreateFileMap(
+			std::format("{}/maps/{}.bsp", GetExecutableDirectory(), mapname));
+		if (!m_fileMap)
 			return false;
+		const auto& filemap = *m_fileMap;
 
-		// MipTex
+		if (!filemap.ValidateRange(filemap.GetMap(), sizeof(BSPDefines::Header)))
+			return false;
+		oxyS32 version;
+		std::memcpy(&version, filemap.GetMap(), sizeof(oxyS32));
+		if (version != BSPDefines::k_BSPVersion &&
+			version != BSPDefines::k_BSP2Version)
+			return false;
+		const auto isBSP2 = version == BSPDefines::k_BSP2Version;
+
+		if (!MapLump(filemap, BSPDefines::LumpIndex_Planes, m_planes))
+			return false;
+
+		// MipTex, the headers are scattered through the lump so they are
+		// gathered into one array
 		{
-			const auto [addr, size] = GetLumpInfo(BSPDefines::LumpIndex_Textures);
-			if (!addr || !size)
+			const auto bytes =
+				GetLumpRange(filemap, BSPDefines::LumpIndex_Textures);
+			if (bytes.size() < sizeof(oxyU32))
 				return false;
 
-			if (!filemap->ValidateRange(addr, size))
+			oxyU32 numMipTex;
+			std::memcpy(&numMipTex, bytes.data(), sizeof(oxyU32));
+			if (numMipTex > (bytes.size() - sizeof(oxyU32)) / sizeof(oxyU32))
 				return false;
-
-			const auto miptexlump =
-				reinterpret_cast<const BSPDefines::MipTexLump*>(addr);
 			m_miptex.clear();
-			m_miptex.resize(miptexlump->m_numMipTex);
-			for (oxyU32 i = 0; i < miptexlump->m_numMipTex; i++)
+			m_miptex.resize(numMipTex);
+			for (oxyU32 i = 0; i < numMipTex; i++)
 			{
-				const auto offset = miptexlump->m_dataOffsets[i];
-				const auto miptex = reinterpret_cast<const BSPDefines::MipTex*>(
-					reinterpret_cast<const oxyU8*>(miptexlump) + offset);
-				std::memcpy(&m_miptex[i], miptex, sizeof(BSPDefines::MipTex));
+				oxyU32 offset;
+				std::memcpy(&offset,
+							bytes.data() + sizeof(oxyU32) * (1 + i),
+							sizeof(oxyU32));
+				if (offset > bytes.size() ||
+					bytes.size() - offset < sizeof(BSPDefines::MipTex))
+					return false;
+				std::memcpy(&m_miptex[i], bytes.data() + offset,
+							sizeof(BSPDefines::MipTex));
 			}
 		}
 
-		// Entities
+		// Entities are optional and kept as text, the cooker parses them
 		{
-			const auto [addr, size] =
-				GetLumpInfo(BSPDefines::LumpIndex_Entities);
-			if (addr && size)
-			{
-				const auto end = reinterpret_cast<const char*>(addr) + size;
-				auto start = reinterpret_cast<const char*>(addr);
-				if (!filemap->ValidateRange(addr, size))
-					return false;
-				// TODO: CLEANUP!
-				while (true)
-				{
-					std::unordered_map<std::string, std::string> entity;
-					while (true)
-					{
-						const auto ReadNextKeyValuePair = [&]() { 
-							if (*start == '{')
-								++start;
-							while (*start == ' ' || *start == '\t' ||
-								   *start == '\n' || *start == '\r')
-								++start;
-							if (*start == '\"')
-								++start;
-							const auto keyend = std::strchr(start, '\"');
-							if (!keyend)
-								return false;
-							const auto key = std::string{start, keyend};
-							start = keyend + 1;
-							while (*start == ' ' || *start == '\t' ||
-								   *start == '\n' || *start == '\r')
-								++start;
-							if (*start != '\"')
-								return false;
-							++start;
-							const auto valend = std::strchr(start, '\"');
-							if (!valend)
-								return false;
-							const auto val = std::string{start, valend};
-							start = valend + 1;
-							entity[key] = val;
-							return true;
-						};
-						if (!ReadNextKeyValuePair())
-							break;
-					}
-
-					if (entity.empty())
-						break;
-					m_entitiesText.push_back(entity);
-				}
-			}
+			const auto bytes =
+				GetLumpRange(filemap, BSPDefines::LumpIndex_Entities);
+			m_entities = {reinterpret_cast<const oxyChar*>(bytes.data()),
+						  bytes.size()};
 		}
 
-		if (!LoadLump(m_vertices, BSPDefines::LumpIndex_Vertexes))
+		if (!MapLump(filemap, BSPDefines::LumpIndex_Vertexes, m_vertices))
 			return false;
-		if (!LoadLump(m_visibility, BSPDefines::LumpIndex_Visibility))
+		if (!MapLump(filemap, BSPDefines::LumpIndex_Visibility, m_visibility))
 			return false;
-		if (!LoadLump(m_nodes, BSPDefines::LumpIndex_Nodes))
+		if (!MapWideLump<BSPDefines::Node16>(filemap, BSPDefines::LumpIndex_Nodes,
+											 isBSP2, m_widenedNodes, m_nodes))
 			return false;
-		if (!LoadLump(m_texinfo, BSPDefines::LumpIndex_TexInfo))
+		if (!MapLump(filemap, BSPDefines::LumpIndex_TexInfo, m_texinfo))
 			return false;
-		if (!LoadLump(m_faces, BSPDefines::LumpIndex_Faces))
+		if (!MapWideLump<BSPDefines::Face16>(filemap, BSPDefines::LumpIndex_Faces,
+											 isBSP2, m_widenedFaces, m_faces))
 			return false;
-		if (!LoadLump(m_clipNodes, BSPDefines::LumpIndex_ClipNodes))
+		if (!MapWideLump<BSPDefines::ClipNode16>(
+				filemap, BSPDefines::LumpIndex_ClipNodes, isBSP2,
+				m_widenedClipNodes, m_clipNodes))
 			return false;
-		if (!LoadLump(m_leaves, BSPDefines::LumpIndex_Leafs))
+		if (!MapWideLump<BSPDefines::Leaf16>(filemap, BSPDefines::LumpIndex_Leafs,
+											 isBSP2, m_widenedLeaves, m_leaves))
 			return false;
-		if (!LoadLump(m_marksurfaces, BSPDefines::LumpIndex_MarkSurfaces))
+		if (!MapWideLump<oxyU16>(filemap, BSPDefines::LumpIndex_MarkSurfaces,
+								 isBSP2, m_widenedMarksurfaces, m_marksurfaces))
 			return false;
-		if (!LoadLump(m_edges, BSPDefines::LumpIndex_Edges))
+		if (!MapWideLump<BSPDefines::Edge16>(filemap, BSPDefines::LumpIndex_Edges,
+											 isBSP2, m_widenedEdges, m_edges))
 			return false;
-		if (!LoadLump(m_surfedges, BSPDefines::LumpIndex_SurfEdges))
+		if (!MapLump(filemap, BSPDefines::LumpIndex_SurfEdges, m_surfedges))
 			return false;
-		if (!LoadLump(m_models, BSPDefines::LumpIndex_Models))
+		if (!MapLump(filemap, BSPDefines::LumpIndex_Models, m_models))
 			return false;
 		return true;
 	}
 };
-
@@ -1,13 +1,20 @@
 #pragma once
 
+#include "Platform/Platform.h"
+
 namespace oxygen
 {
 	namespace BSPDefines
 	{
 		inline constexpr auto k_BSPVersion = oxyS32{30};
+		// BSP30 with 32 bit node, leaf, face, clip node, edge and mark surface
+		// indices for maps past the limits below, identified by "BSP2" in
+		// place of the version
+		inline constexpr auto k_BSP2Version = oxyS32{0x32505342};
 		inline constexpr auto k_ToolVersion = oxyS32{2};
 
 		inline constexpr auto k_MaxMapHulls = oxySize{4};
+		// BSP30 limits, BSP2 maps are only limited by their 32 bit indices
 		inline constexpr auto k_MaxMapModels = oxySize{400};
 		inline constexpr auto k_MaxMapBrushes = oxySize{4096};
 		inline constexpr auto k_MaxMapEntityString = oxySize{128 * 1024};
@@ -182,7 +189,8 @@ namespace oxygen
 		static_assert(offsetof(Vertex, m_position) == 0,
 					  "Vertex struct m_position offset is not 0");
 
-		struct Node
+		// BSP30 file layout, widened to Node on load
+		struct Node16
 		{
 			oxyU32 m_planeIndex;
 			oxyS16 m_children[2]; // Negative numbers are -(leafs+1)
@@ -191,7 +199,36 @@ namespace oxygen
 			oxyU16 m_firstFaceIndex;
 			oxyU16 m_faceCount;
 		};
-		static_assert(sizeof(Node) == 24, "Node struct size is not 32 bytes");
+		static_assert(sizeof(Node16) == 24,
+					  "Node16 struct size is not 24 bytes");
+		static_assert(alignof(Node16) == 4,
+					  "Node16 struct alignment is not 4 bytes");
+		static_assert(std::is_trivial_v<Node16>,
+					  "Node16 struct is not a trivial type");
+		static_assert(offsetof(Node16, m_planeIndex) == 0,
+					  "Node16 struct m_planeIndex offset is not 0");
+		static_assert(offsetof(Node16, m_children) == 4,
+					  "Node16 struct m_children offset is not 4");
+		static_assert(offsetof(Node16, m_mins) == 8,
+					  "Node16 struct m_mins offset is not 8");
+		static_assert(offsetof(Node16, m_maxs) == 14,
+					  "Node16 struct m_maxs offset is not 14");
+		static_assert(offsetof(Node16, m_firstFaceIndex) == 20,
+					  "Node16 struct m_firstFaceIndex offset is not 20");
+		static_assert(offsetof(Node16, m_faceCount) == 22,
+					  "Node16 struct m_faceCount offset is not 22");
+
+		// BSP2 file layout, what the engine uses for either version
+		struct Node
+		{
+			oxyU32 m_planeIndex;
+			oxyS32 m_children[2]; // Negative numbers are -(leafs+1)
+			oxyF32 m_mins[3];
+			oxyF32 m_maxs[3];
+			oxyU32 m_firstFaceIndex;
+			oxyU32 m_faceCount;
+		};
+		static_assert(sizeof(Node) == 44, "Node struct size is not 44 bytes");
 		static_assert(alignof(Node) == 4,
 					  "Node struct alignment is not 4 bytes");
 		static_assert(std::is_trivial_v<Node>,
@@ -200,14 +237,14 @@ namespace oxygen
 					  "Node struct m_planeIndex offset is not 0");
 		static_assert(offsetof(Node, m_children) == 4,
 					  "Node struct m_children offset is not 4");
-		static_assert(offsetof(Node, m_mins) == 8,
-					  "Node struct m_mins offset is not 8");
-		static_assert(offsetof(Node, m_maxs) == 14,
-					  "Node struct m_maxs offset is not 14");
-		static_assert(offsetof(Node, m_firstFaceIndex) == 20,
-					  "Node struct m_firstFaceIndex offset is not 20");
-		static_assert(offsetof(Node, m_faceCount) == 22,
-					  "Node struct m_faceCount offset is not 22");
+		static_assert(offsetof(Node, m_mins) == 12,
+					  "Node struct m_mins offset is not 12");
+		static_assert(offsetof(Node, m_maxs) == 24,
+					  "Node struct m_maxs offset is not 24");
+		static_assert(offsetof(Node, m_firstFaceIndex) == 36,
+					  "Node struct m_firstFaceIndex offset is not 36");
+		static_assert(offsetof(Node, m_faceCount) == 40,
+					  "Node struct m_faceCount offset is not 40");
 
 		struct TexInfo
 		{
@@ -228,7 +265,7 @@ namespace oxygen
 		static_assert(offsetof(TexInfo, m_flags) == 36,
 					  "TexInfo struct m_flags offset is not 36");
 
-		struct Face
+		struct Face16
 		{
 			oxyU16 m_planeIndex;
 			oxyU16 m_side;
@@ -238,33 +275,80 @@ namespace oxygen
 			oxyU8 m_lightStyles[k_MaxLightMaps];
 			oxyU32 m_lightMapOffset;
 		};
-		static_assert(sizeof(Face) == 20, "Face struct size is not 20 bytes");
+		static_assert(sizeof(Face16) == 20,
+					  "Face16 struct size is not 20 bytes");
+		static_assert(alignof(Face16) == 4,
+					  "Face16 struct alignment is not 4 bytes");
+		static_assert(std::is_trivial_v<Face16>,
+					  "Face16 struct is not a trivial type");
+		static_assert(offsetof(Face16, m_planeIndex) == 0,
+					  "Face16 struct m_planeIndex offset is not 0");
+		static_assert(offsetof(Face16, m_side) == 2,
+					  "Face16 struct m_side offset is not 2");
+		static_assert(offsetof(Face16, m_firstEdgeIndex) == 4,
+					  "Face16 struct m_firstEdgeIndex offset is not 4");
+		static_assert(offsetof(Face16, m_edgeCount) == 8,
+					  "Face16 struct m_edgeCount offset is not 8");
+		static_assert(offsetof(Face16, m_texInfoIndex) == 10,
+					  "Face16 struct m_texInfoIndex offset is not 10");
+		static_assert(offsetof(Face16, m_lightStyles) == 12,
+					  "Face16 struct m_lightStyles offset is not 12");
+		static_assert(offsetof(Face16, m_lightMapOffset) == 16,
+					  "Face16 struct m_lightMapOffset offset is not 16");
+
+		struct Face
+		{
+			oxyU32 m_planeIndex;
+			oxyU32 m_side;
+			oxyU32 m_firstEdgeIndex;
+			oxyU32 m_edgeCount;
+			oxyU32 m_texInfoIndex;
+			oxyU8 m_lightStyles[k_MaxLightMaps];
+			oxyU32 m_lightMapOffset;
+		};
+		static_assert(sizeof(Face) == 28, "Face struct size is not 28 bytes");
 		static_assert(alignof(Face) == 4,
 					  "Face struct alignment is not 4 bytes");
 		static_assert(std::is_trivial_v<Face>,
 					  "Face struct is not a trivial type");
 		static_assert(offsetof(Face, m_planeIndex) == 0,
 					  "Face struct m_planeIndex offset is not 0");
-		static_assert(offsetof(Face, m_side) == 2,
-					  "Face struct m_side offset is not 2");
-		static_assert(offsetof(Face, m_firstEdgeIndex) == 4,
-					  "Face struct m_firstEdgeIndex offset is not 4");
-		static_assert(offsetof(Face, m_edgeCount) == 8,
-					  "Face struct m_edgeCount offset is not 8");
-		static_assert(offsetof(Face, m_texInfoIndex) == 10,
-					  "Face struct m_texInfoIndex offset is not 10");
-		static_assert(offsetof(Face, m_lightStyles) == 12,
-					  "Face struct m_lightStyles offset is not 12");
-		static_assert(offsetof(Face, m_lightMapOffset) == 16,
-					  "Face struct m_lightMapOffset offset is not 16");
+		static_assert(offsetof(Face, m_side) == 4,
+					  "Face struct m_side offset is not 4");
+		static_assert(offsetof(Face, m_firstEdgeIndex) == 8,
+					  "Face struct m_firstEdgeIndex offset is not 8");
+		static_assert(offsetof(Face, m_edgeCount) == 12,
+					  "Face struct m_edgeCount offset is not 12");
+		static_assert(offsetof(Face, m_texInfoIndex) == 16,
+					  "Face struct m_texInfoIndex offset is not 16");
+		static_assert(offsetof(Face, m_lightStyles) == 20,
+					  "Face struct m_lightStyles offset is not 20");
+		static_assert(offsetof(Face, m_lightMapOffset) == 24,
+					  "Face struct m_lightMapOffset offset is not 24");
 
-		struct ClipNode
+		struct ClipNode16
 		{
 			oxyU32 m_planeIndex;
 			oxyS16 m_children[2]; // Negatives are contents
 		};
-		static_assert(sizeof(ClipNode) == 8,
-					  "ClipNode struct size is not 8 bytes");
+		static_assert(sizeof(ClipNode16) == 8,
+					  "ClipNode16 struct size is not 8 bytes");
+		static_assert(alignof(ClipNode16) == 4,
+					  "ClipNode16 struct alignment is not 4 bytes");
+		static_assert(std::is_trivial_v<ClipNode16>,
+					  "ClipNode16 struct is not a trivial type");
+		static_assert(offsetof(ClipNode16, m_planeIndex) == 0,
+					  "ClipNode16 struct m_planeIndex offset is not 0");
+		static_assert(offsetof(ClipNode16, m_children) == 4,
+					  "ClipNode16 struct m_children offset is not 4");
+
+		struct ClipNode
+		{
+			oxyU32 m_planeIndex;
+			oxyS32 m_children[2]; // Negatives are contents
+		};
+		static_assert(sizeof(ClipNode) == 12,
+					  "ClipNode struct size is not 12 bytes");
 		static_assert(alignof(ClipNode) == 4,
 					  "ClipNode struct alignment is not 4 bytes");
 		static_assert(std::is_trivial_v<ClipNode>,
@@ -275,7 +359,7 @@ namespace oxygen
 					  "ClipNode struct m_children offset is not 4");
 
 		// "leaf 0 is the generic CONTENTS_SOLID leaf"
-		struct Leaf
+		struct Leaf16
 		{
 			oxyS32 m_contents;
 			oxyS32 m_visOffset; // -1 = none
@@ -285,7 +369,38 @@ namespace oxygen
 			oxyU16 m_markSurfaceCount;
 			oxyU8 m_ambientLevels[k_NumAmbients];
 		};
-		static_assert(sizeof(Leaf) == 28, "Leaf struct size is not 28 bytes");
+		static_assert(sizeof(Leaf16) == 28,
+					  "Leaf16 struct size is not 28 bytes");
+		static_assert(alignof(Leaf16) == 4,
+					  "Leaf16 struct alignment is not 4 bytes");
+		static_assert(std::is_trivial_v<Leaf16>,
+					  "Leaf16 struct is not a trivial type");
+		static_assert(offsetof(Leaf16, m_contents) == 0,
+					  "Leaf16 struct m_contents offset is not 0");
+		static_assert(offsetof(Leaf16, m_visOffset) == 4,
+					  "Leaf16 struct m_visOffset offset is not 4");
+		static_assert(offsetof(Leaf16, m_mins) == 8,
+					  "Leaf16 struct m_mins offset is not 8");
+		static_assert(offsetof(Leaf16, m_maxs) == 14,
+					  "Leaf16 struct m_maxs offset is not 14");
+		static_assert(offsetof(Leaf16, m_firstMarkSurfaceIndex) == 20,
+					  "Leaf16 struct m_firstMarkSurfaceIndex offset is not 20");
+		static_assert(offsetof(Leaf16, m_markSurfaceCount) == 22,
+					  "Leaf16 struct m_markSurfaceCount offset is not 22");
+		static_assert(offsetof(Leaf16, m_ambientLevels) == 24,
+					  "Leaf16 struct m_ambientLevels offset is not 24");
+
+		struct Leaf
+		{
+			oxyS32 m_contents;
+			oxyS32 m_visOffset; // -1 = none
+			oxyF32 m_mins[3];	// "for frustum culling"
+			oxyF32 m_maxs[3];
+			oxyU32 m_firstMarkSurfaceIndex;
+			oxyU32 m_markSurfaceCount;
+			oxyU8 m_ambientLevels[k_NumAmbients];
+		};
+		static_assert(sizeof(Leaf) == 44, "Leaf struct size is not 44 bytes");
 		static_assert(alignof(Leaf) == 4,
 					  "Leaf struct alignment is not 4 bytes");
 		static_assert(std::is_trivial_v<Leaf>,
@@ -296,22 +411,34 @@ namespace oxygen
 					  "Leaf struct m_visOffset offset is not 4");
 		static_assert(offsetof(Leaf, m_mins) == 8,
 					  "Leaf struct m_mins offset is not 8");
-		static_assert(offsetof(Leaf, m_maxs) == 14,
-					  "Leaf struct m_maxs offset is not 14");
-		static_assert(offsetof(Leaf, m_firstMarkSurfaceIndex) == 20,
-					  "Leaf struct m_firstMarkSurfaceIndex offset is not 20");
-		static_assert(offsetof(Leaf, m_markSurfaceCount) == 22,
-					  "Leaf struct m_markSurfaceCount offset is not 22");
-		static_assert(offsetof(Leaf, m_ambientLevels) == 24,
-					  "Leaf struct m_ambientLevels offset is not 24");
+		static_assert(offsetof(Leaf, m_maxs) == 20,
+					  "Leaf struct m_maxs offset is not 20");
+		static_assert(offsetof(Leaf, m_firstMarkSurfaceIndex) == 32,
+					  "Leaf struct m_firstMarkSurfaceIndex offset is not 32");
+		static_assert(offsetof(Leaf, m_markSurfaceCount) == 36,
+					  "Leaf struct m_markSurfaceCount offset is not 36");
+		static_assert(offsetof(Leaf, m_ambientLevels) == 40,
+					  "Leaf struct m_ambientLevels offset is not 40");
 
-		struct Edge
+		struct Edge16
 		{
 			oxyU16 m_vertexIndices[2];
 		};
-		static_assert(sizeof(Edge) == 4, "Edge struct size is not 4 bytes");
-		static_assert(alignof(Edge) == 2,
-					  "Edge struct alignment is not 2 bytes");
+		static_assert(sizeof(Edge16) == 4, "Edge16 struct size is not 4 bytes");
+		static_assert(alignof(Edge16) == 2,
+					  "Edge16 struct alignment is not 2 bytes");
+		static_assert(std::is_trivial_v<Edge16>,
+					  "Edge16 struct is not a trivial type");
+		static_assert(offsetof(Edge16, m_vertexIndices) == 0,
+					  "Edge16 struct m_vertexIndices offset is not 0");
+
+		struct Edge
+		{
+			oxyU32 m_vertexIndices[2];
+		};
+		static_assert(sizeof(Edge) == 8, "Edge struct size is not 8 bytes");
+		static_assert(alignof(Edge) == 4,
+					  "Edge struct alignment is not 4 bytes");
 		static_assert(std::is_trivial_v<Edge>,
 					  "Edge struct is not a trivial type");
 		static_assert(offsetof(Edge, m_vertexIndices) == 0,
@@ -349,24 +476,41 @@ namespace oxygen
 
 	}; // namespace BSPDefines
 
+	// Lumps are typed views straight into the mapped .bsp, which is owned here
+	// so they stay valid for as long as the world holds its data. Only the
+	// scattered miptex headers are gathered, the entity text is left for the
+	// cooker to parse. BSP30 lumps with 16 bit indices are widened into owned
+	// copies so either version is seen through the 32 bit layouts.
 	struct BSPWorldData : NonCopyable
 	{
-		std::vector<std::unordered_map<std::string, std::string>> m_entitiesText;
-		std::vector<BSPDefines::Plane> m_planes;
 		std::vector<BSPDefines::MipTex> m_miptex;
-		std::vector<BSPDefines::Vertex> m_vertices;
-		std::vector<oxyU8> m_visibility;
-		std::vector<BSPDefines::Node> m_nodes;
-		std::vector<BSPDefines::TexInfo> m_texinfo;
-		std::vector<BSPDefines::Face> m_faces;
-		std::vector<BSPDefines::ClipNode> m_clipNodes;
-		std::vector<BSPDefines::Leaf> m_leaves;
-		std::vector<oxyU16> m_marksurfaces;
-		std::vector<BSPDefines::Edge> m_edges;
-		std::vector<oxyS32> m_surfedges;
-		std::vector<BSPDefines::Model> m_models;
+		std::span<const oxyChar> m_entities;
+		std::span<const BSPDefines::Plane> m_planes;
+		std::span<const BSPDefines::Vertex> m_vertices;
+		std::span<const oxyU8> m_visibility;
+		std::span<const BSPDefines::Node> m_nodes;
+		std::span<const BSPDefines::TexInfo> m_texinfo;
+		std::span<const BSPDefines::Face> m_faces;
+		std::span<const BSPDefines::ClipNode> m_clipNodes;
+		std::span<const BSPDefines::Leaf> m_leaves;
+		std::span<const oxyU32> m_marksurfaces;
+		std::span<const BSPDefines::Edge> m_edges;
+		std::span<const oxyS32> m_surfedges;
+		std::span<const BSPDefines::Model> m_models;
 
 		auto Load(std::string_view mapname) -> oxyBool;
+
+		// The whole mapped .bsp, empty until loaded
+		auto GetFileBytes() const -> std::span<const oxyU8>;
+
+	  private:
+		UniqueFileMap m_fileMap{};
+		std::vector<BSPDefines::Node> m_widenedNodes;
+		std::vector<BSPDefines::Face> m_widenedFaces;
+		std::vector<BSPDefines::ClipNode> m_widenedClipNodes;
+		std::vector<BSPDefines::Leaf> m_widenedLeaves;
+		std::vector<oxyU32> m_widenedMarksurfaces;
+		std::vector<BSPDefines::Edge> m_widenedEdges;
 	};
 
 }; // namespace oxygen
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "OxygenPCH.h"
+#include "ComponentScheduler.h"
+#include "World.h"
+
+#include "Entity/Entity.h"
+#include "Component/AnimatedMeshComponent/AnimatedMeshComponent.h"
+#include "Component/CameraComponent/CameraComponent.h"
+#include "Component/EnvPushComponent/EnvPushComponent.h"
+#include "Component/HealthComponent/HealthComponent.h"
+#include "Component/HullComponent/HullComponent.h"
+#include "Component/Pawn/Pawn.h"
+#include "Component/ProjectileComponent/ProjectileComponent.h"
+#include "Component/StaticMeshComponent/StaticMeshComponent.h"
+#include "Component/WeaponComponent/WeaponComponent.h"
+#include "Platform/Platform.h"
+
+namespace oxygen
+{
+	ComponentScheduler::ComponentScheduler()
+	{
+		struct Rule
+		{
+			const ObjectDescription& m_type;
+			UpdateBucketFn m_update;
+			oxyBool m_movesEntity;
+			// Updated entity by entity with the other such types instead of
+			// in a bucket of its own
+			oxyBool m_entityOrder;
+			// Types that have to be done updating before this one starts
+			std::vector<const ObjectDescription*> m_after;
+		};
+		const auto& envPush = EnvPushComponent::GetStaticDescription();
+		const auto& animatedMesh = AnimatedMeshComponent::GetStaticDescription();
+		const auto& hull = HullComponent::GetStaticDescription();
+		const auto& pawn = Pawn::GetStaticDescription();
+		const auto& camera = CameraComponent::GetStaticDescription();
+		const auto& weapon = WeaponComponent::GetStaticDescription();
+		const auto& projectile = ProjectileComponent::GetStaticDescription();
+		// The player entity holds its animated mesh, hull, pawn and camera
+		// in that order and map entities spawn before anything else, the
+		// rules keep the order that gave them. Hulls, pawns, cameras and
+		// weapons still update one entity at a time, so one player's shots
+		// and hitscans see the next player where it was before it moved this
+		// tick, as networked hit registration expects.
+		const Rule rules[] = {
+			// Pushes the local player's hull before it moves
+			{envPush, &UpdateBucket<EnvPushComponent>, false, false, {}},
+			{animatedMesh, &UpdateBucket<AnimatedMeshComponent>, false, false,
+			 {}},
+			// Slides on the velocity the pawn set last tick
+			{hull, &UpdateBucket<HullComponent>, true, true, {&envPush}},
+			// Reads input and ground state where the hull ended up, and may
+			// respawn the entity
+			{pawn, &UpdateBucket<Pawn>, true, true, {&animatedMesh, &hull}},
+			// Follows the view angles the pawn just took from input
+			{camera, &UpdateBucket<CameraComponent>, false, true,
+			 {&hull, &pawn}},
+			// Fires and reloads on the input its owner set this tick
+			{weapon, &UpdateBucket<WeaponComponent>, false, true, {&pawn}},
+			// Spins on the velocity its bounce hull just stepped with, the
+			// bounce hulls are stepped right before it
+			{projectile, &UpdateBucket<ProjectileComponent>, false, false,
+			 {&weapon}},
+			{HealthComponent::GetStaticDescription(), nullptr, false, false,
+			 {}},
+			{StaticMeshComponent::GetStaticDescription(), nullptr, false,
+			 false, {}},
+		};
+		constexpr auto ruleCount = std::size(rules);
+
+		// Earliest declared rule whose dependencies are all placed goes next
+		std::array<oxyBool, ruleCount> placed{};
+		const auto IsPlaced = [&](const ObjectDescription* desc) {
+			for (oxySize i = 0; i < ruleCount; ++i)
+			{
+				if (&rules[i].m_type == desc)
+					return placed[i];
+			}
+			// Depending on a type without a rule constrains nothing
+			return true;
+		};
+		for (oxySize round = 0; round < ruleCount; ++round)
+		{
+			auto next = ruleCount;
+			for (oxySize i = 0; i < ruleCount && next == ruleCount; ++i)
+			{
+				if (!placed[i] &&
+					std::ranges::all_of(rules[i].m_after, IsPlaced))
+					next = i;
+			}
+			// A cycle in the rules
+			OXYCHECK(next != ruleCount);
+			if (next == ruleCount)
+				break;
+			placed[next] = true;
+			m_buckets.push_back({.m_type = &rules[next].m_type,
+								 .m_update = rules[next].m_update,
+								 .m_movesEntity = rules[next].m_movesEntity,
+								 .m_entityOrder = rules[next].m_entityOrder});
+			if (&rules[next].m_type == &projectile)
+				m_bounceBucket = m_buckets.size() - 1;
+		}
+
+		// The entity ordered types have to end up next to each other, they
+		// update together where the first of them is placed
+		const auto IsEntityOrder = [](const Bucket& b) {
+			return b.m_entityOrder;
+		};
+		const auto first = std::ranges::find_if(m_buckets, IsEntityOrder);
+		const auto last = std::ranges::find_if_not(first, m_buckets.end(),
+												   IsEntityOrder);
+		OXYCHECK(std::ranges::none_of(last, m_buckets.end(), IsEntityOrder));
+		m_entityOrderBegin = static_cast<oxySize>(first - m_buckets.begin());
+		m_entityOrderEnd = static_cast<oxySize>(last - m_buckets.begin());
+		for (auto it = first; it != last; ++it)
+		{
+			if (it != first)
+				m_entityOrderName += ", ";
+			m_entityOrderName += it->m_type->m_name;
+		}
+
+		// One timing per step in update order, the entity ordered types
+		// share one
+		for (oxySize i = 0; i < m_buckets.size(); ++i)
+		{
+			auto& bucket = m_buckets[i];
+			if (i == m_bounceBucket)
+			{
+				m_bounceTiming = m_timings.size();
+				m_timings.push_back({.m_name = "PhysicsWorld"});
+			}
+			if (bucket.m_entityOrder && i != m_entityOrderBegin)
+			{
+				bucket.m_timing = m_buckets[m_entityOrderBegin].m_timing;
+				continue;
+			}
+			bucket.m_timing = m_timings.size();
+			m_timings.push_back({.m_name = bucket.m_entityOrder
+											   ? m_entityOrderName
+											   : bucket.m_type->m_name});
+		}
+		m_timings.push_back({.m_name = "Unscheduled"});
+
+		// Every component type numbers inside Component's interval, assigned
+		// when the ObjectManager was created
+		ObjectManager::GetInstance();
+		m_bucketOfType.assign(Component::GetStaticDescription().m_typeIndexEnd,
+							  k_unscheduled);
+		for (oxySize i = 0; i < m_buckets.size(); ++i)
+		{
+			const auto typeIndex = m_buckets[i].m_type->m_typeIndex;
+			if (typeIndex < m_bucketOfType.size())
+				m_bucketOfType[typeIndex] = static_cast<oxyU32>(i);
+		}
+	}
+
+	template <typename T>
+	auto ComponentScheduler::UpdateBucket(Bucket& bucket, World& world,
+										  oxySize begin, oxySize end,
+										  oxyF32 deltaTimeSeconds) -> void
+	{
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto [ent, component] = bucket.m_components[i];
+			// Destroying an entity disables it, so this also skips entities
+			// an earlier update removed
+			if (ent->GetFlag(EntityFlags_Disabled) || !component->IsEnabled())
+				continue;
+			// T is final, the call binds statically and can inline
+			static_cast<T*>(component)->Update(deltaTimeSeconds);
+			// Relinked straight away so later queries this tick see it
+			if (bucket.m_movesEntity && !ent->m_world.expired())
+				world.LinkEntity(*ent);
+		}
+	}
+
+	auto ComponentScheduler::Gather(const World& world) -> void
+	{
+		m_tickEntities.assign(world.m_entities.begin(), world.m_entities.end());
+		for (auto& bucket : m_buckets)
+			bucket.m_components.clear();
+		m_unscheduled.clear();
+
+		for (const auto& ent : m_tickEntities)
+		{
+			ent->m_updateTick = m_tick;
+			for (oxySize i = 0; i < ent->m_components.size(); ++i)
+			{
+				const auto typeIndex = ent->m_componentTypes[i];
+				const auto bucketIndex = typeIndex < m_bucketOfType.size()
+											 ? m_bucketOfType[typeIndex]
+											 : k_unscheduled;
+				const auto component = ent->m_components[i].get();
+				if (bucketIndex == k_unscheduled)
+					m_unscheduled.emplace_back(ent.get(), component);
+				else if (m_buckets[bucketIndex].m_update)
+					m_buckets[bucketIndex].m_components.emplace_back(
+						ent.get(), component);
+			}
+		}
+	}
+
+	auto ComponentScheduler::UpdateEntityOrder(World& world,
+											   oxyF32 deltaTimeSeconds) -> void
+	{
+		const auto start = std::chrono::steady_clock::now();
+		oxySize count = 0;
+		for (auto i = m_entityOrderBegin; i < m_entityOrderEnd; ++i)
+		{
+			m_buckets[i].m_next = 0;
+			count += m_buckets[i].m_components.size();
+		}
+		// Buckets hold their components in entity order, so each entity's
+		// are the next ones along in every bucket
+		for (const auto& ent : m_tickEntities)
+		{
+			for (auto i = m_entityOrderBegin; i < m_entityOrderEnd; ++i)
+			{
+				auto& bucket = m_buckets[i];
+				auto end = bucket.m_next;
+				while (end < bucket.m_components.size() &&
+					   bucket.m_components[end].first == ent.get())
+					++end;
+				if (end == bucket.m_next)
+					continue;
+				bucket.m_update(bucket, world, bucket.m_next, end,
+								deltaTimeSeconds);
+				bucket.m_next = end;
+			}
+		}
+		Record(m_timings[m_buckets[m_entityOrderBegin].m_timing], count,
+			   start);
+	}
+
+	auto ComponentScheduler::Record(
+		ComponentUpdateTiming& timing, oxySize count,
+		std::chrono::steady_clock::time_point start) -> void
+	{
+		const auto seconds = std::chrono::duration<oxyF64>(
+								 std::chrono::steady_clock::now() - start)
+								 .count();
+		timing.m_count = count;
+		timing.m_lastSeconds = seconds;
+		timing.m_averageSeconds += (seconds - timing.m_averageSeconds) / 30.0;
+	}
+
+	auto ComponentScheduler::Update(World& world,
+									oxyF32 deltaTimeSeconds) -> void
+	{
+		++m_tick;
+		Gather(world);
+
+		for (oxySize i = 0; i < m_buckets.size(); ++i)
+		{
+			if (i == m_bounceBucket)
+			{
+				// Only the entities there were when the tick started, ones
+				// spawned since get their first step below
+				const auto start = std::chrono::steady_clock::now();
+				world.m_physics.Step(world, m_tickEntities, deltaTimeSeconds);
+				Record(m_timings[m_bounceTiming],
+					   world.m_physics.GetBodyCount(), start);
+			}
+			if (i == m_entityOrderBegin && i < m_entityOrderEnd)
+				UpdateEntityOrder(world, deltaTimeSeconds);
+			auto& bucket = m_buckets[i];
+			if (bucket.m_entityOrder)
+				continue;
+			const auto start = std::chrono::steady_clock::now();
+			if (bucket.m_update)
+				bucket.m_update(bucket, world, 0, bucket.m_components.size(),
+								deltaTimeSeconds);
+			Record(m_timings[bucket.m_timing], bucket.m_components.size(),
+				   start);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		auto count = m_unscheduled.size();
+		// Types without a rule go through the vtable, in entity order
+		for (const auto& [ent, component] : m_unscheduled)
+		{
+			if (ent->GetFlag(EntityFlags_Disabled) || !component->IsEnabled())
+				continue;
+			component->Update(deltaTimeSeconds);
+			if (!ent->m_world.expired())
+				world.LinkEntity(*ent);
+		}
+		// Entities spawned during the tick still update in it, whole and in
+		// the order they were added. Deliberately not using range-based for
+		// loop here incase entities are added/removed during the loop.
+		for (oxySize i = 0; i < world.m_entities.size(); ++i)
+		{
+			const auto ent = world.m_entities[i];
+			if (ent->m_updateTick == m_tick)
+				continue;
+			ent->m_updateTick = m_tick;
+			if (ent->GetFlag(EntityFlags_Disabled))
+				continue;
+			// Its bounce hull moves before its other components update, as
+			// it would have at its place in the order. The step may destroy
+			// it.
+			world.m_physics.Step(world, std::span{&ent, 1}, deltaTimeSeconds);
+			if (ent->GetFlag(EntityFlags_Disabled))
+				continue;
+			count += ent->m_components.size();
+			ent->Update(deltaTimeSeconds);
+			if (!ent->m_world.expired())
+				world.LinkEntity(*ent);
+		}
+		Record(m_timings.back(), count, start);
+
+		// Lets go of entities destroyed during the tick
+		m_tickEntities.clear();
+	}
+
+	auto ComponentScheduler::LogTimings() const -> void
+	{
+		for (const auto& timing : m_timings)
+		{
+			LogMessage(std::format("{}: {} components, {:.3f} ms, {:.3f} ms "
+								   "average\n",
+								   timing.m_name, timing.m_count,
+								   timing.m_lastSeconds * 1000.0,
+								   timing.m_averageSeconds * 1000.0)
+						   .c_str());
+		}
+	}
+}; // namespace oxygen
@@ -0,0 +1,89 @@
+#pragma once
+
+namespace oxygen
+{
+	struct ComponentUpdateTiming
+	{
+		std::string_view m_name;
+		oxySize m_count{};
+		oxyF64 m_lastSeconds{};
+		// Smoothed over roughly the last 30 ticks
+		oxyF64 m_averageSeconds{};
+	};
+
+	// Runs a world's component updates one type at a time instead of one
+	// entity at a time, so a type's Update is called directly in a tight loop
+	// rather than through the vtable between unrelated ones. Types run in the
+	// order their declared dependencies (ComponentScheduler.cc) allow, within
+	// a type components keep entity order. Types whose order across entities
+	// matters to gameplay (hulls, pawns, cameras, weapons) are instead run
+	// one entity at a time, each entity's in type order. Bounce hulls are
+	// stepped together by the world's PhysicsWorld at their place in that
+	// order.
+	struct ComponentScheduler : NonCopyable
+	{
+		ComponentScheduler();
+
+		auto Update(struct World& world, oxyF32 deltaTimeSeconds) -> void;
+
+		// One entry per step in update order: a scheduled type, the entity
+		// ordered types together or the bounce hull step. The last one covers
+		// components of types without a rule.
+		auto GetTimings() const -> std::span<const ComponentUpdateTiming>
+		{
+			return m_timings;
+		}
+		auto LogTimings() const -> void;
+
+	  private:
+		struct Bucket;
+		// Updates the bucket's components from begin up to end
+		using UpdateBucketFn = void (*)(Bucket& bucket, struct World& world,
+										oxySize begin, oxySize end,
+										oxyF32 deltaTimeSeconds);
+		struct Bucket
+		{
+			const ObjectDescription* m_type{};
+			// Null for types that keep Component's empty Update
+			UpdateBucketFn m_update{};
+			// Relink the entity after each update, for types that move it
+			oxyBool m_movesEntity{};
+			// Updated entity by entity with the other entity ordered buckets
+			oxyBool m_entityOrder{};
+			oxySize m_timing{};
+			std::vector<std::pair<struct Entity*, struct Component*>>
+				m_components;
+			// First component the entity ordered update has not reached
+			oxySize m_next{};
+		};
+		template <typename T>
+		static auto UpdateBucket(Bucket& bucket, struct World& world,
+								 oxySize begin, oxySize end,
+								 oxyF32 deltaTimeSeconds) -> void;
+		auto Gather(const struct World& world) -> void;
+		auto UpdateEntityOrder(struct World& world,
+							   oxyF32 deltaTimeSeconds) -> void;
+		auto Record(ComponentUpdateTiming& timing, oxySize count,
+					std::chrono::steady_clock::time_point start) -> void;
+
+		static inline constexpr auto k_unscheduled = ~oxyU32{0};
+
+		std::vector<Bucket> m_buckets;
+		// Bounce hulls are stepped right before this bucket runs
+		oxySize m_bounceBucket{};
+		oxySize m_bounceTiming{};
+		// The entity ordered buckets, one after the other
+		oxySize m_entityOrderBegin{};
+		oxySize m_entityOrderEnd{};
+		std::string m_entityOrderName;
+		// Bucket per type index, k_unscheduled for types without a rule
+		std::vector<oxyU32> m_bucketOfType;
+		std::vector<ComponentUpdateTiming> m_timings;
+		// Taken at the start of the tick, keeps every gathered entity alive
+		// until the tick is over
+		std::vector<std::shared_ptr<struct Entity>> m_tickEntities;
+		std::vector<std::pair<struct Entity*, struct Component*>>
+			m_unscheduled;
+		oxyU32 m_tick{};
+	};
+}; // namespace oxygen
@@ -0,0 +1,710 @@
+#include "OxygenPCH.h"
+#include "CookedMap.h"
+
+#include "Job/JobSystem.h"
+#include "Platform/Platform.h"
+
+namespace oxygen
+{
+	namespace
+	{
+		auto GetSourcePath(std::string_view mapname) -> std::string
+		{
+			return std::format("{}/maps/{}.bsp", GetExecutableDirectory(),
+							   mapname);
+		}
+
+		auto GetRectsPath(std::string_view mapname) -> std::string
+		{
+			return std::format("{}/maps/{}_rects.bin", GetExecutableDirectory(),
+							   mapname);
+		}
+
+		template <typename T>
+		auto BindSection(std::span<const oxyU8> image,
+						 const CookedMapDefines::Header& header,
+						 CookedMapDefines::SectionIndex index,
+						 std::span<const T>& view) -> oxyBool
+		{
+			view = {};
+			const auto& section = header.m_sections[index];
+			if (section.m_offset > image.size() ||
+				section.m_size > image.size() - section.m_offset)
+				return false;
+			const auto data = image.data() + section.m_offset;
+			if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) ||
+				section.m_size % sizeof(T))
+				return false;
+			view = {reinterpret_cast<const T*>(data),
+					static_cast<oxySize>(section.m_size / sizeof(T))};
+			return true;
+		}
+
+		struct ImageWriter
+		{
+			std::vector<oxyU8> m_bytes;
+			CookedMapDefines::Header m_header{};
+
+			template <typename T>
+			auto AddSection(CookedMapDefines::SectionIndex index,
+							std::span<const T> data) -> void
+			{
+				const auto offset =
+					(m_bytes.size() + CookedMapDefines::k_SectionAlignment - 1) &
+					~(CookedMapDefines::k_SectionAlignment - 1);
+				m_bytes.resize(offset + data.size_bytes());
+				if (data.size_bytes())
+					std::memcpy(m_bytes.data() + offset, data.data(),
+								data.size_bytes());
+				m_header.m_sections[index] = {offset, data.size_bytes()};
+			}
+		};
+
+		struct EntityParseError
+		{
+			oxySize m_line;
+			std::string_view m_message;
+		};
+
+		// Appends the lump's entities straight to the cooked sections, keys
+		// and values are copied into the one string arena so nothing is
+		// allocated per key. Stops at the first error, what was parsed
+		// before it is kept.
+		auto ParseEntities(std::span<const oxyChar> text,
+						   std::vector<CookedMapDefines::Entity>& entities,
+						   std::vector<CookedMapDefines::KeyValue>& keyValues,
+						   std::vector<oxyChar>& strings)
+			-> std::optional<EntityParseError>
+		{
+			// Upper bounds, every key and value is quoted
+			strings.reserve(strings.size() + text.size());
+			keyValues.reserve(keyValues.size() +
+							  std::count(text.begin(), text.end(), '\"') / 4);
+
+			auto start = text.data();
+			const auto end = text.data() + text.size();
+			const auto Error = [&](std::string_view message) {
+				const auto newlines = std::count(text.data(), start, '\n');
+				return EntityParseError{static_cast<oxySize>(newlines) + 1,
+										message};
+			};
+			const auto SkipWhitespace = [&]() {
+				while (start < end && (*start == ' ' || *start == '\t' ||
+									   *start == '\n' || *start == '\r'))
+					++start;
+			};
+			const auto ReadQuoted = [&](oxyU32& offset,
+										oxyU32& length) -> oxyBool {
+				if (start == end || *start != '\"')
+					return false;
+				const auto close = std::find(start + 1, end, '\"');
+				if (close == end)
+					return false;
+				offset = static_cast<oxyU32>(strings.size());
+				length = static_cast<oxyU32>(close - (start + 1));
+				strings.insert(strings.end(), start + 1, close);
+				start = close + 1;
+				return true;
+			};
+			const auto StringAt = [&](oxyU32 offset, oxyU32 length) {
+				return std::string_view{strings.data() + offset, length};
+			};
+
+			while (true)
+			{
+				SkipWhitespace();
+				// The lump is usually null terminated
+				if (start == end || *start == '\0')
+					return std::nullopt;
+				if (*start != '{')
+					return Error("expected '{'");
+				++start;
+
+				// An entity cut short is dropped whole
+				const auto firstKeyValue =
+					static_cast<oxyU32>(keyValues.size());
+				const auto Fail = [&](std::string_view message) {
+					keyValues.resize(firstKeyValue);
+					if (start < end && *start == '\"')
+						message = "unterminated quoted string";
+					return Error(message);
+				};
+				while (true)
+				{
+					SkipWhitespace();
+					if (start == end)
+						return Fail("missing '}' at the end of the lump");
+					if (*start == '}')
+					{
+						++start;
+						break;
+					}
+					CookedMapDefines::KeyValue kv{};
+					if (!ReadQuoted(kv.m_keyOffset, kv.m_keyLength))
+						return Fail("expected a quoted key");
+					SkipWhitespace();
+					if (!ReadQuoted(kv.m_valueOffset, kv.m_valueLength))
+						return Fail("expected a quoted value");
+
+					// Later duplicates of a key win
+					const auto key = StringAt(kv.m_keyOffset, kv.m_keyLength);
+					const auto existing = std::find_if(
+						keyValues.begin() + firstKeyValue, keyValues.end(),
+						[&](const auto& other) {
+							return StringAt(other.m_keyOffset,
+											other.m_keyLength) == key;
+						});
+					if (existing != keyValues.end())
+					{
+						existing->m_valueOffset = kv.m_valueOffset;
+						existing->m_valueLength = kv.m_valueLength;
+					}
+					else
+						keyValues.push_back(kv);
+				}
+				const auto count =
+					static_cast<oxyU32>(keyValues.size()) - firstKeyValue;
+				if (count)
+					entities.push_back({firstKeyValue, count});
+			}
+		}
+
+		auto DecompressVis(std::span<const oxyU8> in,
+						   std::span<oxyU8> out) -> void
+		{
+			auto src = in.begin();
+			auto dst = out.begin();
+			while (dst != out.end() && src != in.end())
+			{
+				if (*src)
+				{
+					*dst++ = *src++;
+					continue;
+				}
+				if (++src == in.end())
+					break;
+				const auto run = (std::min)(static_cast<oxySSize>(*src++),
+											out.end() - dst);
+				dst = std::fill_n(dst, run, oxyU8{});
+			}
+		}
+
+		// Faces [firstFace, lastFace) as fan quads, see CookedMapDefines::Poly.
+		// outRanges covers every face, the ranges written are relative to
+		// outPolys.
+		auto TriangulateFaces(const BSPWorldData& bsp,
+							  std::span<const std::array<oxyU32, 4>> rects,
+							  oxySize firstFace, oxySize lastFace,
+							  std::vector<CookedMapDefines::Poly>& outPolys,
+							  std::span<CookedMapDefines::PolyRange> outRanges)
+			-> void
+		{
+			for (oxySize faceindex = firstFace; faceindex < lastFace;
+				 ++faceindex)
+			{
+				const auto& face = bsp.m_faces[faceindex];
+				static constexpr auto k_maxFaceVertices = 128;
+				oxyVec3 faceVerts[k_maxFaceVertices];
+				oxyVec2 faceUVs[k_maxFaceVertices];
+				oxySize numVerts{};
+
+				const auto& surfedges = bsp.m_surfedges;
+				const auto& edges = bsp.m_edges;
+				const auto& vertices = bsp.m_vertices;
+
+				const auto& texinfo = bsp.m_texinfo[face.m_texInfoIndex];
+				const auto& miptex = bsp.m_miptex[texinfo.m_mipTexIndex];
+				const auto& texvecs = texinfo.m_vecs[0];
+				const auto& texvect = texinfo.m_vecs[1];
+
+				const auto invWidth = 1.f / miptex.m_width;
+				const auto invHeight = 1.f / miptex.m_height;
+
+				const auto texidx = texinfo.m_mipTexIndex;
+
+				const auto firstEdgeIdx = face.m_firstEdgeIndex;
+				const auto edgeCount = face.m_edgeCount;
+
+				oxyVec2 minuv{(std::numeric_limits<float>::max)(),
+							  (std::numeric_limits<float>::max)()};
+				oxyVec2 maxuv{(std::numeric_limits<float>::min)(),
+							  (std::numeric_limits<float>::min)()};
+				for (auto j = firstEdgeIdx; j < firstEdgeIdx + edgeCount &&
+											numVerts < k_maxFaceVertices;
+					 ++j)
+				{
+					const auto surfedge = surfedges[j];
+					const auto& edge = edges[std::abs(surfedge)];
+					const auto& v0 =
+						vertices[edge.m_vertexIndices[0]].m_position;
+					const auto& v1 =
+						vertices[edge.m_vertexIndices[1]].m_position;
+
+					const auto cvert = surfedge < 0 ? v1 : v0;
+					const auto u = (texvecs[0] * cvert[0] +
+									texvecs[1] * cvert[1] +
+									texvecs[2] * cvert[2]) +
+								   texvecs[3];
+					const auto v = (texvect[0] * cvert[0] +
+									texvect[1] * cvert[1] +
+									texvect[2] * cvert[2]) +
+								   texvect[3];
+
+					faceVerts[numVerts] = oxyVec3{cvert[0], cvert[1], cvert[2]};
+					faceUVs[numVerts] = {u, v};
+					++numVerts;
+					minuv.x = (std::min)(minuv.x, u);
+					minuv.y = (std::min)(minuv.y, v);
+					maxuv.x = (std::max)(maxuv.x, u);
+					maxuv.y = (std::max)(maxuv.y, v);
+				}
+
+				const auto lightmapped = face.m_lightMapOffset != -1 &&
+										 face.m_lightStyles[0] != 255 &&
+										 rects.size() > faceindex;
+				const auto CalcLightmapUV =
+					[&](const oxyVec2& texuv) -> oxyVec2 {
+					const auto& rect = rects[faceindex];
+					// interpolate texuv into minuv and maxuv
+					const auto ttexu =
+						(texuv.x - minuv.x) / (maxuv.x - minuv.x);
+					const auto ttexv =
+						(texuv.y - minuv.y) / (maxuv.y - minuv.y);
+					// then interpolate into rect
+					const auto lminx = rect[0] + 1;
+					const auto lminy = rect[1] + 1;
+					const auto lmaxx = rect[0] + rect[2] - 1;
+					const auto lmaxy = rect[1] + rect[3] - 1;
+					return {lminx + ttexu * (lmaxx - lminx),
+							lminy + ttexv * (lmaxy - lminy)};
+				};
+
+				// BSP faces are planar and convex, so two neighbouring fan
+				// triangles (0, i, i + 1) and (0, i + 1, i + 2) always form a
+				// planar convex quad (0, i, i + 1, i + 2). An odd vertex count
+				// leaves one triangle at the end of the fan.
+				auto& range = outRanges[faceindex];
+				range.m_firstPoly = static_cast<oxyU32>(outPolys.size());
+				for (oxySize i = 1; i + 1 < numVerts; i += 2)
+				{
+					CookedMapDefines::Poly poly{};
+					poly.m_vertexCount = i + 2 < numVerts ? 4 : 3;
+					const oxySize indices[4] = {0, i, i + 1, i + 2};
+					for (oxyU32 v = 0; v < poly.m_vertexCount; ++v)
+					{
+						const auto idx = indices[v];
+						poly.m_vertices[v] = faceVerts[idx];
+						poly.m_texcoords[v] =
+							faceUVs[idx] * oxyVec2{invWidth, invHeight};
+						if (lightmapped)
+							poly.m_lmtexcoords[v] =
+								CalcLightmapUV(faceUVs[idx]);
+					}
+					poly.m_textureIndex = texidx;
+					outPolys.push_back(poly);
+				}
+				range.m_polyCount =
+					static_cast<oxyU32>(outPolys.size()) - range.m_firstPoly;
+			}
+		}
+
+		// Chunks of faces are triangulated concurrently and joined in face
+		// order, so the result is the same as a single pass
+		auto TriangulateAllFaces(const BSPWorldData& bsp,
+								 std::span<const std::array<oxyU32, 4>> rects,
+								 std::vector<CookedMapDefines::Poly>& outPolys,
+								 std::vector<CookedMapDefines::PolyRange>&
+									 outRanges) -> void
+		{
+			constexpr auto k_minFacesPerChunk = oxySize{256};
+			const auto faceCount = bsp.m_faces.size();
+			auto& jobs = JobSystem::GetInstance();
+			const auto chunkCount =
+				std::clamp<oxySize>(faceCount / k_minFacesPerChunk, 1,
+									jobs.GetWorkerCount() + 1);
+			const auto facesPerChunk = (faceCount + chunkCount - 1) / chunkCount;
+
+			outRanges.resize(faceCount);
+			std::vector<std::vector<CookedMapDefines::Poly>> chunkPolys(
+				chunkCount);
+			jobs.ParallelFor(chunkCount, 1, [&](oxySize begin, oxySize end) {
+				for (auto chunk = begin; chunk < end; ++chunk)
+				{
+					TriangulateFaces(
+						bsp, rects, (std::min)(faceCount, chunk * facesPerChunk),
+						(std::min)(faceCount, (chunk + 1) * facesPerChunk),
+						chunkPolys[chunk], outRanges);
+				}
+			});
+
+			outPolys.clear();
+			for (oxySize chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				const auto base = static_cast<oxyU32>(outPolys.size());
+				const auto first = (std::min)(faceCount, chunk * facesPerChunk);
+				const auto last =
+					(std::min)(faceCount, (chunk + 1) * facesPerChunk);
+				for (auto face = first; face < last; ++face)
+					outRanges[face].m_firstPoly += base;
+				outPolys.insert(outPolys.end(), chunkPolys[chunk].begin(),
+								chunkPolys[chunk].end());
+			}
+		}
+	}; // namespace
+
+	auto GetCookedMapPath(std::string_view mapname) -> std::string
+	{
+		return std::format("{}/maps/{}.oxymap", GetExecutableDirectory(),
+						   mapname);
+	}
+
+	auto CookMapImage(std::string_view mapname,
+					  const BSPWorldData& bsp) -> std::vector<oxyU8>
+	{
+		const auto source = bsp.GetFileBytes();
+		if (source.empty())
+			return {};
+
+		ImageWriter writer;
+		writer.m_bytes.resize(sizeof(CookedMapDefines::Header));
+		auto& header = writer.m_header;
+		header.m_magic = CookedMapDefines::k_Magic;
+		header.m_version = CookedMapDefines::k_Version;
+		if (!GetFileStamp(GetSourcePath(mapname), header.m_sourceSize,
+						  header.m_sourceWriteTime))
+			return {};
+		GetFileStamp(GetRectsPath(mapname), header.m_rectsSize,
+					 header.m_rectsWriteTime);
+
+		// Lightmap rects sidecar, optional
+		std::vector<std::array<oxyU32, 4>> rects;
+		if (const auto rectfile = CreateFileMap(GetRectsPath(mapname)))
+		{
+			const auto bytes = reinterpret_cast<const oxyU8*>(rectfile->GetMap());
+			const auto u32ptr = reinterpret_cast<const oxyU32*>(bytes);
+			if (rectfile->ValidateRange(u32ptr, 4 * sizeof(oxyU32)))
+			{
+				const auto numRects = u32ptr[3];
+				if (rectfile->ValidateRange(u32ptr + 4,
+											numRects * 4 * sizeof(oxyU32)))
+				{
+					rects.resize(numRects);
+					std::memcpy(rects.data(), u32ptr + 4,
+								numRects * 4 * sizeof(oxyU32));
+				}
+			}
+		}
+
+		// The sections only depend on the sources, so they are built
+		// concurrently and written in order once all of them are done
+		std::vector<CookedMapDefines::Poly> polys;
+		std::vector<CookedMapDefines::PolyRange> ranges;
+		auto& jobs = JobSystem::GetInstance();
+		auto TriangulateSection = [&]() {
+			TriangulateAllFaces(bsp, rects, polys, ranges);
+		};
+		JobCounter facesDone;
+		jobs.Run(TriangulateSection, facesDone);
+
+		// Recurse nodes and store parents
+		std::vector<oxyS32> nodeParents(bsp.m_nodes.size());
+		std::vector<oxyS32> leafParents(bsp.m_leaves.size());
+		auto ParentsSection = [&]() {
+			const auto& nodes = bsp.m_nodes;
+			const auto RecurseNode = [&](auto&& Self, oxyS32 nodeIndex,
+										 oxyS32 parentIndex) -> void {
+				if (nodeIndex < 0)
+				{
+					const auto leafIndex = -nodeIndex - 1;
+					if (static_cast<oxySize>(leafIndex) < leafParents.size())
+						leafParents[leafIndex] = parentIndex;
+					return;
+				}
+				if (static_cast<oxySize>(nodeIndex) >= nodes.size())
+					return;
+				nodeParents[nodeIndex] = parentIndex;
+				const auto& node = nodes[nodeIndex];
+				Self(Self, node.m_children[0], nodeIndex);
+				Self(Self, node.m_children[1], nodeIndex);
+			};
+			RecurseNode(RecurseNode, 0, -1);
+		};
+		JobCounter parentsDone;
+		jobs.Run(ParentsSection, parentsDone);
+
+		// PVS, a leaf without visibility data sees every leaf
+		const auto visLeafs =
+			bsp.m_models.empty() ? oxyU32{} : bsp.m_models[0].m_visLeafs;
+		const auto rowBytes = (visLeafs + 7) >> 3;
+		header.m_pvsRowBytes = rowBytes;
+		std::vector<oxyU8> rows(bsp.m_leaves.size() * rowBytes);
+		auto PVSSection = [&]() {
+			for (oxySize i = 0; i < bsp.m_leaves.size(); ++i)
+			{
+				const auto row =
+					std::span<oxyU8>{rows}.subspan(i * rowBytes, rowBytes);
+				const auto visOffset = bsp.m_leaves[i].m_visOffset;
+				if (visOffset < 0 ||
+					static_cast<oxySize>(visOffset) >= bsp.m_visibility.size())
+				{
+					for (oxyU32 leaf = 0; leaf < visLeafs; ++leaf)
+						row[leaf >> 3] |= static_cast<oxyU8>(1 << (leaf & 7));
+					continue;
+				}
+				DecompressVis(bsp.m_visibility.subspan(visOffset), row);
+			}
+		};
+		JobCounter pvsDone;
+		jobs.Run(PVSSection, pvsDone);
+
+		// Entities, on this thread
+		std::vector<CookedMapDefines::Entity> entities;
+		std::vector<CookedMapDefines::KeyValue> keyValues;
+		std::vector<oxyChar> strings;
+		if (const auto error =
+				ParseEntities(bsp.m_entities, entities, keyValues, strings))
+		{
+			LogMessage(std::format("{}: entity lump line {}: {}\n", mapname,
+								   error->m_line, error->m_message)
+						   .c_str());
+		}
+
+		jobs.Wait(facesDone);
+		writer.AddSection(CookedMapDefines::SectionIndex_Polys,
+						  std::span<const CookedMapDefines::Poly>{polys});
+		writer.AddSection(CookedMapDefines::SectionIndex_FacePolys,
+						  std::span<const CookedMapDefines::PolyRange>{ranges});
+		jobs.Wait(parentsDone);
+		writer.AddSection(CookedMapDefines::SectionIndex_NodeParents,
+						  std::span<const oxyS32>{nodeParents});
+		writer.AddSection(CookedMapDefines::SectionIndex_LeafParents,
+						  std::span<const oxyS32>{leafParents});
+		jobs.Wait(pvsDone);
+		writer.AddSection(CookedMapDefines::SectionIndex_PVSRows,
+						  std::span<const oxyU8>{rows});
+		writer.AddSection(CookedMapDefines::SectionIndex_Entities,
+						  std::span<const CookedMapDefines::Entity>{entities});
+		writer.AddSection(
+			CookedMapDefines::SectionIndex_KeyValues,
+			std::span<const CookedMapDefines::KeyValue>{keyValues});
+		writer.AddSection(CookedMapDefines::SectionIndex_Strings,
+						  std::span<const oxyChar>{strings});
+		writer.AddSection(CookedMapDefines::SectionIndex_LightmapRects,
+						  std::span<const std::array<oxyU32, 4>>{rects});
+
+		std::memcpy(writer.m_bytes.data(), &header,
+					sizeof(CookedMapDefines::Header));
+		return std::move(writer.m_bytes);
+	}
+
+	auto CookedMapData::Load(std::string_view mapname,
+							 const BSPWorldData& bsp) -> oxyBool
+	{
+		m_image.clear();
+		m_fileMap = CreateFileMap(GetCookedMapPath(mapname));
+		if (!m_fileMap)
+			return false;
+		const auto image = std::span<const oxyU8>{
+			reinterpret_cast<const oxyU8*>(m_fileMap->GetMap()),
+			m_fileMap->GetSize()};
+		if (image.size() < sizeof(CookedMapDefines::Header))
+		{
+			m_fileMap.reset();
+			return false;
+		}
+
+		// Stale if either source changed since it was cooked, judged from the
+		// file stamps so a load never reads the sources through
+		CookedMapDefines::Header header;
+		std::memcpy(&header, image.data(), sizeof(CookedMapDefines::Header));
+		auto sourceSize = oxyU64{};
+		auto sourceWriteTime = oxyU64{};
+		auto rectsSize = oxyU64{};
+		auto rectsWriteTime = oxyU64{};
+		GetFileStamp(GetSourcePath(mapname), sourceSize, sourceWriteTime);
+		GetFileStamp(GetRectsPath(mapname), rectsSize, rectsWriteTime);
+		const auto upToDate = header.m_sourceSize == sourceSize &&
+							  header.m_sourceSize == bsp.GetFileBytes().size() &&
+							  header.m_sourceWriteTime == sourceWriteTime &&
+							  header.m_rectsSize == rectsSize &&
+							  header.m_rectsWriteTime == rectsWriteTime;
+		if (!upToDate || !Bind(image, bsp))
+		{
+			m_fileMap.reset();
+			return false;
+		}
+		return true;
+	}
+
+	auto CookedMapData::LoadFromSource(std::string_view mapname,
+									   const BSPWorldData& bsp) -> oxyBool
+	{
+		m_fileMap.reset();
+		m_image = CookMapImage(mapname, bsp);
+		return !m_image.empty() && Bind(m_image, bsp);
+	}
+
+	auto CookedMapData::FindValue(const CookedMapDefines::Entity& entity,
+								  std::string_view key) const
+		-> std::optional<std::string_view>
+	{
+		for (const auto& kv : m_keyValues.subspan(entity.m_firstKeyValue,
+												  entity.m_keyValueCount))
+		{
+			if (std::string_view{m_strings.data() + kv.m_keyOffset,
+								 kv.m_keyLength} == key)
+				return std::string_view{m_strings.data() + kv.m_valueOffset,
+										kv.m_valueLength};
+		}
+		return std::nullopt;
+	}
+	namespace
+	{
+		// Fills every element from whitespace separated numbers, anything
+		// left over or missing fails
+		template <typename T>
+		auto ParseNumbers(std::string_view text, std::span<T> out) -> oxyBool
+		{
+			auto start = text.data();
+			const auto end = text.data() + text.size();
+			const auto SkipSpaces = [&]() {
+				while (start < end && (*start == ' ' || *start == '\t'))
+					++start;
+			};
+			for (auto& value : out)
+			{
+				SkipSpaces();
+				// from_chars takes a minus sign but not a plus
+				if (start < end && *start == '+')
+					++start;
+				const auto [ptr, ec] = std::from_chars(start, end, value);
+				if (ec != std::errc{})
+					return false;
+				start = ptr;
+			}
+			SkipSpaces();
+			return start == end;
+		}
+	}; // namespace
+	auto CookedMapData::FindFloat(const CookedMapDefines::Entity& entity,
+								  std::string_view key) const
+		-> std::optional<oxyF32>
+	{
+		const auto value = FindValue(entity, key);
+		oxyF32 result;
+		if (!value || !ParseNumbers(*value, std::span{&result, 1}))
+			return std::nullopt;
+		return result;
+	}
+	auto CookedMapData::FindInt(const CookedMapDefines::Entity& entity,
+								std::string_view key) const
+		-> std::optional<oxyS32>
+	{
+		const auto value = FindValue(entity, key);
+		oxyS32 result;
+		if (!value || !ParseNumbers(*value, std::span{&result, 1}))
+			return std::nullopt;
+		return result;
+	}
+	auto CookedMapData::FindVec3(const CookedMapDefines::Entity& entity,
+								 std::string_view key) const
+		-> std::optional<oxyVec3>
+	{
+		const auto value = FindValue(entity, key);
+		oxyF32 result[3];
+		if (!value || !ParseNumbers(*value, std::span<oxyF32>{result}))
+			return std::nullopt;
+		return oxyVec3{result[0], result[1], result[2]};
+	}
+
+	auto CookedMapData::Bind(std::span<const oxyU8> image,
+							 const BSPWorldData& bsp) -> oxyBool
+	{
+		if (image.size() < sizeof(CookedMapDefines::Header))
+			return false;
+		CookedMapDefines::Header header;
+		std::memcpy(&header, image.data(), sizeof(CookedMapDefines::Header));
+		if (header.m_magic != CookedMapDefines::k_Magic ||
+			header.m_version != CookedMapDefines::k_Version)
+			return false;
+
+		if (!BindSection(image, header, CookedMapDefines::SectionIndex_Polys,
+						 m_polys) ||
+			!BindSection(image, header,
+						 CookedMapDefines::SectionIndex_FacePolys,
+						 m_facePolys) ||
+			!BindSection(image, header,
+						 CookedMapDefines::SectionIndex_NodeParents,
+						 m_nodeParents) ||
+			!BindSection(image, header,
+						 CookedMapDefines::SectionIndex_LeafParents,
+						 m_leafParents) ||
+			!BindSection(image, header, CookedMapDefines::SectionIndex_PVSRows,
+						 m_pvsRows) ||
+			!BindSection(image, header,
+						 CookedMapDefines::SectionIndex_Entities,
+						 m_entities) ||
+			!BindSection(image, header,
+						 CookedMapDefines::SectionIndex_KeyValues,
+						 m_keyValues) ||
+			!BindSection(image, header, CookedMapDefines::SectionIndex_Strings,
+						 m_strings) ||
+			!BindSection(image, header,
+						 CookedMapDefines::SectionIndex_LightmapRects,
+						 m_lightmapRects))
+			return false;
+		m_pvsRowBytes = header.m_pvsRowBytes;
+
+		// The source stamps only say the image was cooked from this .bsp, a
+		// truncated or corrupted image still gets here. Anything the world
+		// indexes with is checked, a failure recooks it.
+		const auto visLeafs =
+			bsp.m_models.empty() ? oxyU32{} : bsp.m_models[0].m_visLeafs;
+		if (m_pvsRowBytes != (visLeafs + 7) >> 3)
+			return false;
+
+		// Per element tables have to line up with the .bsp they index
+		if (m_facePolys.size() != bsp.m_faces.size() ||
+			m_nodeParents.size() != bsp.m_nodes.size() ||
+			m_leafParents.size() != bsp.m_leaves.size() ||
+			m_pvsRows.size() != bsp.m_leaves.size() * m_pvsRowBytes)
+			return false;
+
+		// Every range must stay inside its section
+		const auto InRange = [](oxyU64 first, oxyU64 count, oxySize size) {
+			return first <= size && count <= size - first;
+		};
+		for (const auto& range : m_facePolys)
+		{
+			if (!InRange(range.m_firstPoly, range.m_polyCount, m_polys.size()))
+				return false;
+		}
+		for (const auto& poly : m_polys)
+		{
+			if (poly.m_vertexCount < 3 || poly.m_vertexCount > 4 ||
+				poly.m_textureIndex >= bsp.m_miptex.size())
+				return false;
+		}
+		// Parent walks stop at -1 above the root
+		const auto IsParent = [&](oxyS32 parent) {
+			return parent >= -1 &&
+				   parent < static_cast<oxyS64>(bsp.m_nodes.size());
+		};
+		if (!std::ranges::all_of(m_nodeParents, IsParent) ||
+			!std::ranges::all_of(m_leafParents, IsParent))
+			return false;
+		for (const auto& entity : m_entities)
+		{
+			if (!InRange(entity.m_firstKeyValue, entity.m_keyValueCount,
+						 m_keyValues.size()))
+				return false;
+		}
+		for (const auto& kv : m_keyValues)
+		{
+			if (!InRange(kv.m_keyOffset, kv.m_keyLength, m_strings.size()) ||
+				!InRange(kv.m_valueOffset, kv.m_valueLength, m_strings.size()))
+				return false;
+		}
+		return true;
+	}
+}; // namespace oxygen
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "BSP.h"
+
+namespace oxygen
+{
+	// .oxymap, everything LoadWorld used to derive from a .bsp and its sidecars
+	// at every load. Sections are addressed by offsets relative to the start
+	// of the file so the image is used in place, whether it was mapped from
+	// disk or cooked into memory.
+	namespace CookedMapDefines
+	{
+		inline constexpr auto k_Magic = oxyU32{0x50414D4F}; // "OMAP"
+		inline constexpr auto k_Version = oxyU32{3};
+		inline constexpr auto k_SectionAlignment = oxySize{16};
+
+		enum SectionIndex
+		{
+			SectionIndex_Polys = 0,
+			SectionIndex_FacePolys,
+			SectionIndex_NodeParents,
+			SectionIndex_LeafParents,
+			SectionIndex_PVSRows,
+			SectionIndex_Entities,
+			SectionIndex_KeyValues,
+			SectionIndex_Strings,
+			SectionIndex_LightmapRects,
+			SectionIndex_Count
+		};
+
+		struct Section
+		{
+			oxyU64 m_offset;
+			oxyU64 m_size; // bytes
+		};
+		static_assert(sizeof(Section) == 16,
+					  "Section struct size is not 16 bytes");
+
+		struct Header
+		{
+			oxyU32 m_magic;
+			oxyU32 m_version;
+			// Size and write time of the sources it was cooked from, a
+			// mismatch means it is stale
+			oxyU64 m_sourceSize;
+			oxyU64 m_sourceWriteTime;
+			oxyU64 m_rectsSize;
+			oxyU64 m_rectsWriteTime;
+			oxyU32 m_pvsRowBytes;
+			oxyU32 m_padding;
+			Section m_sections[SectionIndex_Count];
+		};
+		static_assert(sizeof(Header) == 192,
+					  "Header struct size is not 192 bytes");
+		static_assert(std::is_trivial_v<Header>,
+					  "Header struct is not a trivial type");
+		static_assert(offsetof(Header, m_sections) == 48,
+					  "Header struct m_sections offset is not 48");
+
+		// Fan quad of a face, or a triangle for the leftover when
+		// m_vertexCount is 3. Lightmap coordinates are in texels since the
+		// lightmap texture size is only known at runtime.
+		struct Poly
+		{
+			oxyVec3 m_vertices[4];
+			oxyVec2 m_texcoords[4];
+			oxyVec2 m_lmtexcoords[4];
+			oxyU32 m_textureIndex;
+			oxyU32 m_vertexCount;
+		};
+		static_assert(sizeof(Poly) == 120, "Poly struct size is not 120 bytes");
+		static_assert(std::is_trivially_copyable_v<Poly>,
+					  "Poly struct is not trivially copyable");
+
+		// Per BSP face
+		struct PolyRange
+		{
+			oxyU32 m_firstPoly;
+			oxyU32 m_polyCount;
+		};
+		static_assert(sizeof(PolyRange) == 8,
+					  "PolyRange struct size is not 8 bytes");
+
+		struct Entity
+		{
+			oxyU32 m_firstKeyValue;
+			oxyU32 m_keyValueCount;
+		};
+		static_assert(sizeof(Entity) == 8, "Entity struct size is not 8 bytes");
+
+		// Offsets into the string section
+		struct KeyValue
+		{
+			oxyU32 m_keyOffset;
+			oxyU32 m_keyLength;
+			oxyU32 m_valueOffset;
+			oxyU32 m_valueLength;
+		};
+		static_assert(sizeof(KeyValue) == 16,
+					  "KeyValue struct size is not 16 bytes");
+	}; // namespace CookedMapDefines
+
+	struct CookedMapData : NonCopyable
+	{
+		std::span<const CookedMapDefines::Poly> m_polys;
+		std::span<const CookedMapDefines::PolyRange> m_facePolys;
+		std::span<const oxyS32> m_nodeParents;
+		std::span<const oxyS32> m_leafParents;
+		// Decompressed PVS, one row per leaf, bit i is leaf i + 1
+		std::span<const oxyU8> m_pvsRows;
+		oxyU32 m_pvsRowBytes{};
+		std::span<const CookedMapDefines::Entity> m_entities;
+		std::span<const CookedMapDefines::KeyValue> m_keyValues;
+		std::span<const oxyChar> m_strings;
+		std::span<const std::array<oxyU32, 4>> m_lightmapRects;
+
+		// Maps maps/<mapname>.oxymap, fails if it is missing, another version
+		// or cooked from a different .bsp or rects sidecar
+		auto Load(std::string_view mapname, const BSPWorldData& bsp) -> oxyBool;
+		// Cooks the same image in memory from the sources
+		auto LoadFromSource(std::string_view mapname,
+							const BSPWorldData& bsp) -> oxyBool;
+
+		auto GetPVSRow(oxySize leafIndex) const -> std::span<const oxyU8>
+		{
+			return m_pvsRows.subspan(leafIndex * m_pvsRowBytes, m_pvsRowBytes);
+		}
+		auto
+		FindValue(const CookedMapDefines::Entity& entity,
+				  std::string_view key) const -> std::optional<std::string_view>;
+		// Typed values, empty if the key is missing or the value malformed.
+		// Vectors are space separated as in "origin" "0 0 64".
+		auto FindFloat(const CookedMapDefines::Entity& entity,
+					   std::string_view key) const -> std::optional<oxyF32>;
+		auto FindInt(const CookedMapDefines::Entity& entity,
+					 std::string_view key) const -> std::optional<oxyS32>;
+		auto FindVec3(const CookedMapDefines::Entity& entity,
+					  std::string_view key) const -> std::optional<oxyVec3>;
+
+	  private:
+		auto Bind(std::span<const oxyU8> image, const BSPWorldData& bsp) -> oxyBool;
+
+		UniqueFileMap m_fileMap{};
+		std::vector<oxyU8> m_image;
+	};
+
+	auto GetCookedMapPath(std::string_view mapname) -> std::string;
+
+	// Builds the .oxymap image for a loaded .bsp, empty on failure
+	auto CookMapImage(std::string_view mapname,
+					  const BSPWorldData& bsp) -> std::vector<oxyU8>;
+}; // namespace oxygen
@@ -0,0 +1,419 @@
+#include "OxygenPCH.h"
+#include "PhysicsWorld.h"
+#include "World.h"
+#include "BSP.h"
+#include "WorldLoader.h"
+
+#include "Entity/Entity.h"
+#include "Component/HullComponent/HullComponent.h"
+#include "Job/JobSystem.h"
+#include "Platform/Platform.h"
+
+#if defined(OXYBUILDARCHWINDOWSX64)
+#include <xmmintrin.h>
+#endif
+
+namespace oxygen
+{
+	auto PhysicsWorld::Step(World& world,
+							std::span<const std::shared_ptr<Entity>> entities,
+							oxyF32 deltaTimeSeconds) -> void
+	{
+		Gather(entities);
+		IntegratePositions(deltaTimeSeconds);
+		Sweep(world);
+
+		// Bodies resolve in entity order and are relinked straight away, so
+		// a later body collides with where an earlier one ended up. Hull
+		// contacts fire gameplay callbacks and share the world's query
+		// scratch, so this part stays on one thread.
+		for (oxySize i = 0; i < m_bodies.size(); ++i)
+		{
+			const auto& body = m_bodies[i];
+			if (body.m_entity->GetFlag(EntityFlags_Disabled))
+				continue;
+			auto& hull = *body.m_hull;
+			hull.m_velocity = {m_velocityX[i], m_velocityY[i], m_velocityZ[i]};
+			hull.ResolveBounce({m_positionX[i], m_positionY[i], m_positionZ[i]},
+							   {m_endX[i], m_endY[i], m_endZ[i]},
+							   m_sweepHit[i] ? &m_sweepPosition[i] : nullptr,
+							   m_sweepNormal[i], world, *body.m_entity);
+			m_velocityX[i] = hull.m_velocity.x;
+			m_velocityY[i] = hull.m_velocity.y;
+			m_velocityZ[i] = hull.m_velocity.z;
+			if (!body.m_entity->GetFlag(EntityFlags_Disabled))
+				world.LinkEntity(*body.m_entity);
+		}
+
+		IntegrateVelocities(deltaTimeSeconds);
+		StoreVelocities();
+		m_bodyCount = m_bodies.size();
+		m_bodies.clear();
+	}
+
+	auto PhysicsWorld::Gather(
+		std::span<const std::shared_ptr<Entity>> entities) -> void
+	{
+		m_bodies.clear();
+		for (const auto& ent : entities)
+		{
+			if (ent->GetFlag(EntityFlags_Disabled))
+				continue;
+			const auto hull = ent->FindComponent<HullComponent>();
+			if (!hull || !hull->IsEnabled() ||
+				hull->m_response != CollisionResponseType_Bounce)
+				continue;
+			m_bodies.push_back({ent, hull});
+		}
+
+		const auto padded =
+			(m_bodies.size() + k_lanes - 1) / k_lanes * k_lanes;
+		for (auto* lane : {&m_positionX, &m_positionY, &m_positionZ,
+						   &m_velocityX, &m_velocityY, &m_velocityZ, &m_endX,
+						   &m_endY, &m_endZ, &m_gravity, &m_drag})
+			lane->assign(padded, 0.f);
+		for (oxySize i = 0; i < m_bodies.size(); ++i)
+		{
+			const auto& body = m_bodies[i];
+			const auto position = body.m_entity->GetWorldPosition();
+			const auto& velocity = body.m_hull->m_velocity;
+			m_positionX[i] = position.x;
+			m_positionY[i] = position.y;
+			m_positionZ[i] = position.z;
+			m_velocityX[i] = velocity.x;
+			m_velocityY[i] = velocity.y;
+			m_velocityZ[i] = velocity.z;
+			m_gravity[i] = body.m_hull->m_gravityPerSecond;
+			m_drag[i] = body.m_hull->m_drag;
+		}
+	}
+
+	auto PhysicsWorld::StoreVelocities() -> void
+	{
+		for (oxySize i = 0; i < m_bodies.size(); ++i)
+		{
+			m_bodies[i].m_hull->m_velocity = {m_velocityX[i], m_velocityY[i],
+											  m_velocityZ[i]};
+		}
+	}
+
+	// Both integrators do the same multiplies and adds in the same order as
+	// the per-body math did, so the results match it bit for bit
+	auto PhysicsWorld::IntegratePositions(oxyF32 deltaTimeSeconds) -> void
+	{
+		const auto count = m_positionX.size();
+#if defined(OXYBUILDARCHWINDOWSX64)
+		const auto dt = _mm_set1_ps(deltaTimeSeconds);
+		const auto Lane = [&](const std::vector<oxyF32>& position,
+							  const std::vector<oxyF32>& velocity,
+							  std::vector<oxyF32>& end, oxySize i) {
+			const auto step = _mm_mul_ps(_mm_loadu_ps(&velocity[i]), dt);
+			_mm_storeu_ps(&end[i],
+						  _mm_add_ps(_mm_loadu_ps(&position[i]), step));
+		};
+		for (oxySize i = 0; i < count; i += k_lanes)
+		{
+			Lane(m_positionX, m_velocityX, m_endX, i);
+			Lane(m_positionY, m_velocityY, m_endY, i);
+			Lane(m_positionZ, m_velocityZ, m_endZ, i);
+		}
+#else
+		for (oxySize i = 0; i < count; ++i)
+		{
+			m_endX[i] = m_positionX[i] + m_velocityX[i] * deltaTimeSeconds;
+			m_endY[i] = m_positionY[i] + m_velocityY[i] * deltaTimeSeconds;
+			m_endZ[i] = m_positionZ[i] + m_velocityZ[i] * deltaTimeSeconds;
+		}
+#endif
+	}
+
+	auto PhysicsWorld::IntegrateVelocities(oxyF32 deltaTimeSeconds) -> void
+	{
+		const auto count = m_velocityX.size();
+#if defined(OXYBUILDARCHWINDOWSX64)
+		const auto dt = _mm_set1_ps(deltaTimeSeconds);
+		const auto one = _mm_set1_ps(1.f);
+		for (oxySize i = 0; i < count; i += k_lanes)
+		{
+			const auto gravity = _mm_mul_ps(_mm_loadu_ps(&m_gravity[i]), dt);
+			_mm_storeu_ps(&m_velocityZ[i],
+						  _mm_sub_ps(_mm_loadu_ps(&m_velocityZ[i]), gravity));
+			const auto drag =
+				_mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(&m_drag[i]), dt));
+			_mm_storeu_ps(&m_velocityX[i],
+						  _mm_mul_ps(_mm_loadu_ps(&m_velocityX[i]), drag));
+			_mm_storeu_ps(&m_velocityY[i],
+						  _mm_mul_ps(_mm_loadu_ps(&m_velocityY[i]), drag));
+		}
+#else
+		for (oxySize i = 0; i < count; ++i)
+		{
+			m_velocityZ[i] -= m_gravity[i] * deltaTimeSeconds;
+			m_velocityX[i] *= 1.0f - m_drag[i] * deltaTimeSeconds;
+			m_velocityY[i] *= 1.0f - m_drag[i] * deltaTimeSeconds;
+		}
+#endif
+	}
+
+	auto PhysicsWorld::Sweep(const World& world) -> void
+	{
+		const auto count = m_bodies.size();
+		m_sweepHit.assign(count, 0);
+		m_sweepPosition.resize(count);
+		m_sweepNormal.resize(count);
+		// A body's sweep reads its own starting state and the map, nothing
+		// another one writes, so how the bodies are split between threads
+		// can not change a result
+		JobSystem::GetInstance().ParallelFor(
+			count, m_bodiesPerSweepJob, [&](oxySize begin, oxySize end) {
+				// Kept by each thread from step to step, grown for a deeper
+				// tree than it has traced before
+				thread_local std::vector<World::TraceSegment> t_stack;
+				if (t_stack.size() < world.m_traceStack.size())
+					t_stack.resize(world.m_traceStack.size());
+				const auto stack = std::span{t_stack};
+				for (auto i = begin; i < end; ++i)
+				{
+					const auto hull = m_bodies[i].m_hull->m_hull;
+					if (hull == CollisionHull_None)
+						continue;
+					World::LineTraceResult result{};
+					if (!world.TraceNodes(
+							world.GetTraceRoot(hull),
+							{m_positionX[i], m_positionY[i], m_positionZ[i]},
+							{m_endX[i], m_endY[i], m_endZ[i]}, result, stack))
+						continue;
+					m_sweepHit[i] = 1;
+					m_sweepPosition[i] = result.m_endPos;
+					m_sweepNormal[i] = result.m_planeNormal;
+				}
+			});
+	}
+
+	namespace
+	{
+		auto SpawnBounceHull(World& world, const oxyVec3& position,
+							 const oxyVec3& velocity) -> std::shared_ptr<Entity>
+		{
+			auto ent = world.SpawnEntity();
+			ent->SetWorldPosition(position);
+			ent->SetFlag(EntityFlags_Dynamic, true);
+			ent->SetFlag(EntityFlags_HasHull, true);
+			auto hull = ent->AddComponent<HullComponent>();
+			hull->SetHull(CollisionHull_Grenade);
+			hull->SetGravityPerSecond(800.f);
+			hull->SetDrag(0.1f);
+			hull->SetResponse(CollisionResponseType_Bounce);
+			hull->SetVelocity(velocity);
+			return ent;
+		}
+
+		auto RandomBounceVelocity() -> oxyVec3
+		{
+			return {RandomF32(-600.f, 600.f), RandomF32(-600.f, 600.f),
+					RandomF32(-100.f, 400.f)};
+		}
+	}; // namespace
+
+	auto BenchmarkPhysics(std::string_view name, oxyU32 bodyCount) -> void
+	{
+		auto world = LoadTraceWorld(name);
+		if (!world)
+		{
+			LogMessage(
+				std::format("BenchmarkPhysics {}: failed to load\n", name)
+					.c_str());
+			return;
+		}
+
+		constexpr auto k_steps = 30;
+		constexpr auto k_deltaTimeSeconds = 1.f / 60.f;
+		for (const auto count : {bodyCount / 4, bodyCount / 2, bodyCount})
+		{
+			std::vector<std::shared_ptr<Entity>> bodies;
+			for (oxyU32 i = 0; i < count; ++i)
+			{
+				bodies.push_back(SpawnBounceHull(*world,
+												 RandomOpenPoint(*world),
+												 RandomBounceVelocity()));
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			for (auto step = 0; step < k_steps; ++step)
+				world->Update(k_deltaTimeSeconds);
+			const auto stepSeconds = std::chrono::duration<oxyF64>(
+										 std::chrono::steady_clock::now() -
+										 start)
+										 .count();
+
+			// Integration alone, the batched arrays against the per-body
+			// math on each component. Body state lives on the components, so
+			// the batched side pays for gathering it and storing velocities
+			// back every step as a real step does.
+			auto& physics = world->m_physics;
+			start = std::chrono::steady_clock::now();
+			for (auto step = 0; step < k_steps; ++step)
+			{
+				physics.Gather(world->m_entities);
+				physics.IntegratePositions(k_deltaTimeSeconds);
+				physics.IntegrateVelocities(k_deltaTimeSeconds);
+				physics.StoreVelocities();
+			}
+			const auto batchedSeconds = std::chrono::duration<oxyF64>(
+											std::chrono::steady_clock::now() -
+											start)
+											.count();
+			physics.m_bodies.clear();
+			// The per-body side walks the same entities for their hulls
+			start = std::chrono::steady_clock::now();
+			for (auto step = 0; step < k_steps; ++step)
+			{
+				oxySize i = 0;
+				for (const auto& ent : world->m_entities)
+				{
+					if (ent->GetFlag(EntityFlags_Disabled))
+						continue;
+					const auto hull = ent->FindComponent<HullComponent>();
+					if (!hull || !hull->IsEnabled() ||
+						hull->m_response != CollisionResponseType_Bounce)
+						continue;
+					auto& velocity = hull->m_velocity;
+					const auto gravity = hull->m_gravityPerSecond;
+					const auto drag = hull->m_drag;
+					const auto end = ent->GetWorldPosition() +
+									 velocity * k_deltaTimeSeconds;
+					physics.m_endX[i] = end.x;
+					physics.m_endY[i] = end.y;
+					physics.m_endZ[i] = end.z;
+					++i;
+					velocity.z -= gravity * k_deltaTimeSeconds;
+					velocity.x *= 1.0f - drag * k_deltaTimeSeconds;
+					velocity.y *= 1.0f - drag * k_deltaTimeSeconds;
+				}
+			}
+			const auto perBodySeconds = std::chrono::duration<oxyF64>(
+											std::chrono::steady_clock::now() -
+											start)
+											.count();
+
+			const auto bodySteps = static_cast<oxyF64>(count) * k_steps;
+			LogMessage(
+				std::format("BenchmarkPhysics {} x{}: {:.3f} us per body step, "
+							"integration {:.1f} ns batched with gather and "
+							"store, {:.1f} ns per body\n",
+							name, count, stepSeconds * 1e6 / bodySteps,
+							batchedSeconds * 1e9 / bodySteps,
+							perBodySeconds * 1e9 / bodySteps)
+					.c_str());
+
+			for (const auto& ent : bodies)
+				ent->Destroy();
+		}
+	}
+
+	auto CheckPhysicsDeterminism(std::string_view name, oxyU32 bodyCount,
+								 oxyBool jobPerBody) -> void
+	{
+		struct BodyState
+		{
+			oxyVec3 m_position;
+			oxyVec3 m_velocity;
+		};
+		std::vector<BodyState> start;
+		{
+			const auto world = LoadTraceWorld(name);
+			if (!world)
+			{
+				LogMessage(std::format("CheckPhysicsDeterminism {}: failed to "
+									   "load\n",
+									   name)
+							   .c_str());
+				return;
+			}
+			for (oxyU32 i = 0; i < bodyCount; ++i)
+				start.push_back({RandomOpenPoint(*world), RandomBounceVelocity()});
+		}
+
+		// Each run gets a world of its own so nothing the first one linked
+		// is left for the second to collide with
+		constexpr auto k_steps = 120;
+		constexpr auto k_deltaTimeSeconds = 1.f / 60.f;
+		const auto Run = [&](oxySize bodiesPerSweepJob, oxyF64& seconds) {
+			const auto world = LoadTraceWorld(name);
+			world->m_physics.m_bodiesPerSweepJob = bodiesPerSweepJob;
+			std::vector<std::shared_ptr<Entity>> bodies;
+			for (const auto& body : start)
+			{
+				bodies.push_back(SpawnBounceHull(*world, body.m_position,
+												 body.m_velocity));
+			}
+			const auto begin = std::chrono::steady_clock::now();
+			for (auto step = 0; step < k_steps; ++step)
+				world->Update(k_deltaTimeSeconds);
+			seconds = std::chrono::duration<oxyF64>(
+						  std::chrono::steady_clock::now() - begin)
+						  .count();
+			std::vector<BodyState> end;
+			for (const auto& ent : bodies)
+			{
+				end.push_back({ent->GetWorldPosition(),
+							   ent->FindComponent<HullComponent>()
+								   ->GetVelocity()});
+				ent->Destroy();
+			}
+			return end;
+		};
+		// Compared as bits, a -0 against a 0 or two different NaNs count
+		const auto Bits = [](const oxyVec3& v) {
+			return std::array{std::bit_cast<oxyU32>(v.x),
+							  std::bit_cast<oxyU32>(v.y),
+							  std::bit_cast<oxyU32>(v.z)};
+		};
+		oxyF64 serialSeconds = 0.0;
+		const auto serial = Run(bodyCount, serialSeconds);
+		const auto Compare = [&](oxySize bodiesPerSweepJob) {
+			oxyF64 parallelSeconds = 0.0;
+			const auto parallel = Run(bodiesPerSweepJob, parallelSeconds);
+			oxySize mismatches = 0;
+			for (oxySize i = 0; i < serial.size(); ++i)
+			{
+				if (Bits(serial[i].m_position) ==
+						Bits(parallel[i].m_position) &&
+					Bits(serial[i].m_velocity) == Bits(parallel[i].m_velocity))
+					continue;
+				if (!mismatches++)
+				{
+					const auto& a = serial[i];
+					const auto& b = parallel[i];
+					LogMessage(
+						std::format("CheckPhysicsDeterminism {}: body {} ends "
+									"at ({}, {}, {}) moving ({}, {}, {}) on "
+									"one thread, ({}, {}, {}) moving ({}, {}, "
+									"{}) {} a job\n",
+									name, i, a.m_position.x, a.m_position.y,
+									a.m_position.z, a.m_velocity.x,
+									a.m_velocity.y, a.m_velocity.z,
+									b.m_position.x, b.m_position.y,
+									b.m_position.z, b.m_velocity.x,
+									b.m_velocity.y, b.m_velocity.z,
+									bodiesPerSweepJob)
+							.c_str());
+				}
+			}
+			LogMessage(
+				std::format("CheckPhysicsDeterminism {} x{}: {} steps, {} "
+							"bodies differ between 1 and {} threads at {} a "
+							"job, {:.3f} ms against {:.3f} ms\n",
+							name, bodyCount, k_steps, mismatches,
+							JobSystem::GetInstance().GetWorkerCount() + 1,
+							bodiesPerSweepJob, serialSeconds * 1000.0,
+							parallelSeconds * 1000.0)
+					.c_str());
+		};
+		// Split as a game step splits them, then optionally one body a job
+		// so every sweep can land on a different thread
+		Compare(PhysicsWorld::k_bodiesPerSweepJob);
+		if (jobPerBody)
+			Compare(1);
+	}
+}; // namespace oxygen
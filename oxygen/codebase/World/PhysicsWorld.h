@@ -0,0 +1,82 @@
+#pragma once
+
+namespace oxygen
+{
+	// Bounce hulls (projectiles, grenades, thrown clubs) stepped together
+	// where the ComponentScheduler's order puts them, after the players and
+	// weapons that throw them. Their velocities, gravity and drag are gathered
+	// into arrays so position and velocity integration run k_lanes bodies
+	// per instruction. Each body's sweep against the map only reads the
+	// step's starting state, those are traced in parallel, then bodies
+	// resolve against each other one at a time in entity order. The results
+	// are the same whatever the number of threads. Slide hulls keep stepping
+	// in their own HullComponent::Update.
+	struct PhysicsWorld : NonCopyable
+	{
+		// Steps the bounce hulls of entities, in their order
+		auto Step(struct World& world,
+				  std::span<const std::shared_ptr<struct Entity>> entities,
+				  oxyF32 deltaTimeSeconds) -> void;
+
+		// Bodies the last Step moved
+		auto GetBodyCount() const -> oxySize
+		{
+			return m_bodyCount;
+		}
+
+		static inline constexpr auto k_lanes = oxySize{4};
+		static inline constexpr auto k_bodiesPerSweepJob = oxySize{64};
+
+	  private:
+		struct Body
+		{
+			// Held so a body destroyed by another's collision callback stays
+			// valid until the step is over
+			std::shared_ptr<struct Entity> m_entity;
+			struct HullComponent* m_hull{};
+		};
+
+		auto Gather(
+			std::span<const std::shared_ptr<struct Entity>> entities) -> void;
+		// m_end = m_position + m_velocity * dt
+		auto IntegratePositions(oxyF32 deltaTimeSeconds) -> void;
+		// Gravity on z, drag on x and y
+		auto IntegrateVelocities(oxyF32 deltaTimeSeconds) -> void;
+		// Copies the integrated velocities back onto the hull components
+		auto StoreVelocities() -> void;
+		// Traces every body from m_position to m_end against the map
+		auto Sweep(const struct World& world) -> void;
+
+		std::vector<Body> m_bodies;
+		oxySize m_bodyCount{};
+		// One entry per body, padded with zeroes to a multiple of k_lanes
+		std::vector<oxyF32> m_positionX, m_positionY, m_positionZ;
+		std::vector<oxyF32> m_velocityX, m_velocityY, m_velocityZ;
+		std::vector<oxyF32> m_endX, m_endY, m_endZ;
+		std::vector<oxyF32> m_gravity, m_drag;
+		// Where and on what plane each body's sweep hit the map, if it did
+		std::vector<oxyU8> m_sweepHit;
+		std::vector<oxyVec3> m_sweepPosition, m_sweepNormal;
+		// Grain of the parallel sweep, a step traces on one thread if it has
+		// no more bodies than this
+		oxySize m_bodiesPerSweepJob{k_bodiesPerSweepJob};
+
+		friend auto BenchmarkPhysics(std::string_view name,
+									 oxyU32 bodyCount) -> void;
+		friend auto CheckPhysicsDeterminism(std::string_view name,
+											oxyU32 bodyCount,
+											oxyBool jobPerBody) -> void;
+	};
+
+	// Steps a quarter, half and all of bodyCount bounce hulls scattered over
+	// the map's open space and logs the cost per body, plus gathering,
+	// integrating and storing back the batched state against the per-body
+	// math it replaced
+	auto BenchmarkPhysics(std::string_view name, oxyU32 bodyCount) -> void;
+	// Steps the same bodyCount bounce hulls on the map once with every sweep
+	// on one thread and once spread over all workers as a game step spreads
+	// them, and logs any body whose final position or velocity differs in a
+	// single bit. jobPerBody adds a run with each sweep a job of its own.
+	auto CheckPhysicsDeterminism(std::string_view name, oxyU32 bodyCount,
+								 oxyBool jobPerBody) -> void;
+}; // namespace oxygen
@@ -4,7 +4,7 @@
 #include "Entity/Entity.h"
 #include "Component/HullComponent/HullComponent.h"
 #include "Component/CameraComponent/CameraComponent.h"
-// #include "Component/Pawn/Pawn.h"
+#include "Component/Pawn/Pawn.h"
 // #include "Component/AnimatedMeshComponent/AnimatedMeshComponent.h"
 // #include "Component/StaticMeshComponent/StaticMeshComponent.h"
 // #include "Component/ProjectileComponent/ProjectileComponent.h"
@@ -16,73 +16,331 @@
 
 namespace oxygen
 {
-	auto World::SubmitBSPFacesToRenderQueue() -> void
+	auto World::CaptureRenderSnapshot(GfxRenderSnapshot& snapshot) -> void
 	{
 		auto lp = m_localPlayer.lock();
 		if (!lp)
 			return;
+		const auto camera = lp->GetComponent<CameraComponent>();
+		if (!camera)
+			return;
 
-		if (!m_bspFaces.size())
-			ComputeTriFaces();
+		snapshot.m_world = GetHardRef<World>();
+		snapshot.m_hasCamera = true;
+		snapshot.m_viewProjectionMatrix = camera->GetViewProjectionMatrix();
+		snapshot.m_cameraPosition =
+			lp->GetWorldPosition() + camera->GetCameraLocalOffset();
+		snapshot.m_inputSampleTime =
+			InputManager::GetInstance().GetLastUpdateTime();
 
-		m_nodesMarkedForRender.reset();
-		m_facesMarkedForRender.reset();
-		for (auto i = 0; i < m_bspData->m_models.size(); ++i)
+		const auto pawn = lp->GetComponent<Pawn>();
+		if (GfxRenderer::GetInstance().GetLateLatchEnabled() && pawn &&
+			pawn->CanLateLatchLook())
 		{
-			const auto& model = m_bspData->m_models[i];
-			const auto modelOrigin = oxyVec3{
-				model.m_origin[0], model.m_origin[1], model.m_origin[2]};
-			const auto camleaf =
-				FindLeaf(m_renderCameraPosition - modelOrigin, i);
-			if (!camleaf)
-				continue;
-			MarkPVSNodesFromLeaf(camleaf, i);
-			RenderTraverseBSPNode(model.m_headNodes[0], modelOrigin);
+			snapshot.m_lateLatch = true;
+			snapshot.m_lateLatchEuler = camera->GetEuler();
+			snapshot.m_lateLatchMouseReference =
+				InputManager::GetInstance().GetMousePosition();
+			snapshot.m_lateLatchInputSerial =
+				InputManager::GetInstance().GetUpdateSerial();
+			snapshot.m_projectionMatrix = camera->GetProjectionMatrix();
 		}
 
+		// Meshes are captured as is, the render thread culls them against
+		// its PVS through the leaves their entity is linked into
 		for (auto& ent : m_entities)
 		{
 			if (ent->GetFlag(EntityFlags_Disabled))
 				continue;
 			if (!ent->GetFlag(EntityFlags_Renderable))
 				continue;
+			const auto firstMesh = snapshot.m_meshes.size();
+			ent->Render();
 
-			// ent->Render();
-			const auto pos = ent->GetWorldPosition();
-			const auto mins = pos + ent->GetRenderOcclusionMin();
-			const auto maxs = pos + ent->GetRenderOcclusionMax();
-			if (TestBoundsIntersectVisibleNodes(mins, maxs))
+			// Without render bounds the links say little about the mesh
+			const auto& occlusionMin = ent->GetRenderOcclusionMin();
+			const auto& occlusionMax = ent->GetRenderOcclusionMax();
+			if (!ent->m_linked || !(occlusionMin.x < occlusionMax.x &&
+									occlusionMin.y < occlusionMax.y &&
+									occlusionMin.z < occlusionMax.z))
+				continue;
+			const auto firstLeaf =
+				static_cast<oxyU32>(snapshot.m_meshLeaves.size());
+			snapshot.m_meshLeaves.insert(snapshot.m_meshLeaves.end(),
+										 ent->m_linkedLeaves.begin(),
+										 ent->m_linkedLeaves.end());
+			for (auto i = firstMesh; i < snapshot.m_meshes.size(); ++i)
 			{
-				ent->Render();
+				snapshot.m_meshes[i].m_firstLeaf = firstLeaf;
+				snapshot.m_meshes[i].m_leafCount =
+					static_cast<oxyU32>(ent->m_linkedLeaves.size());
 			}
 		}
 	}
-	auto World::Update(float deltaTimeSeconds) -> void
+
+	auto World::SubmitBSPFacesToRenderQueue(const GfxRenderSnapshot& snapshot)
+		-> void
 	{
-		// Deliberately not using range-based for loop here incase entities
-		// are added/removed during the loop
-		for (oxySize i = 0; i < m_entities.size(); ++i)
+		if (!snapshot.m_hasCamera)
+			return;
+
+		m_renderCameraPosition = snapshot.m_cameraPosition;
+		LateLatchCamera(snapshot);
+
+		if (m_facesMarkedForRender.Size() != m_bspData->m_faces.size())
+			m_facesMarkedForRender.Resize(m_bspData->m_faces.size());
+		else
+			m_facesMarkedForRender.Reset();
+		if (m_nodesMarkedForRender.Size() != m_bspData->m_nodes.size())
+			m_nodesMarkedForRender.Resize(m_bspData->m_nodes.size());
+		if (m_bspData->m_models.size())
 		{
-			const auto& ent = m_entities[i];
-			if (ent->GetFlag(EntityFlags_Disabled))
+			// The world's PVS stays the camera PVS for everything after it
+			const auto& model = m_bspData->m_models[0];
+			const auto modelOrigin = oxyVec3{
+				model.m_origin[0], model.m_origin[1], model.m_origin[2]};
+			const auto camleaf = FindLeaf(m_renderCameraPosition - modelOrigin, 0);
+			if (camleaf)
+			{
+				MarkPVSNodesFromLeaf(camleaf);
+				RenderTraverseBSPNode(model.m_headNodes[0], modelOrigin);
+			}
+		}
+		m_brushModelCache.resize(m_bspData->m_models.size());
+		for (oxySize i = 1; i < m_bspData->m_models.size(); ++i)
+			SubmitBrushModel(i);
+
+		auto& gfx = GfxRenderer::GetInstance();
+		for (const auto& mesh : snapshot.m_meshes)
+		{
+			const auto visible =
+				mesh.m_leafCount
+					? gfx.IsSphereInFrustum(mesh.m_sphereCenter,
+											mesh.m_sphereRadius) &&
+						  IsAnyLeafInCameraPVS(
+							  std::span{snapshot.m_meshLeaves}.subspan(
+								  mesh.m_firstLeaf, mesh.m_leafCount))
+					: IsSphereVisible(mesh.m_sphereCenter, mesh.m_sphereRadius);
+			gfx.AddMeshCullStat(visible);
+			if (mesh.m_culledFeedback)
+				mesh.m_culledFeedback->store(!visible,
+											 std::memory_order_relaxed);
+			if (visible)
+				gfx.SubmitMeshInstance(mesh);
+		}
+	}
+	auto World::LateLatchCamera(const GfxRenderSnapshot& snapshot) -> void
+	{
+		// Only the orientation is re-latched, the position (and so the camera
+		// leaf and PVS) stays as simulated
+		if (!snapshot.m_lateLatch)
+			return;
+		const auto mouseDelta =
+			InputManager::PeekMouseDelta(snapshot.m_lateLatchMouseReference);
+		// The simulation already consumed (and may have recentred) the mouse
+		// for a newer frame, the reference no longer applies
+		if (InputManager::GetInstance().GetUpdateSerial() !=
+			snapshot.m_lateLatchInputSerial)
+			return;
+		const auto euler =
+			Pawn::ApplyMouseLook(snapshot.m_lateLatchEuler, mouseDelta);
+		auto& gfx = GfxRenderer::GetInstance();
+		gfx.SetViewProjectionMatrix(CameraComponent::BuildViewProjectionMatrix(
+			snapshot.m_cameraPosition, euler, snapshot.m_projectionMatrix));
+		gfx.SetViewInputSampleTime(std::chrono::steady_clock::now());
+	}
+
+	auto World::SubmitBrushModel(oxySize modelIndex) -> void
+	{
+		const auto& model = m_bspData->m_models[modelIndex];
+		const auto modelOrigin =
+			oxyVec3{model.m_origin[0], model.m_origin[1], model.m_origin[2]};
+		const auto mins =
+			oxyVec3{model.m_mins[0], model.m_mins[1], model.m_mins[2]} +
+			modelOrigin;
+		const auto maxs =
+			oxyVec3{model.m_maxs[0], model.m_maxs[1], model.m_maxs[2]} +
+			modelOrigin;
+
+		if (!GfxRenderer::GetInstance().IsBoxInFrustum(mins, maxs))
+			return;
+
+		auto& cache = m_brushModelCache[modelIndex];
+		if (!cache.m_valid || cache.m_origin.x != modelOrigin.x ||
+			cache.m_origin.y != modelOrigin.y ||
+			cache.m_origin.z != modelOrigin.z)
+		{
+			cache.m_valid = true;
+			cache.m_origin = modelOrigin;
+			cache.m_leaves.clear();
+			CollectLeavesInBounds(m_bspData->m_models[0].m_headNodes[0], mins,
+								  maxs, cache.m_leaves);
+			if (cache.m_nodes.empty())
+			{
+				const auto CollectNodes = [&](auto&& self,
+											  oxyS32 nodeIndex) -> void {
+					if (nodeIndex < 0)
+						return;
+					cache.m_nodes.push_back(nodeIndex);
+					self(self, m_packedNodes[nodeIndex].m_children[0]);
+					self(self, m_packedNodes[nodeIndex].m_children[1]);
+				};
+				CollectNodes(CollectNodes, model.m_headNodes[0]);
+			}
+		}
+
+		// Visible if any world leaf it touches is in the camera PVS
+		if (!IsAnyLeafInCameraPVS(cache.m_leaves))
+			return;
+
+		// Brush models have no PVS of their own
+		for (const auto nodeIndex : cache.m_nodes)
+			m_nodesMarkedForRender.Set(nodeIndex);
+		RenderTraverseBSPNode(model.m_headNodes[0], modelOrigin);
+	}
+
+	auto World::CollectLeavesInBounds(oxyS32 nodeIndex, const oxyVec3& mins,
+									  const oxyVec3& maxs,
+									  std::vector<oxyS32>& leaves) const
+		-> void
+	{
+		while (nodeIndex >= 0)
+		{
+			const auto& node = m_packedNodes[nodeIndex];
+			const auto& normal = node.m_normal;
+			// nearest and furthest corners along the normal
+			const auto nearCorner =
+				oxyVec3{normal.x >= 0.f ? mins.x : maxs.x,
+						normal.y >= 0.f ? mins.y : maxs.y,
+						normal.z >= 0.f ? mins.z : maxs.z};
+			const auto farCorner =
+				oxyVec3{normal.x >= 0.f ? maxs.x : mins.x,
+						normal.y >= 0.f ? maxs.y : mins.y,
+						normal.z >= 0.f ? maxs.z : mins.z};
+			const auto front = node.Distance(farCorner) >= 0.f;
+			const auto back = node.Distance(nearCorner) < 0.f;
+			if (front && back)
+			{
+				CollectLeavesInBounds(node.m_children[0], mins, maxs, leaves);
+				nodeIndex = node.m_children[1];
+			}
+			else
+			{
+				nodeIndex = node.m_children[front ? 0 : 1];
+			}
+		}
+		leaves.push_back(-nodeIndex - 1);
+	}
+
+	auto World::IsAnyLeafInCameraPVS(std::span<const oxyS32> leaves) const
+		-> oxyBool
+	{
+		const auto pvsLeaves = m_cameraPVS.size() * 8;
+		return pvsLeaves == 0 ||
+			   std::any_of(leaves.begin(), leaves.end(), [&](oxyS32 leafIdx) {
+				   if (leafIdx == 0 ||
+					   static_cast<oxySize>(leafIdx - 1) >= pvsLeaves)
+					   return false;
+				   return (m_cameraPVS[(leafIdx - 1) >> 3] &
+						   (1 << ((leafIdx - 1) & 7))) != 0;
+			   });
+	}
+
+	auto World::LinkEntity(Entity& ent) -> void
+	{
+		if (m_bspData->m_models.empty())
+			return;
+		auto mins = ent.GetRenderOcclusionMin();
+		auto maxs = ent.GetRenderOcclusionMax();
+		if (ent.GetFlag(EntityFlags_HasHull))
+		{
+			const auto hullcomp = ent.FindComponent<HullComponent>();
+			if (hullcomp && hullcomp->GetHull() != CollisionHull_None)
+			{
+				const auto hull = static_cast<int>(hullcomp->GetHull());
+				const auto& hullMins = k_collisionHullMins[hull];
+				const auto& hullMaxs = k_collisionHullMaxs[hull];
+				mins = {(std::min)(mins.x, hullMins.x),
+						(std::min)(mins.y, hullMins.y),
+						(std::min)(mins.z, hullMins.z)};
+				maxs = {(std::max)(maxs.x, hullMaxs.x),
+						(std::max)(maxs.y, hullMaxs.y),
+						(std::max)(maxs.z, hullMaxs.z)};
+			}
+		}
+		const auto position = ent.GetWorldPosition();
+		mins += position;
+		maxs += position;
+		if (ent.m_linked && mins.x == ent.m_linkedMins.x &&
+			mins.y == ent.m_linkedMins.y && mins.z == ent.m_linkedMins.z &&
+			maxs.x == ent.m_linkedMaxs.x && maxs.y == ent.m_linkedMaxs.y &&
+			maxs.z == ent.m_linkedMaxs.z)
+			return;
+
+		UnlinkEntity(ent);
+		m_leafEntities.resize(m_bspData->m_leaves.size());
+		CollectLeavesInBounds(m_bspData->m_models[0].m_headNodes[0], mins, maxs,
+							  ent.m_linkedLeaves);
+		std::erase(ent.m_linkedLeaves, 0);
+		for (const auto leafIdx : ent.m_linkedLeaves)
+			m_leafEntities[leafIdx].push_back(&ent);
+		ent.m_linkedMins = mins;
+		ent.m_linkedMaxs = maxs;
+		ent.m_linked = true;
+	}
+
+	auto World::UnlinkEntity(Entity& ent) -> void
+	{
+		for (const auto leafIdx : ent.m_linkedLeaves)
+		{
+			auto& leafEntities = m_leafEntities[leafIdx];
+			const auto it =
+				std::find(leafEntities.begin(), leafEntities.end(), &ent);
+			if (it == leafEntities.end())
 				continue;
-			ent->Update(deltaTimeSeconds);
+			*it = leafEntities.back();
+			leafEntities.pop_back();
 		}
+		ent.m_linkedLeaves.clear();
+		ent.m_linked = false;
+	}
 
-		auto lp = m_localPlayer.lock();
-		if (lp)
+	auto World::QueryEntitiesInBounds(
+		const oxyVec3& mins, const oxyVec3& maxs,
+		std::vector<std::shared_ptr<Entity>>& entities) const -> void
+	{
+		entities.clear();
+		if (m_bspData->m_models.empty())
+			return;
+		m_queryLeaves.clear();
+		CollectLeavesInBounds(m_bspData->m_models[0].m_headNodes[0], mins, maxs,
+							  m_queryLeaves);
+
+		// An entity spanning several leaves is only reported once
+		const auto stamp = ++m_linkQueryStamp;
+		for (const auto leafIdx : m_queryLeaves)
 		{
-			const auto camera = lp->GetComponent<CameraComponent>();
-			if (camera)
+			if (static_cast<oxySize>(leafIdx) >= m_leafEntities.size())
+				continue;
+			for (const auto ent : m_leafEntities[leafIdx])
 			{
-				m_renderCameraPosition =
-					lp->GetWorldPosition() + camera->GetCameraLocalOffset();
-				GfxRenderer::GetInstance().SetViewProjectionMatrix(
-					camera->GetViewProjectionMatrix());
+				if (ent->m_linkQueryStamp == stamp)
+					continue;
+				ent->m_linkQueryStamp = stamp;
+				entities.push_back(ent->GetHardRef<Entity>());
 			}
 		}
 	}
 
+	auto World::Update(float deltaTimeSeconds) -> void
+	{
+		m_componentScheduler.Update(*this, deltaTimeSeconds);
+		// Catches children carried by their parents and anything moved
+		// outside of its own update
+		for (const auto& ent : m_entities)
+			LinkEntity(*ent);
+	}
+
 #if 0
 	auto World::SummonPlayer(const EntitySummonParams& params)
 		-> std::shared_ptr<Entity>
@@ -106,6 +364,7 @@ namespace oxygen
 		hull->SetHull(CollisionHull_Player);
 		hull->SetGravityPerSecond(700.f);
 		hull->SetResponse(CollisionResponseType_Slide);
+		hull->SetStepHeight(18.f);
 
 		auto camera = ent->AddComponent<CameraComponent>();
 		camera->SetLocalOffset(oxyVec3{0.f, 0.f, 32.f});
@@ -162,45 +421,36 @@ namespace oxygen
 
 	auto World::CreateEntitiesFromBSP() -> void
 	{
-		const auto ParseVec3 = [](const std::string& s) -> oxyVec3 {
-			oxyVec3 v{};
-			sscanf_s(s.c_str(), "%f %f %f", &v.x, &v.y, &v.z);
-			return v;
-		};
-
-		for (const auto& ent : m_bspData->m_entitiesText)
+		const auto& cooked = *m_cookedData;
+		for (const auto& ent : cooked.m_entities)
 		{
-			auto classname = ent.find("classname");
-			if (classname == ent.end())
+			const auto classname = cooked.FindValue(ent, "classname");
+			if (!classname)
 				continue;
-			if (classname->second == "env_push")
+			if (*classname == "env_push")
 			{
-				auto origin = ent.find("origin");
-				if (origin == ent.end())
+				const auto origin = cooked.FindVec3(ent, "origin");
+				if (!origin)
 					continue;
-				auto vel = ent.find("vel");
-				if (vel == ent.end())
+				const auto velocity = cooked.FindVec3(ent, "vel");
+				if (!velocity)
 					continue;
-				auto radius = ent.find("radius");
-				if (radius == ent.end())
+				const auto radius = cooked.FindFloat(ent, "radius");
+				if (!radius)
 					continue;
 
-				const oxyVec3 pos = ParseVec3(origin->second);
-				const oxyVec3 velocity = ParseVec3(vel->second);
-				const oxyF32 rad = std::stof(radius->second);
-
 				auto ent = SpawnEntity();
-				ent->SetWorldPosition(pos);
+				ent->SetWorldPosition(*origin);
 				auto envpush = ent->AddComponent<EnvPushComponent>();
-				envpush->SetVelocity(velocity);
-				envpush->SetRadius(rad);
+				envpush->SetVelocity(*velocity);
+				envpush->SetRadius(*radius);
 			}
-			else if (classname->second == "info_player_start")
+			else if (*classname == "info_player_start")
 			{
-				auto origin = ent.find("origin");
-				if (origin == ent.end())
+				const auto origin = cooked.FindVec3(ent, "origin");
+				if (!origin)
 					continue;
-				m_playerStarts.push_back(ParseVec3(origin->second));
+				m_playerStarts.push_back(*origin);
 			}
 		}
 	}
@@ -246,6 +496,16 @@ namespace oxygen
 		return false;
 	}
 
+	auto World::IsSphereVisible(const oxyVec3& center,
+								oxyF32 radius) const -> oxyBool
+	{
+		if (!GfxRenderer::GetInstance().IsSphereInFrustum(center, radius))
+			return false;
+		const auto extent = oxyVec3{radius, radius, radius};
+		return TestBoundsIntersectVisibleNodes(center - extent,
+											   center + extent);
+	}
+
 	auto World::RenderTraverseBSPNode(oxyS32 nodeIndex,
 									  const oxyVec3& origin) -> void
 	{
@@ -254,7 +514,10 @@ namespace oxygen
 			// Leaf
 			const auto leafIdx = -nodeIndex - 1;
 
-			if (leafIdx > 0)
+			// Brush model leaves sit past the world's PVS and are never
+			// tested here
+			if (leafIdx > 0 &&
+				static_cast<oxySize>(leafIdx - 1) < m_cameraPVS.size() * 8)
 			{
 				const auto pvsIndex = (leafIdx -1) >> 3;
 				const auto maskValue = 1 << ((leafIdx-1) & 7);
@@ -269,18 +532,10 @@ namespace oxygen
 
 			return;
 		}
-		if (!m_nodesMarkedForRender.test(nodeIndex))
+		if (!m_nodesMarkedForRender.Test(nodeIndex))
 			return;
-		const auto& node = m_bspData->m_nodes[nodeIndex];
-		const auto& plane = m_bspData->m_planes[node.m_planeIndex];
-		const auto& planeNormal = plane.m_normal;
-		const auto& planeDist = plane.m_dist;
-
-		const auto dist =
-			oxyVec3{planeNormal[0], planeNormal[1], planeNormal[2]}.DotProduct(
-				m_renderCameraPosition) -
-			planeDist;
-		const auto side = dist >= 0.f ? 1 : 0;
+		const auto& node = m_packedNodes[nodeIndex];
+		const auto side = node.Distance(m_renderCameraPosition) >= 0.f ? 1 : 0;
 
 		RenderTraverseBSPNode(node.m_children[side], origin);
 		RenderTraverseBSPNode(node.m_children[1 - side], origin);
@@ -293,9 +548,9 @@ namespace oxygen
 		{
 			const auto faceIdx =
 				m_bspData->m_marksurfaces[leaf.m_firstMarkSurfaceIndex + i];
-			if (!m_facesMarkedForRender.test(faceIdx))
+			if (!m_facesMarkedForRender.Test(faceIdx))
 			{
-				m_facesMarkedForRender.set(faceIdx);
+				m_facesMarkedForRender.Set(faceIdx);
 				RenderBSPFace(GfxRenderer::GetInstance(), faceIdx, origin);
 			}
 		}
@@ -304,246 +559,107 @@ namespace oxygen
 	auto World::RenderBSPFace(GfxRenderer& gfx, oxySize faceindex,
 							  const oxyVec3& origin) -> void
 	{
-		const auto& tris = m_bspFaces[faceindex];
+		const auto& range = m_cookedData->m_facePolys[faceindex];
+		const auto polys =
+			m_cookedData->m_polys.subspan(range.m_firstPoly, range.m_polyCount);
 		const auto& bspface = m_bspData->m_faces[faceindex];
-		for (const auto& tri : tris)
-		{
-			if (m_lightmapTexture && bspface.m_lightMapOffset != -1 &&
-				bspface.m_lightStyles[0] != 255 &&
-				m_lightmapRects.size() > faceindex)
-			{ 
-				oxyVec4 v0 =
-					oxyVec4{tri.m_vertices[0], 1.f} + oxyVec4{origin, 0.0f};
-				oxyVec4 v1 =
-					oxyVec4{tri.m_vertices[1], 1.f} + oxyVec4{origin, 0.0f};
-				oxyVec4 v2 =
-					oxyVec4{tri.m_vertices[2], 1.f} + oxyVec4{origin, 0.0f};
-				GfxTri triclip;
-				triclip.m_vertices[0].m_position = v0;
-				triclip.m_vertices[1].m_position = v1;
-				triclip.m_vertices[2].m_position = v2;
-				triclip.m_vertices[0].m_uv = tri.m_texcoords[0];
-				triclip.m_vertices[1].m_uv = tri.m_texcoords[1];
-				triclip.m_vertices[2].m_uv = tri.m_texcoords[2];
-				triclip.m_colour = {1.f, 1.f, 1.f};
-				triclip.m_texture = m_bspTextures[tri.m_textureIndex].get();
-				triclip.m_cullType = GfxCullType_Backface;
-				for (auto& vert : triclip.m_vertices)
-				{
-					vert.m_position =
-						vert.m_position * gfx.GetViewProjectionMatrix();
-				}
-				gfx.SubmitTriToQueue(
-					triclip, GfxRenderStrategy_SoftwareDepthRasterizePreSorted);
-
-				triclip.m_vertices[0].m_uv = tri.m_lmtexcoords[0];
-				triclip.m_vertices[1].m_uv = tri.m_lmtexcoords[1];
-				triclip.m_vertices[2].m_uv = tri.m_lmtexcoords[2];
-				triclip.m_texture = m_lightmapTexture.get();
-				gfx.SubmitTriToQueue(
-					triclip, GfxRenderStrategy_SoftwareDepthRasterizePreSortedOverlay);
-			}
-			else if (!m_lightmapTexture || bspface.m_lightMapOffset == -1)
-			{
-				oxyVec4 v0 =
-					oxyVec4{tri.m_vertices[0], 1.f} + oxyVec4{origin, 0.0f};
-				oxyVec4 v1 =
-					oxyVec4{tri.m_vertices[1], 1.f} + oxyVec4{origin, 0.0f};
-				oxyVec4 v2 =
-					oxyVec4{tri.m_vertices[2], 1.f} + oxyVec4{origin, 0.0f};
-				GfxTri triclip;
-				triclip.m_vertices[0].m_position = v0;
-				triclip.m_vertices[1].m_position = v1;
-				triclip.m_vertices[2].m_position = v2;
-				triclip.m_vertices[0].m_uv = tri.m_texcoords[0];
-				triclip.m_vertices[1].m_uv = tri.m_texcoords[1];
-				triclip.m_vertices[2].m_uv = tri.m_texcoords[2];
-				triclip.m_colour = {1.f, 1.f, 1.f};
-				triclip.m_texture = m_bspTextures[tri.m_textureIndex].get();
-				for (auto& vert : triclip.m_vertices)
-				{
-					vert.m_position =
-						vert.m_position * gfx.GetViewProjectionMatrix();
-				}
-				gfx.SubmitTriToQueue(
-					triclip, GfxRenderStrategy_SoftwareDepthRasterizePreSorted);
-			}
-		}
-	}
-	auto World::ComputeTriFaces() -> void
-	{
-		m_bspFaces.resize(m_bspData->m_faces.size());
-		for (oxySize faceindex = 0; faceindex < m_bspData->m_faces.size();
-			 ++faceindex)
-		{
-			const auto& face = m_bspData->m_faces[faceindex];
-			static constexpr auto k_maxFaceVertices = 128;
-			oxyVec3 faceVerts[k_maxFaceVertices];
-			oxyVec2 faceUVs[k_maxFaceVertices];
-			oxySize numVerts{};
-
-			const auto& surfedges = m_bspData->m_surfedges;
-			const auto& edges = m_bspData->m_edges;
-			const auto& vertices = m_bspData->m_vertices;
-
-			const auto& texinfo = m_bspData->m_texinfo[face.m_texInfoIndex];
-			const auto& miptex = m_bspData->m_miptex[texinfo.m_mipTexIndex];
-			const auto& texvecs = texinfo.m_vecs[0];
-			const auto& texvect = texinfo.m_vecs[1];
-
-			const auto invWidth = 1.f / miptex.m_width;
-			const auto invHeight = 1.f / miptex.m_height;
-
-			const auto texidx = texinfo.m_mipTexIndex;
-
-			const auto firstEdgeIdx = face.m_firstEdgeIndex;
-			const auto edgeCount = face.m_edgeCount;
-
-			oxyVec2 minuv{(std::numeric_limits<float>::max)(),
-						  (std::numeric_limits<float>::max)()};
-			oxyVec2 maxuv{(std::numeric_limits<float>::min)(),
-						  (std::numeric_limits<float>::min)()};
-			for (auto j = firstEdgeIdx;
-				 j < firstEdgeIdx + edgeCount && numVerts < k_maxFaceVertices;
-				 ++j)
-			{
-				const auto surfedge = surfedges[j];
-				const auto& edge = edges[std::abs(surfedge)];
-				const auto& v0 = vertices[edge.m_vertexIndices[0]].m_position;
-				const auto& v1 = vertices[edge.m_vertexIndices[1]].m_position;
-
-				const auto cvert = surfedge < 0 ? v1 : v0;
-				const auto u = (texvecs[0] * cvert[0] + texvecs[1] * cvert[1] +
-								texvecs[2] * cvert[2]) +
-							   texvecs[3];
-				const auto v = (texvect[0] * cvert[0] + texvect[1] * cvert[1] +
-								texvect[2] * cvert[2]) +
-							   texvect[3];
-
-				faceVerts[numVerts] = oxyVec3{cvert[0], cvert[1], cvert[2]};
-				faceUVs[numVerts] = {u, v};
-				++numVerts;
-				minuv.x = (std::min)(minuv.x, u);
-				minuv.y = (std::min)(minuv.y, v);
-				maxuv.x = (std::max)(maxuv.x, u);
-				maxuv.y = (std::max)(maxuv.y, v);
-			}
-
-			auto& outtris = m_bspFaces[faceindex];
-			for (auto i = 0; i < numVerts - 1; i++)
-			{
-				const auto& vtx0 = faceVerts[0];
-				const auto& vtx1 = faceVerts[i];
-				const auto& vtx2 = faceVerts[i + 1];
-
-				const auto rect = m_lightmapRects[faceindex];
-				const auto sampleSize = m_lightmapSampleSize;
-				const auto blockWidth = m_lightmapBlockWidth;
-				const auto blockHeight = m_lightmapBlockHeight;
-
-				const auto CalcLightmapUV =
-					[&](const oxyVec2& texuv) -> oxyVec2 {
-					// interpolate texuv into minuv and maxuv
-
-					const auto ttexu =
-						(texuv.x - minuv.x) / (maxuv.x - minuv.x);
-					const auto ttexv =
-						(texuv.y - minuv.y) / (maxuv.y - minuv.y);
-					// then interpolate into rect
-					const auto lminx = rect[0] + 1;
-					const auto lminy = rect[1] + 1;
-					const auto lmaxx = rect[0] + rect[2] - 1;
-					const auto lmaxy = rect[1] + rect[3] - 1;
-					const auto lmu = lminx + ttexu * (lmaxx - lminx);
-					const auto lmv = lminy + ttexv * (lmaxy - lminy);
-					return {lmu / m_lightmapTexture->m_width,
-							lmv / m_lightmapTexture->m_height};
-				};
+		const auto lightmapped = m_lightmapTexture &&
+								 bspface.m_lightMapOffset != -1 &&
+								 bspface.m_lightStyles[0] != 255 &&
+								 m_cookedData->m_lightmapRects.size() > faceindex;
+		if (!lightmapped && m_lightmapTexture && bspface.m_lightMapOffset != -1)
+			return;
+		const auto lightmapTexelSize =
+			lightmapped ? oxyVec2{1.f / m_lightmapTexture->m_width,
+								  1.f / m_lightmapTexture->m_height}
+						: oxyVec2{};
+		for (const auto& poly : polys)
+		{
+			GfxQuad quad{};
+			quad.m_vertexCount = poly.m_vertexCount;
+			for (oxyU32 v = 0; v < poly.m_vertexCount; ++v)
+			{
+				quad.m_vertices[v].m_position =
+					(oxyVec4{poly.m_vertices[v], 1.f} + oxyVec4{origin, 0.0f}) *
+					gfx.GetViewProjectionMatrix();
+				quad.m_vertices[v].m_uv = poly.m_texcoords[v];
+			}
+			quad.m_colour = {1.f, 1.f, 1.f};
+			quad.m_texture = m_bspTextures[poly.m_textureIndex].get();
+			if (lightmapped)
+			{
+				quad.m_cullType = GfxCullType_Backface;
+				gfx.SubmitQuadToQueue(
+					quad, GfxRenderStrategy_SoftwareDepthRasterizePreSorted);
 
-				WorldTri tri;
-				tri.m_vertices[0] = vtx0;
-				tri.m_vertices[1] = vtx1;
-				tri.m_vertices[2] = vtx2;
-				tri.m_texcoords[0] = faceUVs[0] * oxyVec2{invWidth, invHeight};
-				tri.m_texcoords[1] = faceUVs[i] * oxyVec2{invWidth, invHeight};
-				tri.m_texcoords[2] =
-					faceUVs[i + 1] * oxyVec2{invWidth, invHeight};
-				if (m_lightmapTexture && face.m_lightMapOffset != -1 &&
-					face.m_lightStyles[0] != 255 &&
-					m_lightmapRects.size() > faceindex)
-				{
-					tri.m_lmtexcoords[0] = CalcLightmapUV(faceUVs[0]);
-					tri.m_lmtexcoords[1] = CalcLightmapUV(faceUVs[i]);
-					tri.m_lmtexcoords[2] = CalcLightmapUV(faceUVs[i + 1]);
-				}
-				tri.m_textureIndex = texidx;
-				outtris.push_back(tri);
+				for (oxyU32 v = 0; v < poly.m_vertexCount; ++v)
+					quad.m_vertices[v].m_uv =
+						poly.m_lmtexcoords[v] * lightmapTexelSize;
+				quad.m_texture = m_lightmapTexture.get();
+				gfx.SubmitQuadToQueue(
+					quad,
+					GfxRenderStrategy_SoftwareDepthRasterizePreSortedOverlay);
+			}
+			else
+			{
+				gfx.SubmitQuadToQueue(
+					quad, GfxRenderStrategy_SoftwareDepthRasterizePreSorted);
 			}
 		}
 	}
+	auto World::MarkPVSNodesFromLeaf(const BSPDefines::Leaf* leaf) -> void
+	{
+		const auto leafIndex =
+			static_cast<oxySize>(leaf - m_bspData->m_leaves.data());
+		if (m_markedPVSLeaf == leafIndex)
+			return;
+		m_cameraPVS = m_cookedData->GetPVSRow(leafIndex);
+		m_nodesMarkedForRender = GetPVSNodeSet(leafIndex);
+		m_markedPVSLeaf = leafIndex;
+	}
 
-	auto World::MarkPVSNodesFromLeaf(const BSPDefines::Leaf* leaf,
-									 oxySize modelIndex) -> void
+	auto World::GetPVSNodeSet(oxySize leafIndex) -> const DynamicBitset&
 	{
-		const auto& model = m_bspData->m_models[modelIndex];
-		const auto visclusters = model.m_visLeafs;
-		if (leaf->m_visOffset == -1)
+		const auto cached = std::find_if(
+			m_pvsNodeSets.begin(), m_pvsNodeSets.end(),
+			[&](const PVSNodeSet& set) { return set.m_leafIndex == leafIndex; });
+		if (cached != m_pvsNodeSets.end())
 		{
-			// mark all nodes in model if no PVS
-			const auto MarkNodesRecurse = [&](auto&& self, oxyS32 nodeIndex) {
-				if (nodeIndex < 0)
-					return;
-				m_nodesMarkedForRender.set(nodeIndex);
-				self(self, m_bspData->m_nodes[nodeIndex].m_children[0]);
-				self(self, m_bspData->m_nodes[nodeIndex].m_children[1]);
-			};
-			MarkNodesRecurse(MarkNodesRecurse, model.m_headNodes[0]);
-		}
-		const auto visbytes = (visclusters + 7) >> 3;
-		const auto DecompressVis = [&](const oxyU8* in,
-									   std::span<oxyU8> out) -> void {
-			auto dst = out.data();
-			while (dst < out.data() + out.size_bytes())
-			{
-				if (*in)
-				{
-					*dst++ = *in++;
-				}
-				else
-				{
-					auto c = in[1];
-					if (c > out.data() + out.size_bytes() - dst)
-						c = static_cast<oxyU8>(out.data() + out.size_bytes() -
-											   dst);
-					std::memset(dst, 0, c);
-					in += 2;
-					dst += c;
-				}
-			}
-		};
-		const auto visStart =
-			m_bspData->m_visibility.data() + leaf->m_visOffset;
-		m_cameraPVS.clear();
-		m_cameraPVS.resize(visbytes);
-		DecompressVis(visStart, {m_cameraPVS.data(), visbytes});
-		const auto& leaves = m_bspData->m_leaves;
-		for (oxyU32 i = 0; i < visbytes * 8; ++i)
+			std::rotate(m_pvsNodeSets.begin(), cached, cached + 1);
+			return m_pvsNodeSets.front().m_nodes;
+		}
+
+		// Evict the least recently used set and reuse its storage
+		if (m_pvsNodeSets.size() < k_maxCachedPVSNodeSets)
+			m_pvsNodeSets.emplace_back();
+		std::rotate(m_pvsNodeSets.begin(), m_pvsNodeSets.end() - 1,
+					m_pvsNodeSets.end());
+		auto& set = m_pvsNodeSets.front();
+		set.m_leafIndex = leafIndex;
+		auto& nodes = set.m_nodes;
+		nodes.Resize(m_bspData->m_nodes.size());
+
+		const auto row = m_cookedData->GetPVSRow(leafIndex);
+		const auto& leafParents = m_cookedData->m_leafParents;
+		const auto& nodeParents = m_cookedData->m_nodeParents;
+		for (oxyU32 i = 0; i < row.size() * 8 && i + 1 < leafParents.size();
+			 ++i)
 		{
 			const auto pvsIndex = i >> 3;
 			const auto maskValue = 1 << (i & 7);
-			if (m_cameraPVS[pvsIndex] & maskValue)
+			if (row[pvsIndex] & maskValue)
 			{
-				auto nodeIndex =
-					m_bspLeafParents[i + 1]; // +1 because 0 is void
+				auto nodeIndex = leafParents[i + 1]; // +1 because 0 is void
 				while (nodeIndex >= 0)
 				{
-					if (m_nodesMarkedForRender.test(nodeIndex))
+					if (nodes.Test(nodeIndex))
 						break;
-					m_nodesMarkedForRender.set(nodeIndex);
-					nodeIndex = m_bspNodeParents[nodeIndex];
+					nodes.Set(nodeIndex);
+					nodeIndex = nodeParents[nodeIndex];
 				}
 			}
 		}
+		return nodes;
 	}
 
 	auto
@@ -682,24 +798,289 @@ namespace oxygen
 	auto World::FindLeaf(const oxyVec3& position,
 						 oxySize modelIndex) const -> const BSPDefines::Leaf*
 	{
-		const auto& leaves = m_bspData->m_leaves;
-		const auto& nodes = m_bspData->m_nodes;
-		oxyS32 nodeIndex = m_bspData->m_models[modelIndex].m_headNodes[0];
+		const oxyS32 headNode = m_bspData->m_models[modelIndex].m_headNodes[0];
+		if (modelIndex != 0 || m_leafGrid.m_cells.empty())
+			return FindLeafFromNode(headNode, position);
+
+		// Outside the grid (or NaN) descends from the root
+		const auto& grid = m_leafGrid;
+		const auto local = position - grid.m_origin;
+		const oxyF32 cell[3] = {local.x * grid.m_inverseCellSize.x,
+								local.y * grid.m_inverseCellSize.y,
+								local.z * grid.m_inverseCellSize.z};
+		oxySize cellIndex = 0;
+		for (auto axis = 2; axis >= 0; --axis)
+		{
+			if (!(cell[axis] >= 0.f &&
+				  cell[axis] < static_cast<oxyF32>(grid.m_dims[axis])))
+				return FindLeafFromNode(headNode, position);
+			cellIndex = cellIndex * grid.m_dims[axis] +
+						static_cast<oxySize>(cell[axis]);
+		}
+		return FindLeafFromNode(grid.m_cells[cellIndex], position);
+	}
+	auto World::FindLeafFromNode(oxyS32 nodeIndex, const oxyVec3& position) const
+		-> const BSPDefines::Leaf*
+	{
 		while (nodeIndex >= 0)
 		{
-			const auto& node = nodes[nodeIndex];
-			const auto& plane = m_bspData->m_planes[node.m_planeIndex];
-			const auto& planeNormal = plane.m_normal;
-			const auto& planeDist = plane.m_dist;
+			const auto& node = m_packedNodes[nodeIndex];
+			nodeIndex = node.m_children[node.Distance(position) >= 0.f ? 0 : 1];
+		}
+		const auto leafIdx = -nodeIndex - 1;
+		return &m_bspData->m_leaves[leafIdx];
+	}
+	namespace
+	{
+		// Where along start to end a trace stopped at position
+		auto TraceFraction(const oxyVec3& start, const oxyVec3& end,
+						   const oxyVec3& position) -> oxyF32
+		{
+			const auto lengthSq = (end - start).MagnitudeSquared();
+			if (lengthSq <= 0.f)
+				return 0.f;
+			return std::sqrtf((position - start).MagnitudeSquared() / lengthSq);
+		}
+	}; // namespace
+
+	auto World::BuildLeafGrid() -> void
+	{
+		m_leafGrid = {};
+		if (m_bspData->m_models.empty())
+			return;
+		const auto& model = m_bspData->m_models[0];
 
-			const auto dist = planeNormal[0] * position.x +
-							  planeNormal[1] * position.y +
-							  planeNormal[2] * position.z - planeDist;
-			const auto side = dist >= 0.f ? 0 : 1;
+		// Cells are grown past the nominal size if the map is too big for it
+		const oxyVec3 mins{model.m_mins[0], model.m_mins[1], model.m_mins[2]};
+		auto cellSize = k_leafGridCellSize;
+		oxyS32 dims[3]{};
+		for (;;)
+		{
+			oxySize cellCount = 1;
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				dims[axis] = (std::max)(
+					1, static_cast<oxyS32>(std::ceil(
+						(model.m_maxs[axis] - model.m_mins[axis]) / cellSize)));
+				cellCount *= dims[axis];
+			}
+			if (cellCount <= k_leafGridMaxCells)
+				break;
+			cellSize *= 2.f;
+		}
+
+		auto& grid = m_leafGrid;
+		grid.m_origin = mins;
+		grid.m_inverseCellSize = {1.f / cellSize, 1.f / cellSize,
+								  1.f / cellSize};
+		std::copy(std::begin(dims), std::end(dims), std::begin(grid.m_dims));
+		grid.m_cells.resize(static_cast<oxySize>(dims[0]) * dims[1] * dims[2]);
+
+		// Descends while the whole cell is on one side of each split
+		const auto halfSize = cellSize * 0.5f;
+		oxySize cellIndex = 0;
+		for (oxyS32 z = 0; z < dims[2]; ++z)
+		{
+			for (oxyS32 y = 0; y < dims[1]; ++y)
+			{
+				for (oxyS32 x = 0; x < dims[0]; ++x)
+				{
+					const auto center =
+						mins + oxyVec3{(x + 0.5f) * cellSize,
+									   (y + 0.5f) * cellSize,
+									   (z + 0.5f) * cellSize};
+					oxyS32 nodeIndex = model.m_headNodes[0];
+					while (nodeIndex >= 0)
+					{
+						const auto& node = m_packedNodes[nodeIndex];
+						const auto dist = node.Distance(center);
+						const auto radius =
+							halfSize * (std::abs(node.m_normal.x) +
+										std::abs(node.m_normal.y) +
+										std::abs(node.m_normal.z)) +
+							k_leafGridEpsilon;
+						if (dist - radius >= 0.f)
+							nodeIndex = node.m_children[0];
+						else if (dist + radius < 0.f)
+							nodeIndex = node.m_children[1];
+						else
+							break;
+					}
+					grid.m_cells[cellIndex++] = nodeIndex;
+				}
+			}
+		}
+	}
+	auto World::BuildPackedNodes() -> void
+	{
+		const auto& planes = m_bspData->m_planes;
+		const auto& nodes = m_bspData->m_nodes;
+		const auto& clipNodes = m_bspData->m_clipNodes;
+		const auto& leaves = m_bspData->m_leaves;
+		// The plane type in the file is not trusted, an axial compare is only
+		// used where it gives exactly what the dot product does
+		const auto ToPackedNode = [&](oxyU32 planeIndex) -> PackedNode {
+			const auto& plane = planes[planeIndex];
+			auto type = PackedNode::k_nonAxial;
+			for (oxyU32 axis = 0; axis < 3; ++axis)
+			{
+				if (plane.m_normal[axis] == 1.f &&
+					plane.m_normal[(axis + 1) % 3] == 0.f &&
+					plane.m_normal[(axis + 2) % 3] == 0.f)
+					type = axis;
+			}
+			return {{plane.m_normal[0], plane.m_normal[1], plane.m_normal[2]},
+					plane.m_dist,
+					{},
+					type};
+		};
+
+		m_packedNodes.clear();
+		m_packedNodes.reserve(nodes.size() + clipNodes.size());
+		for (const auto& node : nodes)
+		{
+			auto& packedNode =
+				m_packedNodes.emplace_back(ToPackedNode(node.m_planeIndex));
+			for (auto side = 0; side < 2; ++side)
+				packedNode.m_children[side] = node.m_children[side];
+		}
+		// Only solid matters to a trace, anything unexpected is empty
+		m_packedLeafContents.clear();
+		m_packedLeafContents.reserve(leaves.size());
+		for (const auto& leaf : leaves)
+		{
+			m_packedLeafContents.push_back(
+				leaf.m_contents < 0 ? leaf.m_contents : BSPDefines::Contents_Empty);
+		}
+		m_packedClipNodeBase = static_cast<oxyS32>(nodes.size());
+		for (const auto& clipNode : clipNodes)
+		{
+			auto& packedNode =
+				m_packedNodes.emplace_back(ToPackedNode(clipNode.m_planeIndex));
+			for (auto side = 0; side < 2; ++side)
+			{
+				const oxyS32 child = clipNode.m_children[side];
+				packedNode.m_children[side] =
+					child >= 0 ? child + m_packedClipNodeBase : child;
+			}
+		}
+
+		// A trace keeps at most one pending segment per level
+		oxySize maxDepth = 0;
+		std::vector<std::pair<oxyS32, oxySize>> pending;
+		for (oxySize hull = 0; hull < BSPDefines::k_MaxMapHulls; ++hull)
+		{
+			if (m_bspData->m_models.empty())
+				break;
+			pending.emplace_back(
+				GetTraceRoot(static_cast<CollisionHull>(hull)), 1);
+			while (!pending.empty())
+			{
+				const auto [nodeIndex, depth] = pending.back();
+				pending.pop_back();
+				if (nodeIndex < 0 ||
+					static_cast<oxySize>(nodeIndex) >= m_packedNodes.size())
+					continue;
+				maxDepth = (std::max)(maxDepth, depth);
+				for (const auto child : m_packedNodes[nodeIndex].m_children)
+					pending.emplace_back(child, depth + 1);
+			}
+		}
+		m_traceStack.resize(maxDepth);
+	}
+	auto World::GetTraceRoot(CollisionHull hull) const -> oxyS32
+	{
+		const auto& model = m_bspData->m_models[0];
+		// The point hull is the node tree, the rest have clip node trees
+		if (hull == CollisionHull::CollisionHull_Point)
+			return static_cast<oxyS32>(model.m_headNodes[0]);
+		return static_cast<oxyS32>(model.m_headNodes[static_cast<int>(hull)]) +
+			   m_packedClipNodeBase;
+	}
+	auto World::GetPackedLeafContents(oxyS32 rootIndex) const -> const oxyS32*
+	{
+		// Node tree leaves are looked up, clip tree ones are contents already
+		return rootIndex < m_packedClipNodeBase ? m_packedLeafContents.data()
+												: nullptr;
+	}
+	auto World::TraceNodes(oxyS32 rootIndex, const oxyVec3& start,
+						   const oxyVec3& end, LineTraceResult& result,
+						   std::span<TraceSegment> stack) const -> oxyBool
+	{
+		// Visits leaves and writes planes in the same order as the recursive
+		// trace, the far side of a split waits on the stack while the near
+		// side is walked and the first solid leaf ends it
+		oxySize stackSize = 0;
+		auto nodeIndex = rootIndex;
+		auto segmentStart = start;
+		auto segmentEnd = end;
+		const auto* leafContents = GetPackedLeafContents(rootIndex);
+		for (;;)
+		{
+			if (nodeIndex < 0)
+			{
+				const auto contents =
+					leafContents ? leafContents[-nodeIndex - 1] : nodeIndex;
+				if (contents == BSPDefines::Contents_Solid)
+				{
+					result.m_startSolid = true;
+					result.m_endPos = segmentStart;
+					result.m_fraction = TraceFraction(start, end, segmentStart);
+					return true;
+				}
+				result.m_allSolid = false;
+				if (stackSize == 0)
+				{
+					result.m_fraction = 1.f;
+					return false;
+				}
+				const auto& segment = stack[--stackSize];
+				nodeIndex = segment.m_nodeIndex;
+				segmentStart = segment.m_start;
+				segmentEnd = segment.m_end;
+				continue;
+			}
+			const auto& node = m_packedNodes[nodeIndex];
+			const auto t1 = node.Distance(segmentStart);
+			const auto t2 = node.Distance(segmentEnd);
+			if (t1 >= 0 && t2 >= 0)
+			{
+				nodeIndex = node.m_children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				nodeIndex = node.m_children[1];
+				continue;
+			}
+
+			// Resolves issues where the start is **just** inside of a solid leaf
+			constexpr auto k_lineTraceDistEpsilon = 0.032f;
+			oxyF32 frac;
+			if (t1 < 0)
+				frac = (t1 + k_lineTraceDistEpsilon) / (t1 - t2);
+			else
+				frac = (t1 - k_lineTraceDistEpsilon) / (t1 - t2);
+			if (frac < 0)
+				frac = 0;
+			if (frac > 1)
+				frac = 1;
+			const auto mid = segmentStart + (segmentEnd - segmentStart) * frac;
+			const auto side = (t1 >= 0) ? 0 : 1;
+			if (!side)
+			{
+				result.m_planeNormal = node.m_normal;
+				result.m_planeDist = node.m_dist;
+			}
+			else
+			{
+				result.m_planeNormal = -node.m_normal;
+				result.m_planeDist = -node.m_dist;
+			}
+			stack[stackSize++] = {node.m_children[1 - side], mid, segmentEnd};
 			nodeIndex = node.m_children[side];
+			segmentEnd = mid;
 		}
-		const auto leafIdx = -nodeIndex - 1;
-		return &leaves[leafIdx];
 	}
 	auto World::HullTrace(CollisionHull hull, const oxyVec3& start,
 						  const oxyVec3& end,
@@ -707,24 +1088,54 @@ namespace oxygen
 	{
 		if (hull == CollisionHull::CollisionHull_None)
 			return false;
-		const auto rootClipNode =
-			m_bspData->m_models[0].m_headNodes[static_cast<int>(hull)];
-		const auto bspTrace =
-			RecursiveClipNodeLineTrace(rootClipNode, start, end, result);
-		return bspTrace;
+		return TraceNodes(GetTraceRoot(hull), start, end, result);
 	}
 	auto World::LineTrace(const oxyVec3& start, const oxyVec3& end,
 						  const Entity* self,
 						  LineTraceResult& result) const -> oxyBool
 	{
-		const auto rootNode = m_bspData->m_models[0].m_headNodes[0];
-		const auto bspTrace =
-			RecursiveNodeLineTrace(rootNode, start, end, result);
-		oxyF32 minDistSq = (end - start).MagnitudeSquared();
-		if (bspTrace)
-			minDistSq = (result.m_endPos - start).MagnitudeSquared();
-		oxyBool hitHull = false;
-		for (const auto& ent : m_entities)
+		const TraceRay ray{start, end};
+		LineTraceBatch({&ray, 1}, self, {&result, 1});
+		return result.m_startSolid; // || hit hull
+	}
+	auto World::HullTraceBatch(CollisionHull hull,
+							   std::span<const TraceRay> rays,
+							   std::span<LineTraceResult> results) const -> void
+	{
+		OXYCHECK(rays.size() == results.size());
+		if (hull == CollisionHull::CollisionHull_None)
+			return;
+		const auto rootIndex = GetTraceRoot(hull);
+		for (oxySize i = 0; i < rays.size(); ++i)
+			TraceNodes(rootIndex, rays[i].m_start, rays[i].m_end, results[i]);
+	}
+	auto World::LineTraceBatch(std::span<const TraceRay> rays,
+							   const Entity* self,
+							   std::span<LineTraceResult> results) const -> void
+	{
+		OXYCHECK(rays.size() == results.size());
+		if (rays.empty())
+			return;
+
+		// Hulls near any of the rays, each ray tests all of them and the
+		// slab test rejects the ones it doesn't pass through
+		auto mins = rays[0].m_start;
+		auto maxs = rays[0].m_start;
+		for (const auto& ray : rays)
+		{
+			for (const auto& point : {ray.m_start, ray.m_end})
+			{
+				mins = {(std::min)(mins.x, point.x), (std::min)(mins.y, point.y),
+						(std::min)(mins.z, point.z)};
+				maxs = {(std::max)(maxs.x, point.x), (std::max)(maxs.y, point.y),
+						(std::max)(maxs.z, point.z)};
+			}
+		}
+		std::vector<std::shared_ptr<Entity>> nearby;
+		QueryEntitiesInBounds(mins, maxs, nearby);
+		std::vector<std::pair<std::shared_ptr<Entity>, const HullComponent*>>
+			hulls;
+		for (auto& ent : nearby)
 		{
 			if (ent.get() == self)
 				continue;
@@ -732,17 +1143,32 @@ namespace oxygen
 				continue;
 			if (!ent->GetFlag(EntityFlags_HasHull))
 				continue;
-			const auto hullcomp = ent->GetComponent<HullComponent>();
+			const auto hullcomp = ent->FindComponent<HullComponent>();
 			if (!hullcomp)
 				continue;
 			if (!hullcomp->IsEnabled())
 				continue;
 			if (hullcomp->DoesIgnoreEntity(self))
 				continue;
-			oxyVec3 hullHitPos;
-			oxyVec3 hullHitNormal;
-			if (hullcomp->TraceLine(start, end, hullHitPos, hullHitNormal))
+			hulls.emplace_back(std::move(ent), hullcomp);
+		}
+
+		const auto rootNode = GetTraceRoot(CollisionHull::CollisionHull_Point);
+		for (oxySize i = 0; i < rays.size(); ++i)
+		{
+			const auto& start = rays[i].m_start;
+			const auto& end = rays[i].m_end;
+			auto& result = results[i];
+			const auto bspTrace = TraceNodes(rootNode, start, end, result);
+			oxyF32 minDistSq = (end - start).MagnitudeSquared();
+			if (bspTrace)
+				minDistSq = (result.m_endPos - start).MagnitudeSquared();
+			for (const auto& [ent, hullcomp] : hulls)
 			{
+				oxyVec3 hullHitPos;
+				oxyVec3 hullHitNormal;
+				if (!hullcomp->TraceLine(start, end, hullHitPos, hullHitNormal))
+					continue;
 				const auto distSq = (hullHitPos - start).MagnitudeSquared();
 				if (distSq < minDistSq)
 				{
@@ -750,51 +1176,64 @@ namespace oxygen
 					result.m_endPos = hullHitPos;
 					result.m_planeNormal = hullHitNormal;
 					result.m_planeDist = 1.f;
+					result.m_fraction = TraceFraction(start, end, hullHitPos);
 					result.m_hitEntity = ent;
-					hitHull = true;
 				}
 			}
 		}
-		return bspTrace; // || hitHull;
 	}
 	auto World::CalculateHullSlideMovement(CollisionHull hull,
 										   const oxyVec3& position,
-										   const oxyVec3& distance) -> oxyVec3
+										   oxyVec3& velocity,
+										   oxyF32 deltaTimeSeconds,
+										   oxyF32 stepHeight) const -> oxyVec3
 	{
 		if (hull == CollisionHull::CollisionHull_None)
-			return position + distance;
-		const auto rootNode =
-			m_bspData->m_models[0].m_headNodes[static_cast<int>(hull)];
-		oxyVec3 step{};
-		step += RecursiveSlideHull(rootNode, position,
-								   distance * oxyVec3{1, 0, 0}, 0);
-		step += RecursiveSlideHull(rootNode, position + step,
-								   distance * oxyVec3{0, 1, 0}, 0);
-		step += RecursiveSlideHull(rootNode, position + step,
-								   distance * oxyVec3{0, 0, 1}, 0);
-		auto finalPos = position + step;
-		// for (const auto& ent : m_entities)
-		//{
-		//	if (ent.get() == self)
-		//		continue;
-		//	const auto hullcomp = ent->GetComponent<HullComponent>();
-		//	if (!hullcomp)
-		//		continue;
-		//	if (hullcomp->DoesIgnoreEntity(self))
-		//		continue;
-		//
-		//	oxyVec3 hullCollidePos;
-		//	oxyVec3 hullCollideNormal;
-		//	if (hullcomp->CollidesWithHull(finalPos, hull, hullCollidePos,
-		//								   hullCollideNormal))
-		//	{
-		//		// push away from the hull
-		//		// the collide normal is scaled by the penetration depth
-		//		finalPos -= hullCollideNormal;
-		//	}
-		// }
-
-		return finalPos;
+			return position + velocity * deltaTimeSeconds;
+		const auto rootIndex = GetTraceRoot(hull);
+		auto slidPosition = position;
+		auto slidVelocity = velocity;
+		const auto blocked =
+			SlideHullMove(rootIndex, slidPosition, slidVelocity, deltaTimeSeconds);
+		if (!blocked || stepHeight <= 0.f)
+		{
+			velocity = slidVelocity;
+			return slidPosition;
+		}
+
+		// Up, across and back down onto whatever the wall was the riser of
+		LineTraceResult trace{};
+		auto steppedPosition = position + oxyVec3{0.f, 0.f, stepHeight};
+		if (TraceNodes(rootIndex, position, steppedPosition, trace))
+			steppedPosition = trace.m_endPos;
+		auto steppedVelocity = oxyVec3{velocity.x, velocity.y, 0.f};
+		SlideHullMove(rootIndex, steppedPosition, steppedVelocity,
+					  deltaTimeSeconds);
+		const auto down = steppedPosition - oxyVec3{0.f, 0.f, stepHeight};
+		trace = {};
+		if (TraceNodes(rootIndex, steppedPosition, down, trace))
+		{
+			if (trace.m_planeNormal.z < k_floorNormalZ)
+			{
+				velocity = slidVelocity;
+				return slidPosition;
+			}
+			steppedPosition = trace.m_endPos;
+		}
+		else
+			steppedPosition = down;
+
+		const auto slidDistSq =
+			oxyVec2{slidPosition - position}.MagnitudeSquared();
+		const auto steppedDistSq =
+			oxyVec2{steppedPosition - position}.MagnitudeSquared();
+		if (steppedDistSq <= slidDistSq)
+		{
+			velocity = slidVelocity;
+			return slidPosition;
+		}
+		velocity = {steppedVelocity.x, steppedVelocity.y, slidVelocity.z};
+		return steppedPosition;
 	}
 	auto World::SpawnEntity(oxyObjectID id) -> std::shared_ptr<Entity>
 	{
@@ -809,6 +1248,7 @@ namespace oxygen
 							   [ent](const auto& e) { return e.get() == ent; });
 		if (it != m_entities.end())
 		{
+			UnlinkEntity(**it);
 			(*it)->m_world.reset();
 			m_entities.erase(it);
 		}
@@ -826,27 +1266,123 @@ namespace oxygen
 			player->SetFlag(EntityFlags_IsLocalPlayer, true);
 		}
 	}
-	auto World::RecursiveSlideHull(oxyS32 rootClipNode, const oxyVec3& position,
-								   const oxyVec3& offset, int depth) -> oxyVec3
+	auto World::HullPointContents(oxyS32 rootIndex,
+								  const oxyVec3& point) const -> oxyS32
 	{
-		if (depth > 4)
-			return {};
-		LineTraceResult hitResult;
-		if (RecursiveClipNodeLineTrace(rootClipNode, position,
-									   position + offset, hitResult))
-		{
-			// Project offset onto the plane normal
-			auto invNormal =
-				-oxyVec3{hitResult.m_planeNormal.x, hitResult.m_planeNormal.y,
-						 hitResult.m_planeNormal.z};
-			invNormal = invNormal * (offset * invNormal).Magnitude();
-			auto wallDir = offset - invNormal;
-			auto newPos = position + wallDir;
-			auto newOffset = newPos - position;
-			return RecursiveSlideHull(rootClipNode, newPos, newOffset,
-									  depth + 1);
-		}
-		return offset;
+		auto nodeIndex = rootIndex;
+		while (nodeIndex >= 0)
+		{
+			const auto& node = m_packedNodes[nodeIndex];
+			nodeIndex = node.m_children[node.Distance(point) >= 0.f ? 0 : 1];
+		}
+		const auto* leafContents = GetPackedLeafContents(rootIndex);
+		return leafContents ? leafContents[-nodeIndex - 1] : nodeIndex;
+	}
+	namespace
+	{
+		// Removes the part of velocity going into the plane
+		auto ClipVelocity(const oxyVec3& velocity,
+						  const oxyVec3& normal) -> oxyVec3
+		{
+			// Tiny leftovers would keep nudging the hull into the plane
+			constexpr auto k_stopEpsilon = 0.1f;
+			auto clipped = velocity - normal * velocity.DotProduct(normal);
+			for (auto* component : {&clipped.x, &clipped.y, &clipped.z})
+			{
+				if (*component > -k_stopEpsilon && *component < k_stopEpsilon)
+					*component = 0.f;
+			}
+			return clipped;
+		}
+	}; // namespace
+	auto World::SlideHullMove(oxyS32 rootIndex, oxyVec3& position,
+							  oxyVec3& velocity,
+							  oxyF32 deltaTimeSeconds) const -> oxyBool
+	{
+		const auto primalVelocity = velocity;
+		auto originalVelocity = velocity;
+		std::array<oxyVec3, k_maxSlideClipPlanes> planes;
+		oxySize planeCount = 0;
+		auto timeLeft = deltaTimeSeconds;
+		auto blocked = false;
+		for (oxySize bump = 0; bump < k_maxSlideBumps; ++bump)
+		{
+			if (velocity.MagnitudeSquared() == 0.f)
+				break;
+			const auto end = position + velocity * timeLeft;
+			LineTraceResult trace{};
+			if (!TraceNodes(rootIndex, position, end, trace))
+			{
+				position = end;
+				break;
+			}
+			if (trace.m_fraction == 0.f &&
+				HullPointContents(rootIndex, position) ==
+					BSPDefines::Contents_Solid)
+			{
+				// Stuck inside solid, there is nothing to slide along
+				velocity = {};
+				return true;
+			}
+			if (trace.m_fraction > 0.f)
+			{
+				// Planes from before this stretch no longer constrain it
+				position = trace.m_endPos;
+				originalVelocity = velocity;
+				planeCount = 0;
+			}
+			timeLeft -= timeLeft * trace.m_fraction;
+			if (trace.m_planeNormal.z < k_floorNormalZ)
+				blocked = true;
+			if (planeCount == planes.size())
+			{
+				velocity = {};
+				break;
+			}
+			planes[planeCount++] = trace.m_planeNormal;
+
+			// Clipped against the first plane that leaves it clear of the
+			// others, otherwise a crease is slid along and a corner stops it
+			auto clipped = oxyVec3{};
+			oxySize i = 0;
+			for (; i < planeCount; ++i)
+			{
+				clipped = ClipVelocity(originalVelocity, planes[i]);
+				oxySize j = 0;
+				for (; j < planeCount; ++j)
+				{
+					if (j != i && clipped.DotProduct(planes[j]) < 0.f)
+						break;
+				}
+				if (j == planeCount)
+					break;
+			}
+			if (i != planeCount)
+				velocity = clipped;
+			else if (planeCount == 2)
+			{
+				const auto crease = planes[0].CrossProduct(planes[1]);
+				if (crease.MagnitudeSquared() == 0.f)
+				{
+					velocity = {};
+					break;
+				}
+				const auto dir = crease.Normalized();
+				velocity = dir * dir.DotProduct(velocity);
+			}
+			else
+			{
+				velocity = {};
+				break;
+			}
+			// Never bounce back against the intended direction
+			if (velocity.DotProduct(primalVelocity) <= 0.f)
+			{
+				velocity = {};
+				break;
+			}
+		}
+		return blocked;
 	}
 
 }; // namespace oxygen
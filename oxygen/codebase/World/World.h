@@ -1,6 +1,9 @@
 #pragma once
 
-#include "BSP.h"
+#include "CookedMap.h"
+#include "WorldLoader.h"
+#include "PhysicsWorld.h"
+#include "ComponentScheduler.h"
 
 namespace oxygen
 {
@@ -9,12 +12,19 @@ namespace oxygen
 		OXYGENOBJECT(World, ManagedObject);
 
 		std::unique_ptr<const BSPWorldData> m_bspData{};
+		std::unique_ptr<const CookedMapData> m_cookedData{};
 
 		auto
 		GetEntityList() const -> const std::vector<std::shared_ptr<struct Entity>>&
 		{
 			return m_entities;
 		}
+		// Per component type update times of the last and recent ticks
+		auto GetComponentTimings() const
+			-> std::span<const ComponentUpdateTiming>
+		{
+			return m_componentScheduler.GetTimings();
+		}
 
 		auto RandomPlayerSpawn() const -> oxyVec3;
 
@@ -38,12 +48,44 @@ namespace oxygen
 					   const struct Entity* self,
 					   LineTraceResult& result) const -> oxyBool;
 
+		// Batched traces, each result ends up as the single ray call would
+		// leave it (m_startSolid marks a world hit, m_fraction is where along
+		// the ray it stopped). The rays share the trace stack and
+		// LineTraceBatch gathers and filters nearby hulls once for the batch.
+		struct TraceRay
+		{
+			oxyVec3 m_start{};
+			oxyVec3 m_end{};
+		};
+		auto HullTraceBatch(CollisionHull hull, std::span<const TraceRay> rays,
+							std::span<LineTraceResult> results) const -> void;
+		auto LineTraceBatch(std::span<const TraceRay> rays,
+							const struct Entity* self,
+							std::span<LineTraceResult> results) const -> void;
+
+		// Planes steeper than this are walls, not something to stand on
+		static inline constexpr auto k_floorNormalZ = 0.7f;
+		// Quake style clip and slide of a hull moving at velocity. The whole
+		// move is traced and velocity is clipped against the planes it hits,
+		// creases slide along their intersection and corners stop it. A move
+		// blocked by a wall is retried from up to stepHeight higher and kept
+		// if it gets further. Returns the new position, velocity is left
+		// clipped.
 		auto CalculateHullSlideMovement(CollisionHull hull,
 										const oxyVec3& position,
-										const oxyVec3& distance) -> oxyVec3;
+										oxyVec3& velocity,
+										oxyF32 deltaTimeSeconds,
+										oxyF32 stepHeight) const -> oxyVec3;
 
 		auto SpawnEntity(oxyObjectID id = 0) -> std::shared_ptr<Entity>;
 
+		// Entities linked into any world leaf the box touches, each once.
+		// Links are refreshed as entities update.
+		auto QueryEntitiesInBounds(
+			const oxyVec3& mins, const oxyVec3& maxs,
+			std::vector<std::shared_ptr<struct Entity>>& entities) const
+			-> void;
+
 		auto RemoveEntity(struct Entity* ent) -> void;
 
 		auto GetLocalPlayer() const -> std::weak_ptr<Entity>
@@ -52,10 +94,41 @@ namespace oxygen
 		}
 		auto SetLocalPlayer(std::shared_ptr<Entity> player) -> void;
 
+		// Frustum and camera PVS test for a world space bounding sphere, only
+		// valid on the render thread while rendering
+		auto IsSphereVisible(const oxyVec3& center,
+							 oxyF32 radius) const -> oxyBool;
+
 	  private:
 		friend struct GameManager;
-		friend auto LoadWorld(std::string_view name) -> std::shared_ptr<World>;
-		auto SubmitBSPFacesToRenderQueue() -> void;
+		friend struct GfxRenderer;
+		friend struct WorldStream;
+		friend struct PhysicsWorld;
+		friend struct ComponentScheduler;
+		friend auto LoadTraceWorld(std::string_view name)
+			-> std::shared_ptr<World>;
+		friend auto RandomOpenPoint(const World& world) -> oxyVec3;
+		friend auto BenchmarkWorldTrace(std::string_view name,
+										oxyU32 rayCount) -> void;
+		friend auto BenchmarkWorldFindLeaf(std::string_view name,
+										   oxyU32 pointCount) -> void;
+		friend auto BenchmarkWorldRenderTraversal(std::string_view name,
+												  oxyU32 viewCount) -> void;
+		friend auto BenchmarkPhysics(std::string_view name,
+									 oxyU32 bodyCount) -> void;
+		friend auto CheckPhysicsDeterminism(std::string_view name,
+											oxyU32 bodyCount,
+											oxyBool jobPerBody) -> void;
+		friend auto CheckHullMovement(std::string_view name) -> void;
+		// Simulation thread
+		auto CaptureRenderSnapshot(struct GfxRenderSnapshot& snapshot) -> void;
+
+		// Render thread. m_renderCameraPosition, m_cameraPVS, the
+		// marked node and face sets and m_brushModelCache belong to it, the
+		// simulation never touches them.
+		auto SubmitBSPFacesToRenderQueue(const struct GfxRenderSnapshot& snapshot)
+			-> void;
+		auto LateLatchCamera(const struct GfxRenderSnapshot& snapshot) -> void;
 
 		oxyVec3 m_renderCameraPosition{};
 
@@ -64,25 +137,53 @@ namespace oxygen
 
 		std::vector<std::shared_ptr<const struct GfxTexture>> m_bspTextures;
 		std::shared_ptr<const struct GfxTexture> m_lightmapTexture;
-		std::vector<std::array<oxyU32, 4>> m_lightmapRects;
-		oxyU32 m_lightmapSampleSize{};
-		oxyU32 m_lightmapBlockWidth{};
-		oxyU32 m_lightmapBlockHeight{};
-		oxyU32 m_lightmapNumRects{};
-		struct WorldTri
+		std::vector<oxyVec3> m_playerStarts;
+		// Row of the cooked PVS for the camera leaf
+		std::span<const oxyU8> m_cameraPVS;
+		// Sized to the map's nodes and faces on the first render
+		DynamicBitset m_nodesMarkedForRender;
+		// Visible world nodes per camera leaf, derived from its PVS row. Most
+		// recently used first and bounded so huge maps don't keep one per leaf.
+		static inline constexpr auto k_maxCachedPVSNodeSets = oxySize{64};
+		struct PVSNodeSet
 		{
-			oxyVec3 m_vertices[3];
-			oxyVec2 m_texcoords[3];
-			oxyVec2 m_lmtexcoords[3];
-			oxyU32 m_textureIndex{};
+			oxySize m_leafIndex{};
+			DynamicBitset m_nodes;
 		};
-		std::vector<std::vector<WorldTri>> m_bspFaces;
-		std::vector<oxyVec3> m_playerStarts;
-		std::vector<oxyU8> m_cameraPVS;
-		std::vector<oxyS16> m_bspNodeParents;
-		std::vector<oxyS16> m_bspLeafParents;
-		std::bitset<BSPDefines::k_MaxMapNodes> m_nodesMarkedForRender;
-		std::bitset<BSPDefines::k_MaxMapFaces> m_facesMarkedForRender;
+		std::vector<PVSNodeSet> m_pvsNodeSets;
+		// Camera leaf whose set m_nodesMarkedForRender holds. Brush model nodes
+		// marked on top of it are disjoint from the world's and can stay.
+		std::optional<oxySize> m_markedPVSLeaf;
+		auto GetPVSNodeSet(oxySize leafIndex) -> const DynamicBitset&;
+		DynamicBitset m_facesMarkedForRender;
+
+		// Per brush model (index 0, the world, unused), the world leaves its
+		// bounds touch are only recollected when the model moves
+		struct BrushModelCache
+		{
+			oxyBool m_valid{};
+			oxyVec3 m_origin{};
+			std::vector<oxyS32> m_leaves;
+			std::vector<oxyS32> m_nodes;
+		};
+		std::vector<BrushModelCache> m_brushModelCache;
+		auto SubmitBrushModel(oxySize modelIndex) -> void;
+		auto CollectLeavesInBounds(oxyS32 nodeIndex, const oxyVec3& mins,
+								   const oxyVec3& maxs,
+								   std::vector<oxyS32>& leaves) const -> void;
+		// Render thread
+		auto
+		IsAnyLeafInCameraPVS(std::span<const oxyS32> leaves) const -> oxyBool;
+
+		// Simulation thread. Entities per world leaf, linked by the union of
+		// their render occlusion box and hull. Leaf 0 (solid) is never linked.
+		std::vector<std::vector<struct Entity*>> m_leafEntities;
+		PhysicsWorld m_physics;
+		ComponentScheduler m_componentScheduler;
+		mutable std::vector<oxyS32> m_queryLeaves;
+		mutable oxyU32 m_linkQueryStamp{};
+		auto LinkEntity(struct Entity& ent) -> void;
+		auto UnlinkEntity(struct Entity& ent) -> void;
 
 		//auto SummonPlayer(const EntitySummonParams& params)
 		//	-> std::shared_ptr<Entity>;
@@ -104,11 +205,87 @@ namespace oxygen
 		auto RenderBSPFace(struct GfxRenderer& gfx, oxySize faceindex,
 						   const oxyVec3& origin) -> void;
 
-		auto ComputeTriFaces() -> void;
+		auto MarkPVSNodesFromLeaf(const BSPDefines::Leaf* leaf) -> void;
+
+		// Traversals (render, FindLeaf, traces) walk these rather than m_nodes
+		// and m_clipNodes, the plane is inlined and axial ones compare a
+		// single component. Clip nodes follow the nodes.
+		struct PackedNode
+		{
+			oxyVec3 m_normal;
+			oxyF32 m_dist;
+			// Node tree negatives are -leaf - 1, clip tree ones are contents
+			oxyS32 m_children[2];
+			oxyU32 m_type; // Axis of an axial plane, PackedNode::k_nonAxial if not
+			oxyU32 m_padding;
 
-		auto MarkPVSNodesFromLeaf(const BSPDefines::Leaf* leaf,
-								  oxySize modelIndex) -> void;
+			static inline constexpr auto k_nonAxial = oxyU32{3};
+			auto Distance(const oxyVec3& point) const -> oxyF32
+			{
+				// Exactly what the dot product gives, the other terms are zero
+				switch (m_type)
+				{
+				case 0:
+					return point.x - m_dist;
+				case 1:
+					return point.y - m_dist;
+				case 2:
+					return point.z - m_dist;
+				default:
+					return point.DotProduct(m_normal) - m_dist;
+				}
+			}
+		};
+		static_assert(sizeof(PackedNode) == 32,
+					  "PackedNode struct size is not 32 bytes");
+		std::vector<PackedNode> m_packedNodes;
+		oxyS32 m_packedClipNodeBase{};
+		// Node tree leaf contents as traces see them
+		std::vector<oxyS32> m_packedLeafContents;
+		// Simulation thread. Far sides of splits waiting to be traced, sized
+		// to the deepest tree so a trace never allocates. Traces on other
+		// threads bring a stack of the same size.
+		struct TraceSegment
+		{
+			oxyS32 m_nodeIndex;
+			oxyVec3 m_start;
+			oxyVec3 m_end;
+		};
+		mutable std::vector<TraceSegment> m_traceStack;
+		auto BuildPackedNodes() -> void;
 
+		// World model point lookups start from the cell of this grid over its
+		// bounds. A cell holds its leaf (as -leaf - 1) when all of it is in
+		// one, otherwise the node below which the cell is split.
+		static inline constexpr auto k_leafGridCellSize = oxyF32{64.f};
+		static inline constexpr auto k_leafGridMaxCells = oxySize{1} << 18;
+		// Cells are classified as if this much bigger, a point rounded into
+		// the neighbouring cell still finds its leaf
+		static inline constexpr auto k_leafGridEpsilon = oxyF32{0.125f};
+		struct LeafGrid
+		{
+			oxyVec3 m_origin;
+			oxyVec3 m_inverseCellSize;
+			oxyS32 m_dims[3];
+			std::vector<oxyS32> m_cells;
+		};
+		LeafGrid m_leafGrid{};
+		auto BuildLeafGrid() -> void;
+		auto FindLeafFromNode(oxyS32 nodeIndex, const oxyVec3& position) const
+			-> const BSPDefines::Leaf*;
+		auto GetTraceRoot(CollisionHull hull) const -> oxyS32;
+		auto GetPackedLeafContents(oxyS32 rootIndex) const -> const oxyS32*;
+		auto TraceNodes(oxyS32 rootIndex, const oxyVec3& start,
+						const oxyVec3& end,
+						LineTraceResult& result) const -> oxyBool
+		{
+			return TraceNodes(rootIndex, start, end, result, m_traceStack);
+		}
+		auto TraceNodes(oxyS32 rootIndex, const oxyVec3& start,
+						const oxyVec3& end, LineTraceResult& result,
+						std::span<TraceSegment> stack) const -> oxyBool;
+
+		// The original per ray traces, BenchmarkWorldTrace checks against them
 		auto RecursiveClipNodeLineTrace(oxyS32 clipNodeIndex,
 										const oxyVec3& start,
 										const oxyVec3& end,
@@ -116,8 +293,15 @@ namespace oxygen
 		auto RecursiveNodeLineTrace(oxyS32 nodeIndex, const oxyVec3& start,
 									const oxyVec3& end,
 									LineTraceResult& result) const -> bool;
-		auto RecursiveSlideHull(oxyS32 rootClipNode, const oxyVec3& position,
-								const oxyVec3& offset, int depth) -> oxyVec3;
+		auto HullPointContents(oxyS32 rootIndex,
+							   const oxyVec3& point) const -> oxyS32;
+
+		static inline constexpr auto k_maxSlideBumps = oxySize{4};
+		static inline constexpr auto k_maxSlideClipPlanes = oxySize{5};
+		// Returns true if a wall got in the way
+		auto SlideHullMove(oxyS32 rootIndex, oxyVec3& position,
+						   oxyVec3& velocity,
+						   oxyF32 deltaTimeSeconds) const -> oxyBool;
 		auto Update(float deltaTimeSeconds) -> void;
 	};
 }; // namespace oxygen
\ No newline at end of file
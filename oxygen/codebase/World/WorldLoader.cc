@@ -2,94 +2,778 @@
 #include "WorldLoader.h"
 #include "World.h"
 #include "BSP.h"
+#include "CookedMap.h"
+#include "Entity/Entity.h"
+#include "Component/HullComponent/HullComponent.h"
 #include "Gfx/GfxRenderer.h"
+#include "Job/JobSystem.h"
 #include "Platform/Platform.h"
 
 namespace oxygen
 {
-	auto LoadWorld(std::string_view name) -> std::shared_ptr<World>
+	// A texture that is either cached already or being decoded
+	struct PendingWorldTexture
 	{
-		auto world = ObjectManager::GetInstance().CreateManagedObject<World>();
+		std::string m_path;
+		std::shared_ptr<const GfxTexture> m_cached;
+		std::future<std::optional<GraphicsAbstraction::DecodedTexture>>
+			m_decode;
+	};
+
+	namespace
+	{
+		// Simulation thread, the renderer's texture cache is not thread safe.
+		// A texture the current world also uses is still cached while the next
+		// one loads, so it carries over instead of being decoded again.
+		auto StartTextureLoad(std::string path) -> PendingWorldTexture
+		{
+			PendingWorldTexture texture{std::move(path)};
+			texture.m_cached =
+				GfxRenderer::GetInstance().FindTexture(texture.m_path);
+			if (!texture.m_cached)
+			{
+				texture.m_decode =
+					JobSystem::GetInstance().Async([path = texture.m_path]() {
+						return GraphicsAbstraction::DecodeTexture(path.c_str());
+					});
+			}
+			return texture;
+		}
+		auto IsTextureLoadReady(const PendingWorldTexture& texture) -> oxyBool
+		{
+			return texture.m_cached ||
+				   texture.m_decode.wait_for(std::chrono::seconds(0)) ==
+					   std::future_status::ready;
+		}
+		auto FinishTextureLoad(PendingWorldTexture& texture)
+			-> std::shared_ptr<const GfxTexture>
+		{
+			if (texture.m_cached)
+				return std::move(texture.m_cached);
+			const auto decoded = texture.m_decode.get();
+			if (!decoded)
+				return {};
+			return GfxRenderer::GetInstance().UploadTexture(texture.m_path,
+															*decoded);
+		}
+		template <typename T>
+		auto IsTaskReady(const std::future<T>& task, oxyBool blocking) -> oxyBool
+		{
+			return blocking || task.wait_for(std::chrono::seconds(0)) ==
+								   std::future_status::ready;
+		}
+	}; // namespace
 
+	// Stages run as tasks once their inputs are ready, Poll picks up each
+	// one as it finishes:
+	//   lightmap decode -----------------> upload
+	//   .bsp -> texture decodes ---------> uploads
+	//        -> cooked data (or cook) ---> entities
+	//        -> trace nodes, leaf grid --/
+	WorldStream::WorldStream(std::string_view name, WorldLoadProgressFn progress,
+							 void* progressContext)
+		: m_name(name), m_progress(progress), m_progressContext(progressContext)
+	{
+		m_textures.push_back(StartTextureLoad(std::format(
+			"{}/textures/{}_lightmap0.png", GetExecutableDirectory(), name)));
+
+		m_world = ObjectManager::GetInstance().CreateManagedObject<World>();
+		m_mapTask = JobSystem::GetInstance().Async(
+			[world = m_world.get(), name = m_name]() {
+				auto bspData = std::make_unique<BSPWorldData>();
+				if (!bspData->Load(name))
+					return false;
+				world->m_bspData = std::move(bspData);
+				return true;
+			});
+	}
+	WorldStream::~WorldStream()
+	{
+		// Job futures do not block when they go away, and these tasks write
+		// into m_world
+		if (m_mapTask.valid())
+			m_mapTask.wait();
+		if (m_mapDataTask.valid())
+			m_mapDataTask.wait();
+	}
+
+	auto WorldStream::Step(std::string_view stage) -> void
+	{
+		++m_stepsDone;
+		if (m_progress)
+			m_progress(m_progressContext, stage,
+					   static_cast<oxyF32>(m_stepsDone) / m_stepCount);
+	}
+	auto WorldStream::Fail() -> oxyBool
+	{
+		m_world.reset();
+		m_stage = Stage_Done;
+		return true;
+	}
+	auto WorldStream::Poll(oxyBool blocking) -> oxyBool
+	{
+		if (m_stage == Stage_Map)
+		{
+			if (!IsTaskReady(m_mapTask, blocking))
+				return false;
+			if (!m_mapTask.get())
+				return Fail();
+
+			const auto& bsp = *m_world->m_bspData;
+			m_textures.reserve(bsp.m_miptex.size() + 1);
+			for (const auto& mip : bsp.m_miptex)
+			{
+				m_textures.push_back(StartTextureLoad(std::format(
+					"{}/textures/{}.png", GetExecutableDirectory(), mip.m_name)));
+			}
+
+			// A missing or stale .oxymap is cooked from the sources in memory
+			m_mapDataTask = JobSystem::GetInstance().Async(
+				[world = m_world.get(), name = m_name]() {
+					auto& jobs = JobSystem::GetInstance();
+					auto BuildNodes = [world]() {
+						world->BuildPackedNodes();
+						world->BuildLeafGrid();
+					};
+					JobCounter nodesDone;
+					jobs.Run(BuildNodes, nodesDone);
+					const auto& bsp = *world->m_bspData;
+					auto cookedData = std::make_unique<CookedMapData>();
+					const auto ok = cookedData->Load(name, bsp) ||
+									cookedData->LoadFromSource(name, bsp);
+					jobs.Wait(nodesDone);
+					if (ok)
+						world->m_cookedData = std::move(cookedData);
+					return ok;
+				});
+			m_stepCount = m_textures.size() + 3;
+			m_stage = Stage_Textures;
+			Step("map");
+		}
+		if (m_stage == Stage_Textures)
+		{
+			// Uploads are spread over polls so the current world does not
+			// hitch, cached textures cost nothing and are not counted
+			oxySize uploads = 0;
+			m_world->m_bspTextures.reserve(m_textures.size() - 1);
+			while (m_nextTexture < m_textures.size())
+			{
+				auto& texture = m_textures[m_nextTexture];
+				if (!blocking && !texture.m_cached &&
+					(uploads == k_uploadsPerPoll || !IsTextureLoadReady(texture)))
+					return false;
+				uploads += texture.m_cached ? 0 : 1;
+				if (m_nextTexture == 0)
+					m_world->m_lightmapTexture = FinishTextureLoad(texture);
+				else
+					m_world->m_bspTextures.push_back(FinishTextureLoad(texture));
+				++m_nextTexture;
+				Step(m_nextTexture == 1 ? "lightmap" : "textures");
+			}
+			m_textures.clear();
+			m_stage = Stage_MapData;
+		}
+		if (m_stage == Stage_MapData)
+		{
+			if (!IsTaskReady(m_mapDataTask, blocking))
+				return false;
+			if (!m_mapDataTask.get())
+				return Fail();
+			Step("map data");
+
+			m_world->CreateEntitiesFromBSP();
+			m_stage = Stage_Done;
+			Step("entities");
+		}
+		return true;
+	}
+	auto WorldStream::TakeWorld() -> std::shared_ptr<World>
+	{
+		return std::move(m_world);
+	}
+
+	auto LoadWorld(std::string_view name, WorldLoadProgressFn progress,
+				   void* progressContext) -> std::shared_ptr<World>
+	{
+		WorldStream stream{name, progress, progressContext};
+		stream.Poll(true);
+		return stream.TakeWorld();
+	}
+
+	auto CookWorld(std::string_view name) -> oxyBool
+	{
+		BSPWorldData bspData;
+		if (!bspData.Load(name))
+			return false;
+		const auto image = CookMapImage(name, bspData);
+		const auto ok = !image.empty() &&
+						WriteFileContents(GetCookedMapPath(name), image);
+		LogMessage(std::format("CookWorld {}: {} ({} bytes)\n", name,
+							   ok ? "written" : "failed", image.size())
+					   .c_str());
+		return ok;
+	}
+
+	auto BenchmarkWorldLoad(std::string_view name, oxyU32 iterations) -> void
+	{
+		// Only the map data differs between the paths, textures and entity
+		// spawning cost the same either way
+		const auto Measure = [&](oxyBool cooked) -> std::pair<oxyF64, oxyF64> {
+			auto best = (std::numeric_limits<oxyF64>::max)();
+			auto total = 0.0;
+			for (oxyU32 i = 0; i < iterations; ++i)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				BSPWorldData bspData;
+				CookedMapData cookedData;
+				const auto ok =
+					bspData.Load(name) &&
+					(cooked ? cookedData.Load(name, bspData)
+							: cookedData.LoadFromSource(name, bspData));
+				const auto elapsedMs = std::chrono::duration<oxyF64, std::milli>(
+										   std::chrono::steady_clock::now() - start)
+										   .count();
+				if (!ok)
+					return {-1.0, -1.0};
+				best = (std::min)(best, elapsedMs);
+				total += elapsedMs;
+			}
+			return {best, total / (std::max)(iterations, oxyU32{1})};
+		};
+
+		const auto [sourceBest, sourceAvg] = Measure(false);
+		const auto [cookedBest, cookedAvg] = Measure(true);
+		LogMessage(std::format("BenchmarkWorldLoad {} x{}: source best "
+							   "{:.3f}ms avg {:.3f}ms, cooked best {:.3f}ms "
+							   "avg {:.3f}ms{}\n",
+							   name, iterations, sourceBest, sourceAvg,
+							   cookedBest, cookedAvg,
+							   cookedBest < 0.0 ? " (no up to date .oxymap)"
+												: "")
+					   .c_str());
+	}
+
+	auto LoadTraceWorld(std::string_view name) -> std::shared_ptr<World>
+	{
+		auto world = ObjectManager::GetInstance().CreateManagedObject<World>();
 		auto bspData = std::make_unique<BSPWorldData>();
-		if (!bspData->Load(name))
-			return {};
+		if (!bspData->Load(name) || bspData->m_models.empty())
+			return nullptr;
 		world->m_bspData = std::move(bspData);
+		world->BuildPackedNodes();
+		world->BuildLeafGrid();
+		return world;
+	}
 
-		world->m_bspTextures.reserve(world->m_bspData->m_miptex.size());
-		auto& gfx = GfxRenderer::GetInstance();
-		for (const auto& mip : world->m_bspData->m_miptex)
+	auto RandomOpenPoint(const World& world) -> oxyVec3
+	{
+		const auto& model = world.m_bspData->m_models[0];
+		oxyVec3 point{};
+		for (auto attempt = 0; attempt < 64; ++attempt)
 		{
-			const auto relpath = std::format(
-				"{}/textures/{}.png", GetExecutableDirectory(), mip.m_name);
-			world->m_bspTextures.push_back(gfx.LoadTexture(relpath));
+			point = {RandomF32(model.m_mins[0], model.m_maxs[0]),
+					 RandomF32(model.m_mins[1], model.m_maxs[1]),
+					 RandomF32(model.m_mins[2], model.m_maxs[2])};
+			if (world.FindLeaf(point, 0)->m_contents ==
+				BSPDefines::Contents_Empty)
+				break;
 		}
+		return point;
+	}
+
+	auto BenchmarkWorldTrace(std::string_view name, oxyU32 rayCount) -> void
+	{
+		// Traces only need the map data, no textures or entities
+		const auto world = LoadTraceWorld(name);
+		if (!world)
 		{
-			
-			const auto lmpath = std::format("{}/textures/{}_lightmap0.png",
-											GetExecutableDirectory(), name);
-			world->m_lightmapTexture = gfx.LoadTexture(lmpath);
+			LogMessage(std::format("BenchmarkWorldTrace {}: failed to load\n",
+								   name)
+						   .c_str());
+			return;
 		}
 
-		if (world->m_lightmapTexture)
-		{
-			const auto rectspath =
-				std::format("{}/maps/{}_rects.bin", GetExecutableDirectory(), name);
-			const auto lmwidth = world->m_lightmapTexture->m_width;
-			const auto lmheight = world->m_lightmapTexture->m_height;
-			const auto rectfile = CreateFileMap(rectspath);
-			if (rectfile)
+		// Segments between random points in the world bounds cross plenty of
+		// splits, most of them end in solid somewhere
+		const auto& model = world->m_bspData->m_models[0];
+		const auto RandomPoint = [&]() -> oxyVec3 {
+			return {RandomF32(model.m_mins[0], model.m_maxs[0]),
+					RandomF32(model.m_mins[1], model.m_maxs[1]),
+					RandomF32(model.m_mins[2], model.m_maxs[2])};
+		};
+		std::vector<World::TraceRay> rays(rayCount);
+		for (auto& ray : rays)
+			ray = {RandomPoint(), RandomPoint()};
+
+		constexpr auto k_passes = 5;
+		const auto Measure = [&](std::vector<World::LineTraceResult>& results,
+								 const auto& trace) -> oxyF64 {
+			auto best = (std::numeric_limits<oxyF64>::max)();
+			for (auto pass = 0; pass < k_passes; ++pass)
 			{
-				const auto u32ptr =
-					reinterpret_cast<const oxyU32*>(rectfile->GetMap());
-				if (rectfile->ValidateRange(u32ptr, 4 * sizeof(oxyU32)))
+				results.assign(rays.size(), {});
+				const auto start = std::chrono::steady_clock::now();
+				trace(results);
+				best = (std::min)(
+					best, std::chrono::duration<oxyF64>(
+							  std::chrono::steady_clock::now() - start)
+							  .count());
+			}
+			return best > 0.0 ? rays.size() / best : 0.0;
+		};
+		const auto SameVec = [](const oxyVec3& a, const oxyVec3& b) {
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		};
+
+		for (const auto hull : {CollisionHull::CollisionHull_Point,
+								CollisionHull::CollisionHull_Player})
+		{
+			const auto isPoint = hull == CollisionHull::CollisionHull_Point;
+			const oxyS32 headNode = model.m_headNodes[static_cast<int>(hull)];
+			std::vector<World::LineTraceResult> expected;
+			std::vector<World::LineTraceResult> actual;
+			const auto recursiveRate = Measure(expected, [&](auto& results) {
+				for (oxySize i = 0; i < rays.size(); ++i)
 				{
-					world->m_lightmapSampleSize = u32ptr[0];
-					world->m_lightmapBlockWidth = u32ptr[1];
-					world->m_lightmapBlockHeight = u32ptr[2];
-					world->m_lightmapNumRects = u32ptr[3];
-					if (rectfile->ValidateRange(u32ptr + 4,
-												world->m_lightmapNumRects * 4 *
-													sizeof(oxyU32)))
-					{
-						world->m_lightmapRects.reserve(
-							world->m_lightmapNumRects);
-						for (oxyU32 i = 0; i < world->m_lightmapNumRects; ++i)
-						{
-							const auto minx = u32ptr[4 + 4 * i];
-							const auto miny = u32ptr[4 + 4 * i + 1];
-							const auto maxx = u32ptr[4 + 4 * i + 2];
-							const auto maxy = u32ptr[4 + 4 * i + 3];
-							world->m_lightmapRects.push_back(
-								std::array<oxyU32, 4>{minx, miny, maxx, maxy});
-						}
-					}
+					if (isPoint)
+						world->RecursiveNodeLineTrace(headNode, rays[i].m_start,
+													  rays[i].m_end, results[i]);
+					else
+						world->RecursiveClipNodeLineTrace(
+							headNode, rays[i].m_start, rays[i].m_end,
+							results[i]);
 				}
+			});
+			const auto batchedRate = Measure(actual, [&](auto& results) {
+				if (isPoint)
+					world->LineTraceBatch(rays, nullptr, results);
+				else
+					world->HullTraceBatch(hull, rays, results);
+			});
+
+			oxySize mismatches = 0;
+			for (oxySize i = 0; i < rays.size(); ++i)
+			{
+				const auto& a = expected[i];
+				const auto& b = actual[i];
+				if (a.m_allSolid != b.m_allSolid ||
+					a.m_startSolid != b.m_startSolid ||
+					!SameVec(a.m_endPos, b.m_endPos) ||
+					!SameVec(a.m_planeNormal, b.m_planeNormal) ||
+					a.m_planeDist != b.m_planeDist)
+					++mismatches;
+			}
+			LogMessage(std::format("BenchmarkWorldTrace {} hull {} x{}: "
+								   "recursive {:.0f} rays/s, batched {:.0f} "
+								   "rays/s, {} mismatches\n",
+								   name, static_cast<int>(hull), rays.size(),
+								   recursiveRate, batchedRate, mismatches)
+						   .c_str());
+		}
+	}
+
+	auto BenchmarkWorldFindLeaf(std::string_view name, oxyU32 pointCount) -> void
+	{
+		const auto world = LoadTraceWorld(name);
+		if (!world)
+		{
+			LogMessage(std::format("BenchmarkWorldFindLeaf {}: failed to load\n",
+								   name)
+						   .c_str());
+			return;
+		}
+
+		// Random points over the world bounds and a little past them, plus
+		// points on cell boundaries where rounding picks the neighbour
+		const auto& model = world->m_bspData->m_models[0];
+		const auto& grid = world->m_leafGrid;
+		const auto cellSize = 1.f / grid.m_inverseCellSize.x;
+		std::vector<oxyVec3> points(pointCount);
+		for (oxySize i = 0; i < points.size(); ++i)
+		{
+			oxyF32 point[3];
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				point[axis] = RandomF32(model.m_mins[axis] - 64.f,
+										model.m_maxs[axis] + 64.f);
+				if (i % 4 == 0)
+					point[axis] = model.m_mins[axis] +
+								  std::round((point[axis] - model.m_mins[axis]) /
+											 cellSize) *
+									  cellSize;
 			}
+			points[i] = {point[0], point[1], point[2]};
 		}
 
-		// Recurse nodes and store parents
+		constexpr auto k_passes = 5;
+		const auto headNode = static_cast<oxyS32>(model.m_headNodes[0]);
+		const auto Measure =
+			[&](std::vector<const BSPDefines::Leaf*>& leaves,
+				const auto& find) -> oxyF64 {
+			auto best = (std::numeric_limits<oxyF64>::max)();
+			for (auto pass = 0; pass < k_passes; ++pass)
+			{
+				leaves.assign(points.size(), nullptr);
+				const auto start = std::chrono::steady_clock::now();
+				for (oxySize i = 0; i < points.size(); ++i)
+					leaves[i] = find(points[i]);
+				best = (std::min)(
+					best, std::chrono::duration<oxyF64>(
+							  std::chrono::steady_clock::now() - start)
+							  .count());
+			}
+			return best > 0.0 ? points.size() / best : 0.0;
+		};
+		// The descent FindLeaf did before the packed nodes and the grid
+		const auto& bsp = *world->m_bspData;
+		std::vector<const BSPDefines::Leaf*> expected;
+		std::vector<const BSPDefines::Leaf*> packed;
+		std::vector<const BSPDefines::Leaf*> gridded;
+		const auto bspRate = Measure(expected, [&](const oxyVec3& point) {
+			auto nodeIndex = headNode;
+			while (nodeIndex >= 0)
+			{
+				const auto& node = bsp.m_nodes[nodeIndex];
+				const auto& plane = bsp.m_planes[node.m_planeIndex];
+				const auto dist = plane.m_normal[0] * point.x +
+								  plane.m_normal[1] * point.y +
+								  plane.m_normal[2] * point.z - plane.m_dist;
+				nodeIndex = node.m_children[dist >= 0.f ? 0 : 1];
+			}
+			return &bsp.m_leaves[-nodeIndex - 1];
+		});
+		const auto packedRate = Measure(packed, [&](const oxyVec3& point) {
+			return world->FindLeafFromNode(headNode, point);
+		});
+		const auto gridRate = Measure(gridded, [&](const oxyVec3& point) {
+			return world->FindLeaf(point, 0);
+		});
+
+		oxySize packedMismatches = 0;
+		oxySize gridMismatches = 0;
+		oxySize leafCells = 0;
+		for (oxySize i = 0; i < points.size(); ++i)
 		{
-			world->m_bspNodeParents.resize(world->m_bspData->m_nodes.size());
-			world->m_bspLeafParents.resize(world->m_bspData->m_leaves.size());
-			const auto& nodes = world->m_bspData->m_nodes;
-			OXYCHECK(nodes.size());
-			const auto RecurseNode = [&](auto&& Self, oxyS16 nodeIndex,
-										 oxyS16 parentIndex) {
+			packedMismatches += expected[i] != packed[i] ? 1 : 0;
+			gridMismatches += expected[i] != gridded[i] ? 1 : 0;
+		}
+		for (const auto cell : grid.m_cells)
+			leafCells += cell < 0 ? 1 : 0;
+		LogMessage(std::format("BenchmarkWorldFindLeaf {} x{}: bsp nodes {:.0f} "
+							   "lookups/s, packed nodes {:.0f} lookups/s ({} "
+							   "mismatches), grid {:.0f} lookups/s ({} "
+							   "mismatches), {} of {} cells resolved to a "
+							   "leaf\n",
+							   name, points.size(), bspRate, packedRate,
+							   packedMismatches, gridRate, gridMismatches,
+							   leafCells, grid.m_cells.size())
+					   .c_str());
+	}
+
+	auto BenchmarkWorldRenderTraversal(std::string_view name,
+									   oxyU32 viewCount) -> void
+	{
+		const auto world = LoadTraceWorld(name);
+		if (!world)
+		{
+			LogMessage(std::format(
+						   "BenchmarkWorldRenderTraversal {}: failed to load\n",
+						   name)
+						   .c_str());
+			return;
+		}
+
+		// The front to back walk RenderTraverseBSPNode does, over the whole
+		// tree since PVS and drawing cost the same either way. The order
+		// leaves are reached in is hashed so the layouts can be compared.
+		const auto& bsp = *world->m_bspData;
+		const auto& model = bsp.m_models[0];
+		std::vector<oxyVec3> views(viewCount);
+		for (auto& view : views)
+		{
+			view = {RandomF32(model.m_mins[0], model.m_maxs[0]),
+					RandomF32(model.m_mins[1], model.m_maxs[1]),
+					RandomF32(model.m_mins[2], model.m_maxs[2])};
+		}
+		std::vector<oxyS32> stack;
+		stack.reserve(bsp.m_nodes.size() + 1);
+		const auto Walk = [&](const oxyVec3& view, const auto& side) -> oxyU64 {
+			auto hash = oxyU64{14695981039346656037ull};
+			stack.assign(1, static_cast<oxyS32>(model.m_headNodes[0]));
+			while (!stack.empty())
+			{
+				const auto nodeIndex = stack.back();
+				stack.pop_back();
 				if (nodeIndex < 0)
 				{
-					const auto leafIndex = -nodeIndex - 1;
-					world->m_bspLeafParents[leafIndex] = parentIndex;
-					return;
+					hash = (hash ^ static_cast<oxyU32>(nodeIndex)) *
+						   1099511628211ull;
+					continue;
 				}
-				world->m_bspNodeParents[nodeIndex] = parentIndex;
-				const auto& node = nodes[nodeIndex];
-				Self(Self, node.m_children[0], nodeIndex);
-				Self(Self, node.m_children[1], nodeIndex);
-			};
-			RecurseNode(RecurseNode, 0, -1);
-		}
-		world->CreateEntitiesFromBSP();
-		return world;
+				const auto [nearChild, farChild] = side(nodeIndex, view);
+				stack.push_back(farChild);
+				stack.push_back(nearChild);
+			}
+			return hash;
+		};
+
+		constexpr auto k_passes = 5;
+		const auto Measure = [&](std::vector<oxyU64>& hashes,
+								 const auto& side) -> oxyF64 {
+			auto best = (std::numeric_limits<oxyF64>::max)();
+			for (auto pass = 0; pass < k_passes; ++pass)
+			{
+				hashes.assign(views.size(), 0);
+				const auto start = std::chrono::steady_clock::now();
+				for (oxySize i = 0; i < views.size(); ++i)
+					hashes[i] = Walk(views[i], side);
+				best = (std::min)(
+					best, std::chrono::duration<oxyF64>(
+							  std::chrono::steady_clock::now() - start)
+							  .count());
+			}
+			return best > 0.0 ? views.size() / best : 0.0;
+		};
+		std::vector<oxyU64> expected;
+		std::vector<oxyU64> actual;
+		using Children = std::pair<oxyS32, oxyS32>; // Near, far
+		const auto bspRate = Measure(expected, [&](oxyS32 nodeIndex,
+												   const oxyVec3& view) {
+			const auto& node = bsp.m_nodes[nodeIndex];
+			const auto& plane = bsp.m_planes[node.m_planeIndex];
+			const auto dist =
+				oxyVec3{plane.m_normal[0], plane.m_normal[1], plane.m_normal[2]}
+					.DotProduct(view) -
+				plane.m_dist;
+			const auto side = dist >= 0.f ? 1 : 0;
+			return Children{node.m_children[side], node.m_children[1 - side]};
+		});
+		const auto packedRate = Measure(actual, [&](oxyS32 nodeIndex,
+													const oxyVec3& view) {
+			const auto& node = world->m_packedNodes[nodeIndex];
+			const auto side = node.Distance(view) >= 0.f ? 1 : 0;
+			return Children{node.m_children[side], node.m_children[1 - side]};
+		});
+
+		oxySize mismatches = 0;
+		for (oxySize i = 0; i < views.size(); ++i)
+			mismatches += expected[i] != actual[i] ? 1 : 0;
+		LogMessage(std::format("BenchmarkWorldRenderTraversal {} x{}: bsp nodes "
+							   "{:.0f} walks/s, packed nodes {:.0f} walks/s, "
+							   "{} mismatches\n",
+							   name, views.size(), bspRate, packedRate,
+							   mismatches)
+					   .c_str());
+	}
+
+	namespace
+	{
+		// The slide HullComponent::UpdateSlide had before it clipped and
+		// stepped, one axis at a time. hit is set if any trace hit.
+		auto LegacySlideHull(const World& world, CollisionHull hull,
+							 const oxyVec3& position, const oxyVec3& offset,
+							 int depth, oxyBool& hit) -> oxyVec3
+		{
+			if (depth > 4)
+				return {};
+			World::LineTraceResult hitResult{};
+			if (world.HullTrace(hull, position, position + offset, hitResult))
+			{
+				hit = true;
+				// Project offset onto the plane normal
+				auto invNormal = -hitResult.m_planeNormal;
+				invNormal = invNormal * (offset * invNormal).Magnitude();
+				auto wallDir = offset - invNormal;
+				auto newPos = position + wallDir;
+				auto newOffset = newPos - position;
+				return LegacySlideHull(world, hull, newPos, newOffset,
+									   depth + 1, hit);
+			}
+			return offset;
+		}
+		auto LegacySlideMovement(const World& world, CollisionHull hull,
+								 const oxyVec3& position,
+								 const oxyVec3& distance,
+								 oxyBool& hit) -> oxyVec3
+		{
+			oxyVec3 step{};
+			step += LegacySlideHull(world, hull, position,
+									distance * oxyVec3{1, 0, 0}, 0, hit);
+			step += LegacySlideHull(world, hull, position + step,
+									distance * oxyVec3{0, 1, 0}, 0, hit);
+			step += LegacySlideHull(world, hull, position + step,
+									distance * oxyVec3{0, 0, 1}, 0, hit);
+			return position + step;
+		}
+	}; // namespace
+
+	auto CheckHullMovement(std::string_view name) -> void
+	{
+		const auto world = LoadTraceWorld(name);
+		if (!world)
+		{
+			LogMessage(
+				std::format("CheckHullMovement {}: failed to load\n", name)
+					.c_str());
+			return;
+		}
+
+		// The player's hull and tuning, as GameManager spawns it
+		constexpr auto k_hull = CollisionHull_Player;
+		constexpr auto k_gravityPerSecond = 700.f;
+		constexpr auto k_drag = 15.5f;
+		constexpr auto k_stepHeight = 18.f;
+		constexpr auto k_ticks = 60;
+		constexpr auto k_deltaTimeSeconds = 1.f / 60.f;
+		constexpr auto k_startAttempts = 4096;
+
+		struct Scenario
+		{
+			std::string_view m_name;
+			oxyF32 m_startHeight;
+			oxyF32 m_startVelocityZ;
+			// Held on x and y every tick, as a pawn does with its input
+			oxyVec2 m_wishVelocity;
+		};
+		constexpr Scenario k_scenarios[] = {
+			{"walk", 0.f, 0.f, {200.f, 0.f}},
+			{"strafe-diagonal", 0.f, 0.f, {141.f, 141.f}},
+			{"jump", 0.f, 270.f, {200.f, 0.f}},
+			{"fall", 128.f, 0.f, {0.f, 0.f}},
+		};
+		using Trajectory = std::vector<std::pair<oxyVec3, oxyVec3>>;
+
+		// UpdateSlide as it was before the clip and slide, less the hull
+		// contacts there are none of here. Returns false if any slide trace
+		// hit, the run was not all on open ground then.
+		const auto RunBaseline = [&](oxyVec3 position, oxyVec3 velocity,
+									 const oxyVec2& wishVelocity,
+									 Trajectory& trajectory) {
+			auto hit = false;
+			trajectory.clear();
+			for (auto tick = 0; tick < k_ticks; ++tick)
+			{
+				velocity.x = wishVelocity.x;
+				velocity.y = wishVelocity.y;
+				// The same 48 units/s lift the component still makes
+				const auto stepdist =
+					oxyVec3{0, 0, k_deltaTimeSeconds * 48.f};
+				const auto pos = LegacySlideMovement(
+					*world, k_hull, position + stepdist,
+					velocity * k_deltaTimeSeconds, hit);
+				auto newPosition = pos;
+				World::LineTraceResult result{};
+				const auto end =
+					pos +
+					oxyVec3{0, 0, -k_gravityPerSecond * k_deltaTimeSeconds};
+				if (world->HullTrace(k_hull, pos, end, result))
+				{
+					velocity.z = 0.0f;
+					newPosition = result.m_endPos;
+				}
+				else
+					velocity.z -= k_gravityPerSecond * k_deltaTimeSeconds;
+				// ClipToHullsAndUpdateWorldPosition ignores tiny moves
+				if ((newPosition - position).MagnitudeSquared() >= 0.0001f)
+					position = newPosition;
+				velocity.x *= 1.0f - k_drag * k_deltaTimeSeconds;
+				velocity.y *= 1.0f - k_drag * k_deltaTimeSeconds;
+				trajectory.emplace_back(position, velocity);
+			}
+			return !hit;
+		};
+
+		const auto Bits = [](const oxyVec3& v) {
+			return std::array{std::bit_cast<oxyU32>(v.x),
+							  std::bit_cast<oxyU32>(v.y),
+							  std::bit_cast<oxyU32>(v.z)};
+		};
+		Trajectory baseline;
+		for (const auto& scenario : k_scenarios)
+		{
+			// Random open points dropped to the floor until one where the
+			// baseline run stays clear of everything, mirrored on x and y to
+			// try each way out of it
+			std::optional<std::pair<oxyVec3, oxyVec2>> found;
+			for (auto attempt = 0; attempt < k_startAttempts && !found;
+				 ++attempt)
+			{
+				const auto point = RandomOpenPoint(*world);
+				World::LineTraceResult result{};
+				if (!world->HullTrace(k_hull, point,
+									  point - oxyVec3{0.f, 0.f, 4096.f},
+									  result) ||
+					result.m_fraction == 0.f)
+					continue;
+				const auto start = result.m_endPos +
+								   oxyVec3{0.f, 0.f, scenario.m_startHeight};
+				for (const auto mirror :
+					 {oxyVec2{1.f, 1.f}, oxyVec2{-1.f, 1.f},
+					  oxyVec2{1.f, -1.f}, oxyVec2{-1.f, -1.f}})
+				{
+					const auto wishVelocity = scenario.m_wishVelocity * mirror;
+					if (RunBaseline(start,
+									{wishVelocity, scenario.m_startVelocityZ},
+									wishVelocity, baseline))
+					{
+						found = {start, wishVelocity};
+						break;
+					}
+				}
+			}
+			if (!found)
+			{
+				LogMessage(std::format("CheckHullMovement {} {}: no open "
+									   "ground found\n",
+									   name, scenario.m_name)
+							   .c_str());
+				continue;
+			}
+			const auto& [start, wishVelocity] = *found;
+
+			// The same run through the component
+			auto ent = world->SpawnEntity();
+			ent->SetWorldPosition(start);
+			auto hull = ent->AddComponent<HullComponent>();
+			hull->SetHull(k_hull);
+			hull->SetGravityPerSecond(k_gravityPerSecond);
+			hull->SetDrag(k_drag);
+			hull->SetResponse(CollisionResponseType_Slide);
+			hull->SetStepHeight(k_stepHeight);
+			hull->SetVelocity({wishVelocity, scenario.m_startVelocityZ});
+			oxySize mismatches = 0;
+			for (auto tick = 0; tick < k_ticks; ++tick)
+			{
+				hull->SetVelocity({wishVelocity, hull->GetVelocity().z});
+				hull->Update(k_deltaTimeSeconds);
+				const auto& [expectedPosition, expectedVelocity] =
+					baseline[tick];
+				const auto actualPosition = ent->GetWorldPosition();
+				const auto& actualVelocity = hull->GetVelocity();
+				if (Bits(expectedPosition) == Bits(actualPosition) &&
+					Bits(expectedVelocity) == Bits(actualVelocity))
+					continue;
+				if (!mismatches++)
+				{
+					LogMessage(
+						std::format("CheckHullMovement {} {}: tick {} at ({}, "
+									"{}, {}) moving ({}, {}, {}), baseline "
+									"at ({}, {}, {}) moving ({}, {}, {})\n",
+									name, scenario.m_name, tick,
+									actualPosition.x, actualPosition.y,
+									actualPosition.z, actualVelocity.x,
+									actualVelocity.y, actualVelocity.z,
+									expectedPosition.x, expectedPosition.y,
+									expectedPosition.z, expectedVelocity.x,
+									expectedVelocity.y, expectedVelocity.z)
+							.c_str());
+				}
+			}
+			ent->Destroy();
+			LogMessage(std::format("CheckHullMovement {} {}: {} of {} ticks "
+								   "differ from the baseline\n",
+								   name, scenario.m_name, mismatches, k_ticks)
+						   .c_str());
+		}
 	}
-}; // namespace oxygen
\ No newline at end of file
+}; // namespace oxygen
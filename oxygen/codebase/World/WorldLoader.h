@@ -2,5 +2,89 @@
 
 namespace oxygen
 {
-	auto LoadWorld(std::string_view name) -> std::shared_ptr<struct World>;
+	// Called on the polling thread as each stage finishes, fraction is of
+	// the whole load
+	using WorldLoadProgressFn = void (*)(void* context, std::string_view stage,
+										 oxyF32 fraction);
+
+	// Loads a world while the current one keeps simulating. The map data,
+	// trace nodes and texture decodes run on tasks, Poll does the rest on
+	// the simulation thread (GL uploads, a few per call, then the entities)
+	// and nothing else sees the world until Poll reports it is done.
+	struct WorldStream : NonCopyable
+	{
+		explicit WorldStream(std::string_view name,
+							 WorldLoadProgressFn progress = nullptr,
+							 void* progressContext = nullptr);
+		~WorldStream();
+
+		// True once finished, blocking waits on the tasks and uploads
+		// everything in one call
+		auto Poll(oxyBool blocking = false) -> oxyBool;
+		// The finished world, empty if the load failed
+		auto TakeWorld() -> std::shared_ptr<struct World>;
+		auto GetName() const -> std::string_view
+		{
+			return m_name;
+		}
+
+	  private:
+		static inline constexpr auto k_uploadsPerPoll = oxySize{2};
+
+		enum Stage
+		{
+			Stage_Map,
+			Stage_Textures,
+			Stage_MapData,
+			Stage_Done
+		};
+		auto Step(std::string_view stage) -> void;
+		auto Fail() -> oxyBool;
+
+		std::string m_name;
+		WorldLoadProgressFn m_progress{};
+		void* m_progressContext{};
+		Stage m_stage{Stage_Map};
+		oxySize m_stepsDone{};
+		oxySize m_stepCount{1};
+		// The destructor waits the tasks out before this goes away
+		std::shared_ptr<struct World> m_world;
+		std::vector<struct PendingWorldTexture> m_textures;
+		oxySize m_nextTexture{};
+		std::future<oxyBool> m_mapTask;
+		std::future<oxyBool> m_mapDataTask;
+	};
+	// Loads a world on the calling thread
+	auto LoadWorld(std::string_view name,
+				   WorldLoadProgressFn progress = nullptr,
+				   void* progressContext = nullptr)
+		-> std::shared_ptr<struct World>;
+
+	// Offline, writes maps/<name>.oxymap from the .bsp and its sidecars
+	auto CookWorld(std::string_view name) -> oxyBool;
+	// Logs the map data load time from the sources against the .oxymap
+	auto BenchmarkWorldLoad(std::string_view name, oxyU32 iterations) -> void;
+	// A world with a map's data and trace structures but no textures or
+	// entities, for the offline tools. Empty if the map fails to load.
+	auto LoadTraceWorld(std::string_view name) -> std::shared_ptr<struct World>;
+	// A random point in the world bounds in an empty leaf, or the last one
+	// tried if none of them were
+	auto RandomOpenPoint(const struct World& world) -> oxyVec3;
+	// Logs line and hull trace throughput against the recursive traces, and
+	// any ray where the results differ
+	auto BenchmarkWorldTrace(std::string_view name, oxyU32 rayCount) -> void;
+	// Logs point lookup throughput of the packed nodes and the leaf grid
+	// against descending the .bsp nodes, and any point where they find
+	// different leaves
+	auto BenchmarkWorldFindLeaf(std::string_view name,
+								oxyU32 pointCount) -> void;
+	// Logs front to back walks of the whole world tree per second over the
+	// .bsp nodes against the packed nodes, and any view where the leaf order
+	// differs
+	auto BenchmarkWorldRenderTraversal(std::string_view name,
+									   oxyU32 viewCount) -> void;
+	// Walks, strafes, jumps and drops a player hull on open ground with the
+	// per-axis slide it used to have and with the current one, and logs any
+	// tick where the positions or velocities differ
+	auto CheckHullMovement(std::string_view name) -> void;
 }; // namespace oxygen
\ No newline at end of file